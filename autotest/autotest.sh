@@ -8,7 +8,7 @@ NC='\033[0m'
 # Génération des sorties
 echo "Génération des sorties :"
 echo -n "-> Sequential baseline"
-for i in {1..12}; do 
+for i in {1..12} {20..22}; do 
     ../bin/jpeg2ppm input/sequential/test${i}.jpg temp/test${i}.ppm &>/dev/null
 	if [ $? -eq 139 ]; then
 	    echo "Crash on test : $i"
@@ -31,7 +31,7 @@ echo "Done !"
 
 # Comparaison des sorties ppm produites
 echo "Comparaison avec les sorties de référence"
-for i in {1..19}; do 
+for i in {1..22}; do 
     diff temp/test${i}.ppm expected_output/test${i}.ppm &>/dev/null
     es=$?
     if [ $es -ne 0 ]; then 
@@ -41,3 +41,89 @@ for i in {1..19}; do
     fi
     rm temp/test${i}.ppm
 done
+
+# Décodage avec options (parallèle, stockage compact, cache) : les sorties
+# doivent être identiques aux sorties de référence
+echo "Comparaison avec options de décodage"
+for opts in "-m" "-c" "-m -c" "-cache"; do
+    for i in {1..22}; do
+        if [ ! -f expected_output/test${i}.ppm ]; then
+            continue
+        fi
+        if [ $i -le 12 ] || [ $i -ge 20 ]; then dir=sequential; else dir=progressive; fi
+        ../bin/jpeg2ppm input/${dir}/test${i}.jpg temp/test${i}.ppm ${opts} &>/dev/null
+        if [ $? -eq 139 ]; then
+            echo "Crash on test : $i (${opts})"
+            exit 1
+        fi
+        diff temp/test${i}.ppm expected_output/test${i}.ppm &>/dev/null
+        es=$?
+        if [ $es -ne 0 ]; then
+            echo -e "test_"$i".jpg ${opts} : ${RED}FAILED${NC}"
+        else
+            echo -e "test_"$i".jpg ${opts} : ${GREEN}PASSED${NC}"
+        fi
+        rm temp/test${i}.ppm
+    done
+done
+
+# Sorties des options de sortie (image test12) :
+# $1 est le nom de la sortie de référence, les arguments suivants les options
+verifie() {
+    sortie=$1
+    shift
+    ../bin/jpeg2ppm input/sequential/test12.jpg temp/${sortie} "$@" &>/dev/null
+    if [ $? -eq 139 ]; then
+        echo "Crash on test : 12 ($*)"
+        exit 1
+    fi
+    diff temp/${sortie} expected_output/${sortie} &>/dev/null
+    es=$?
+    if [ $es -ne 0 ]; then
+        echo -e "test_12.jpg $* : ${RED}FAILED${NC}"
+    else
+        echo -e "test_12.jpg $* : ${GREEN}PASSED${NC}"
+    fi
+    rm temp/${sortie}
+}
+
+echo "Comparaison des options de sortie"
+for s in 2 4 8; do
+    verifie test12_scale${s}.ppm -scale=1/${s}
+done
+for f in rgbx bgra i420 nv12 yuv444; do
+    verifie test12_${f}.raw -format=${f}
+done
+for f in nchw nhwc; do
+    verifie test12_${f}.raw -format=${f} -dtype=uint8
+done
+verifie test12_nchw.npy -format=nchw -npy -scale=1/4 -mean=0.485,0.456,0.406 -std=0.229,0.224,0.225
+verifie test12_luma.pgm -luma
+for o in 2 5 6; do
+    verifie test12_orient${o}.ppm -orient=${o}
+done
+
+# Décodage en mémoire (decode_to_buffer) avec des lignes élargies de 13 octets :
+# le tampon doit contenir les pixels du fichier produit avec les mêmes options
+echo "Comparaison du décodage en mémoire"
+for i in 12 13; do
+    if [ $i -le 12 ]; then dir=sequential; else dir=progressive; fi
+    for f in rgb rgbx bgra i420 nv12 yuv444 nchw nhwc; do
+        for o in 1 6; do
+            if [ $f = nchw ] || [ $f = nhwc ]; then dtype=-dtype=uint8; else dtype=; fi
+            ../bin/jpeg2ppm input/${dir}/test${i}.jpg temp/test${i}.${f} -format=${f} -orient=${o} ${dtype} &>/dev/null
+            ../bin/buffer_test input/${dir}/test${i}.jpg temp/test${i}.${f} ${f} 13 -orient=${o} &>/dev/null
+            es=$?
+            if [ $es -eq 139 ]; then
+                echo "Crash on test : $i (buffer ${f})"
+                exit 1
+            fi
+            if [ $es -ne 0 ]; then
+                echo -e "test_"$i".jpg buffer -format=${f} -orient=${o} : ${RED}FAILED${NC}"
+            else
+                echo -e "test_"$i".jpg buffer -format=${f} -orient=${o} : ${GREEN}PASSED${NC}"
+            fi
+            rm temp/test${i}.${f}
+        done
+    done
+done
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "jpeg_const.h"
+#include "jpeg_reader.h"
+#include "export_format.h"
+#include "cpu_dispatch.h"
+
+/*
+    Test du décodage en mémoire (decode_to_buffer) : l'image est décodée dans
+    un tampon dont les lignes sont espacées d'un pas élargi, puis comparée,
+    plan par plan et ligne par ligne, au fichier produit par jpeg2ppm avec
+    les mêmes options. Les octets de bourrage de fin de ligne et ceux qui
+    suivent le tampon doivent rester intacts.
+
+    Usage : buffer_test fichier.jpeg reference format bourrage [-m] [-orient=1..8]
+*/
+
+/* Paramètres d'appel (définis par jpeg2ppm.c dans le décodeur) */
+bool P_VERBOSE, P_BLABLA, P_PROG_STEP, P_MULTITHREAD, P_COMPACT, P_BENCH, P_CACHE, P_LUMA, P_STATS, P_NPY;
+enum idct_engine P_IDCT;
+uint8_t P_SCALE, P_ORIENTATION;
+enum cpu_tier P_CPU;
+enum pixel_format P_FORMAT;
+enum tensor_dtype P_DTYPE;
+float P_MEAN[3], P_STD[3];
+
+/* Valeur des octets qui ne doivent pas être écrits */
+#define TEMOIN 0xA5
+
+/* Octets témoins placés après le tampon */
+#define MARGE 64
+
+/* Plan du tampon : nombre de lignes, octets utiles par ligne, écart entre lignes */
+typedef struct
+{
+    size_t lignes;
+    size_t taille;
+    size_t pas;
+} plan_test_t;
+
+
+/*
+ * Fonction:  plans_attendus
+ * --------------------
+ * décrit les plans du tampon d'après la disposition documentée : plans
+ * successifs, plans U et V de I420 à pas moitié arrondi au-dessus, canaux
+ * de NCHW rangés comme des plans. Renvoie le nombre de plans.
+ *
+ *  format  : format de pixels
+ *  largeur : largeur de l'image en pixels
+ *  hauteur : hauteur de l'image en pixels
+ *  pas     : écart entre deux lignes de luminance en octets
+ *  plans   : plans décrits (au plus 3)
+ */
+static size_t plans_attendus(enum pixel_format format, size_t largeur, size_t hauteur, size_t pas, plan_test_t plans[3])
+{
+    size_t demi_largeur = (largeur + 1)/2, demi_hauteur = (hauteur + 1)/2;
+
+    switch (format) {
+    case FMT_RGB:
+    case FMT_NHWC:
+        plans[0] = (plan_test_t) {hauteur, 3*largeur, pas};
+        return 1;
+    case FMT_RGBX:
+    case FMT_BGRA:
+        plans[0] = (plan_test_t) {hauteur, 4*largeur, pas};
+        return 1;
+    case FMT_YUV444:
+    case FMT_NCHW:
+        for (size_t p = 0; p < 3; p++) plans[p] = (plan_test_t) {hauteur, largeur, pas};
+        return 3;
+    case FMT_I420:
+        plans[0] = (plan_test_t) {hauteur, largeur, pas};
+        plans[1] = (plan_test_t) {demi_hauteur, demi_largeur, (pas + 1)/2};
+        plans[2] = plans[1];
+        return 3;
+    case FMT_NV12:
+        plans[0] = (plan_test_t) {hauteur, largeur, pas};
+        plans[1] = (plan_test_t) {demi_hauteur, 2*demi_largeur, pas};
+        return 2;
+    default:
+        EXIT_ERROR("buffer_test", "Format de sortie invalide : %d", format);
+    }
+}
+
+/*
+ * Fonction:  lit_reference
+ * --------------------
+ * lit le fichier de référence et renvoie ses pixels (sans l'en-tête
+ * d'un fichier PPM)
+ *
+ *  nom    : nom du fichier
+ *  format : format de pixels
+ *  taille : reçoit le nombre d'octets de pixels
+ */
+static uint8_t* lit_reference(const char* nom, enum pixel_format format, size_t* taille)
+{
+    FILE* fichier = fopen(nom, "rb");
+    if (fichier == NULL) EXIT_ERROR("buffer_test", "Impossible d'ouvrir %s", nom);
+
+    /* En-tête PPM : type, dimensions et valeur maximale, sur trois lignes */
+    if (format == FMT_RGB) {
+        for (int lignes = 0; lignes < 3; ) {
+            int c = fgetc(fichier);
+            if (c == EOF) EXIT_ERROR("buffer_test", "En-tête PPM incomplet : %s", nom);
+            if (c == '\n') lignes++;
+        }
+    }
+
+    long debut = ftell(fichier);
+    fseek(fichier, 0, SEEK_END);
+    *taille = ftell(fichier) - debut;
+    fseek(fichier, debut, SEEK_SET);
+
+    uint8_t* pixels = malloc(*taille);
+    if (fread(pixels, 1, *taille, fichier) != *taille) EXIT_ERROR("buffer_test", "Lecture de %s incomplète", nom);
+    fclose(fichier);
+
+    return pixels;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 5) {
+        fprintf(stderr, "Usage: %s fichier.jpeg reference format bourrage [-m] [-orient=1..8]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    P_IDCT = IDCT_FLOAT;
+    P_SCALE = 1;
+    P_ORIENTATION = 1;
+    P_CPU = CPU_AUTO;
+    P_DTYPE = DTYPE_UINT8;
+    for (size_t c = 0; c < 3; c++) {
+        P_MEAN[c] = 0.0f; P_STD[c] = 1.0f;
+    }
+    for (int i = 5; i < argc; i++) {
+        if (!strcmp(argv[i], "-m")) {
+            P_MULTITHREAD = true;
+        } else if (!strncmp(argv[i], "-orient=", 8)) {
+            P_ORIENTATION = (uint8_t) atoi(&argv[i][8]);
+        } else {
+            EXIT_ERROR("buffer_test", "Option inconnue : %s", argv[i]);
+        }
+    }
+
+    enum pixel_format format = format_from_name(argv[3]);
+    P_FORMAT = format;
+    cpu_dispatch_init(P_CPU);
+
+    /* Tampon à lignes élargies, rempli de témoins */
+    struct jpeg_desc *jdesc = read_jpeg(argv[1]);
+    size_t largeur = get_oriented_size(jdesc, DIR_H), hauteur = get_oriented_size(jdesc, DIR_V);
+    size_t pas = format_min_stride(format, largeur) + (size_t) atoi(argv[4]);
+    size_t taille = format_buffer_size(format, largeur, hauteur, pas);
+    uint8_t* tampon = malloc(taille + MARGE);
+    memset(tampon, TEMOIN, taille + MARGE);
+
+    decode_to_buffer(jdesc, format, tampon, pas, NULL);
+    close_jpeg(jdesc);
+
+    /* Comparaison ligne par ligne avec le fichier, lignes contiguës */
+    size_t taille_ref;
+    uint8_t* reference = lit_reference(argv[2], format, &taille_ref);
+
+    plan_test_t plans[3];
+    size_t nb_plans = plans_attendus(format, largeur, hauteur, pas, plans);
+    size_t lu = 0, debut = 0, erreurs = 0;
+    for (size_t p = 0; p < nb_plans; p++) {
+        for (size_t l = 0; l < plans[p].lignes; l++) {
+            const uint8_t* ligne = &tampon[debut + l*plans[p].pas];
+            if (lu + plans[p].taille > taille_ref || memcmp(ligne, &reference[lu], plans[p].taille)) {
+                fprintf(stderr, "Plan %zu, ligne %zu : pixels différents du fichier\n", p, l);
+                erreurs++;
+            }
+            for (size_t o = plans[p].taille; o < plans[p].pas && debut + l*plans[p].pas + o < taille; o++) {
+                if (ligne[o] != TEMOIN) {
+                    fprintf(stderr, "Plan %zu, ligne %zu : bourrage écrit\n", p, l);
+                    erreurs++;
+                    break;
+                }
+            }
+            lu += plans[p].taille;
+        }
+        debut += plans[p].lignes*plans[p].pas;
+    }
+    if (lu != taille_ref) {
+        fprintf(stderr, "Taille : %zu octets de pixels, %zu dans le fichier\n", lu, taille_ref);
+        erreurs++;
+    }
+    for (size_t o = taille; o < taille + MARGE; o++) {
+        if (tampon[o] != TEMOIN) {
+            fprintf(stderr, "Ecriture après la fin du tampon\n");
+            erreurs++;
+            break;
+        }
+    }
+
+    free(reference);
+    free(tampon);
+
+    return (erreurs == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -28,6 +28,12 @@ extern void skip_bytes(struct bitstream* stream, uint32_t n_bytes);
 
 extern void flush_stream(struct bitstream* stream);
 
+extern long tell_bitstream(struct bitstream* stream);
+
+extern void seek_bitstream(struct bitstream* stream, long position);
+
+extern void skip_entropy_data(struct bitstream* stream);
+
 extern void print_offset(struct bitstream *stream);
 
 extern bool end_of_bitstream(struct bitstream *stream);
@@ -0,0 +1,44 @@
+#ifndef __COEFF_STORE_H__
+#define __COEFF_STORE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Classes de taille des blocs compacts : 4, 8, ..., 64 coefficients */
+#define STORE_CLASS_SIZE 4
+#define STORE_NB_CLASSES (64/STORE_CLASS_SIZE)
+
+/*
+    Stockage compact des coefficients d'une composante (mode progressif) :
+    chaque bloc ne conserve que ses coefficients non nuls, rangés dans
+    l'ordre zig-zag. Le masque de parcimonie du bloc (bloc_info_t) donne
+    la position de chacun d'eux.
+*/
+typedef struct
+{
+    size_t    num_blocs;     // Nombre de blocs de la composante
+    uint32_t* offsets;       // Position des valeurs de chaque bloc dans le pool
+    uint8_t*  classes;       // Classe de taille de chaque bloc (0 : aucune valeur)
+
+    int16_t*  pool;          // Valeurs non nulles de tous les blocs
+    size_t    pool_size;     // Nombre d'entrées utilisées dans le pool
+    size_t    pool_alloc;    // Nombre d'entrées allouées
+    size_t    peak_alloc;    // Nombre maximal d'entrées allouées depuis la création
+
+    /* Listes des emplacements libérés, par classe de taille */
+    uint32_t  free_lists[STORE_NB_CLASSES];
+} coeff_store_t;
+
+extern coeff_store_t* create_coeff_store(size_t num_blocs);
+
+extern void free_coeff_store(coeff_store_t* store);
+
+extern void expand_bloc(const coeff_store_t* store, size_t index, uint64_t mask, int16_t* bloc);
+
+extern void pack_bloc(coeff_store_t* store, size_t index, uint64_t mask, int16_t* bloc);
+
+extern void compact_coeff_store(coeff_store_t* store);
+
+extern size_t coeff_store_bytes(const coeff_store_t* store);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __CPU_DISPATCH_H__
+#define __CPU_DISPATCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "jpeg_const.h"
+#include "idct.h"
+
+
+/* Noyaux de calcul, liés une fois pour toutes au démarrage par cpu_dispatch_init */
+struct cpu_kernels
+{
+    enum cpu_tier tier; // Niveau retenu
+    idct_fn  idct;
+    idct_lot_fn idct_lot; // iDCT par lots (NULL si indisponible)
+    uint8_t  voies;       // Nombre de blocs d'un lot
+    void     (*ycbcr_rgb)(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *rgb, size_t nb);
+    void     (*ycbcr_rgbx)(const uint8_t *y, const uint8_t *cb, const uint8_t *cr, uint8_t *dest, size_t nb, bool bgr);
+    void     (*double_pixels)(const uint8_t *src, uint8_t *dest, size_t nb);
+};
+
+extern struct cpu_kernels KERNELS;
+
+extern enum cpu_tier cpu_detect(void);
+
+extern enum cpu_tier cpu_tier_from_name(const char *nom);
+
+extern const char *cpu_tier_name(enum cpu_tier tier);
+
+extern void cpu_dispatch_init(enum cpu_tier tier);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef __EXPORT_FORMAT_H__
+#define __EXPORT_FORMAT_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "jpeg_const.h"
+#include "extract_image.h"
+#include "jpeg_reader.h"
+
+
+/* Statistiques des pixels d'une sortie, accumulées pendant leur production :
+   canaux R, G, B (valeurs 8 bits avant normalisation pour les tenseurs), Y, U, V
+   pour les formats YUV (chrominances à la résolution de leur plan), ou Y seul
+   pour une sortie PGM */
+typedef struct image_stats
+{
+    uint8_t  nb_canaux;             // Nombre de canaux décrits (1 ou 3)
+    uint64_t histogramme[3][256];   // Nombre de pixels de chaque valeur, par canal
+    uint64_t nb[3];                 // Nombre de valeurs de chaque canal
+    uint64_t somme[3];              // Somme des valeurs de chaque canal
+    double   moyenne[3];            // Valeur moyenne de chaque canal
+    uint8_t  min[3];                // Valeurs extrêmes de chaque canal
+    uint8_t  max[3];
+} image_stats_t;
+
+extern enum pixel_format format_from_name(const char *nom);
+
+extern const char *format_extension(enum pixel_format format);
+
+extern size_t format_min_stride(enum pixel_format format, size_t largeur);
+
+extern size_t format_chroma_stride(enum pixel_format format, size_t pas);
+
+extern size_t format_buffer_size(enum pixel_format format, size_t largeur, size_t hauteur, size_t pas);
+
+extern void export_pixels(image8_t* jpeg_image, struct jpeg_desc *jdesc, enum pixel_format format, FILE* sortie);
+
+extern void export_luminance(image8_t* jpeg_image, struct jpeg_desc *jdesc, FILE* fichier);
+
+extern void export_raw(image8_t* jpeg_image, struct jpeg_desc *jdesc, enum pixel_format format, const char* filename);
+
+extern void export_buffer(image8_t* jpeg_image, struct jpeg_desc *jdesc, enum pixel_format format, uint8_t* dest, size_t pas);
+
+extern void decode_to_buffer(struct jpeg_desc *jdesc, enum pixel_format format, uint8_t* dest, size_t pas, image_stats_t* stats);
+
+extern void print_stats(const image_stats_t* stats, enum pixel_format format);
+
+#endif
@@ -2,11 +2,25 @@
 #define __EXPORTPPM_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 #include "extract_image.h"
 #include "jpeg_reader.h"
 
 
+extern void ycbcr_to_rgb_ligne(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb);
+
+extern void ycbcr_to_rgb_ligne_sse4(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb);
+
+extern void ycbcr_to_rgb_ligne_avx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb);
+
+extern void ycbcr_to_rgbx_ligne(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr);
+
+extern void ycbcr_to_rgbx_ligne_sse4(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr);
+
+extern void ycbcr_to_rgbx_ligne_avx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr);
+
 extern void export_pgm(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filename);
 
 extern void export_ppm(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filename);
@@ -41,4 +41,10 @@ extern void extract_first_AC_blocs_color(struct jpeg_desc *jdesc,
 extern void extract_next_AC_blocs_color(struct jpeg_desc *jdesc,
                                         image16_t* prog_image);
 
+// Scan courant, quelle que soit sa nature
+extern void extract_scan(struct jpeg_desc *jdesc,
+                         image16_t* prog_image);
+
+extern void update_bloc_infos(image16_t* image);
+
 #endif
\ No newline at end of file
@@ -7,8 +7,17 @@
 #include "extract_image.h"
 #include "jpeg_reader.h"
 #include "bitstream.h"
+#include "coeff_store.h"
 
 
+/* Métadonnées de parcimonie d'un bloc, remplies au décodage entropique */
+typedef struct
+{
+    uint64_t  mask;         // Masque des coefficients non nuls (bit i <-> indice zig-zag i)
+    uint8_t   eob;          // Dernier indice zig-zag non nul + 1 (0 si bloc nul)
+    bool      a_jour;       // Bloc 8 bits transformé depuis la dernière modification des coefficients
+} bloc_info_t;
+
 /* Image avec pixels sur 16 bits signés */
 typedef struct
 {
@@ -21,10 +30,25 @@ typedef struct
     size_t    bloc_width;   // Largeur en nombre de blocs (après décompression)
     size_t    bloc_height;  // Hauteur en nombre de blocs (après décompression)
 
-    /* Blocs couleur contenus */
+    /* Coefficients : un tableau contigu par composante, en ordre raster */
+    int16_t*  y_coeffs;     // Coefficients Y
+    int16_t*  cb_coeffs;    // Coefficients Cb
+    int16_t*  cr_coeffs;    // Coefficients Cr
+
+    /* Blocs couleur contenus (pointeurs dans les tableaux de coefficients) */
     int16_t** y_blocs;      // Blocs Y
     int16_t** cb_blocs;     // Blocs Cb
     int16_t** cr_blocs;     // Blocs Cr
+
+    /* Métadonnées des blocs (même indexation que les blocs) */
+    bloc_info_t* y_infos;   // Métadonnées Y
+    bloc_info_t* cb_infos;  // Métadonnées Cb
+    bloc_info_t* cr_infos;  // Métadonnées Cr
+
+    /* Stockage compact (mode progressif, option -c) : remplace les blocs denses */
+    coeff_store_t* y_store;  // Coefficients Y (NULL si stockage dense)
+    coeff_store_t* cb_store; // Coefficients Cb
+    coeff_store_t* cr_store; // Coefficients Cr
 } image16_t;
 
 /* Image avec pixels sur 8 bits non signés */
@@ -38,16 +62,26 @@ typedef struct
     size_t    num_blocs_Cr; // Nombre de blocs Cr
     size_t    bloc_width;   // Largeur en nombre de blocs (après décompression)
     size_t    bloc_height;  // Hauteur en nombre de blocs (après décompression)
+    uint8_t   bloc_size;    // Côté des blocs en pixels (BLOCK_SIZE/P_SCALE)
 
-    /* Blocs couleur contenus */
+    /* Blocs couleur contenus, en ordre des MCUs (chrominances non suréchantillonnées) */
     uint8_t** y_blocs;      // Blocs Y
     uint8_t** cb_blocs;     // Blocs Cb
     uint8_t** cr_blocs;     // Blocs Cr
+
+    /* Statistiques des pixels, remplies pendant l'export (voir export_format.h) */
+    struct image_stats* stats; // Statistiques à remplir (NULL : non calculées)
 } image8_t;
 
 extern image8_t* extract_image(struct jpeg_desc *jdesc);
 
-extern uint32_t* remap_mcus(struct jpeg_desc *jdesc, image16_t* jpeg_image, uint8_t comp);
+extern size_t scan_nb_blocs(const struct jpeg_desc *jdesc, uint8_t comp);
+
+extern size_t scan_bloc_index(const struct jpeg_desc *jdesc, uint8_t comp, size_t scan_index);
+
+extern size_t mcu_bloc_index(const struct jpeg_desc *jdesc, uint8_t comp, size_t mcu, uint8_t bloc);
+
+extern size_t mcu_order_index(const struct jpeg_desc *jdesc, uint8_t comp, size_t index);
 
 extern void free_image(image8_t* jpeg_image);
 
@@ -0,0 +1,57 @@
+#ifndef __IDCT_H__
+#define __IDCT_H__
+
+#include <stdint.h>
+
+#include "jpeg_const.h"
+
+
+/* Moteur d'iDCT : bloc quantifié en ordre naturel, table de quantification
+   prémultipliée, nombre de coefficients zig-zag utiles et côté du carré
+   des coefficients non nuls -> bloc 8x8 de pixels (alloué) */
+typedef uint8_t* (*idct_fn)(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille);
+
+/* iDCT par lots : un bloc par voie SIMD, tous les blocs du lot partageant
+   la même table de quantification -> blocs 8x8 de pixels (alloués) */
+typedef void (*idct_lot_fn)(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, uint8_t **sorties);
+
+/* Variantes signées (banc d'essai) : mêmes calculs, sorties arrondies à l'entier
+   le plus proche et bornées à [IDCT_SIGNE_MIN, IDCT_SIGNE_MAX] comme dans la norme
+   IEEE 1180, avant recentrage (+128) et saturation sur 8 bits */
+typedef void (*idct_signe_fn)(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie);
+typedef void (*idct_lot_signe_fn)(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, int16_t **sorties);
+
+#define IDCT_SIGNE_MIN (-256)
+#define IDCT_SIGNE_MAX 255
+
+/* Taille maximale d'un lot (16 voies AVX-512) */
+#define IDCT_LOT_MAX 16
+
+/* Description d'un moteur d'iDCT sélectionnable */
+struct idct_engine_desc
+{
+    const char*   nom;      // Nom du moteur (option -idct=)
+    idct_fn       idct;     // Fonction d'iDCT
+    idct_signe_fn signe;    // Même iDCT avant recentrage et saturation (banc d'essai)
+    int32_t       echelle;  // Facteur d'échelle attendu des tables de quantification
+    enum cpu_tier niveau;   // Niveau de jeu d'instructions requis
+};
+
+extern const struct idct_engine_desc IDCT_ENGINES[IDCT_NB_ENGINES];
+
+/* Chemins d'iDCT selon le carré des coefficients non nuls du bloc */
+enum idct_path { IDCT_PATH_DC, IDCT_PATH_2x2, IDCT_PATH_4x4, IDCT_PATH_FULL, IDCT_NB_PATHS };
+
+extern const uint8_t IDCT_PATH_SIZE[IDCT_NB_PATHS];
+
+extern uint8_t *idct_reference(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille);
+
+extern void idct_reference_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie);
+
+extern int16_t idct_arrondi_signe(double valeur);
+
+extern enum idct_engine idct_engine_from_name(const char *nom);
+
+extern enum idct_path idct_path(uint64_t mask);
+
+#endif
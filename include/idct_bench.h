@@ -0,0 +1,9 @@
+#ifndef __IDCT_BENCH_H__
+#define __IDCT_BENCH_H__
+
+#include "jpeg_reader.h"
+#include "extract_image.h"
+
+extern void idct_bench(const struct jpeg_desc* jdesc, const image16_t* image);
+
+#endif
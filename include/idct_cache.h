@@ -0,0 +1,38 @@
+#ifndef __IDCT_CACHE_H__
+#define __IDCT_CACHE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "jpeg_const.h"
+
+
+/* Nombre d'entrées du cache (puissance de 2) */
+#define IDCT_CACHE_ENTREES 2048
+
+/* Entrée du cache : bloc quantifié, table de quantification et pixels produits */
+typedef struct
+{
+    const int32_t* qtable;                 // Table de quantification (NULL : entrée vide)
+    int16_t        coeffs[BLOCK_PIXELS];   // Coefficients quantifiés, ordre naturel
+    uint8_t        pixels[BLOCK_PIXELS];   // Sortie de l'iDCT
+} idct_cache_entry_t;
+
+/* Cache des sorties d'iDCT (option -cache), à correspondance directe */
+typedef struct
+{
+    idct_cache_entry_t* entrees;   // Entrées, indexées par le hachage des blocs
+    idct_cache_entry_t* courante;  // Entrée du dernier bloc cherché
+    size_t              acces;     // Nombre de blocs cherchés
+    size_t              succes;    // Nombre de blocs trouvés
+} idct_cache_t;
+
+extern idct_cache_t* create_idct_cache(void);
+
+extern void free_idct_cache(idct_cache_t* cache);
+
+extern uint8_t* idct_cache_get(idct_cache_t* cache, const int16_t* bloc, const int32_t* qtable, size_t nb_pixels);
+
+extern void idct_cache_put(idct_cache_t* cache, const int16_t* bloc, const int32_t* qtable, const uint8_t* pixels, size_t nb_pixels);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef __IDCT_SCALED_H__
+#define __IDCT_SCALED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern uint8_t *idct_scaled(const int16_t *bloc, const int32_t *qtable, uint8_t taille, bool dc_seul);
+
+#endif
@@ -3,8 +3,28 @@
 
 #include <stdint.h>
 
-extern void quantification_inverse(const struct jpeg_desc* jdesc, int16_t* bloc, int index);
+#include "jpeg_reader.h"
 
-extern int16_t* zig_zag(int16_t *nvx_tab, int16_t *tab);
+/* Correspondance indice zig-zag -> indice en ordre naturel */
+extern const uint8_t EQUIV_ZZ[64];
+
+/* Facteur d'échelle des tables de quantification pour les iDCT flottantes */
+#define IDCT_PRESCALE_FLOAT 8
+
+extern void quantification_inverse(const struct jpeg_desc* jdesc, int16_t* bloc, int index, uint8_t eob);
+
+extern int32_t quantization_prescale(void);
+
+extern int32_t* prescale_quantization_table(const uint8_t* qtable, int32_t echelle);
+
+extern int32_t iqzz_dc(const int16_t* bloc, const int32_t* qtable, int32_t echelle);
+
+extern void iqzz_float(float* dest, const int16_t* bloc, const int32_t* qtable, uint8_t eob);
+
+extern void iqzz_float_voie(float* dest, uint8_t voies, const int16_t* bloc, const int32_t* qtable, uint8_t eob);
+
+extern void iqzz_int(int32_t* dest, const int16_t* bloc, const int32_t* qtable, uint8_t eob);
+
+extern void iqzz_reduit(float* dest, const int16_t* bloc, const int32_t* qtable, uint8_t taille);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define __JPEG_CONST_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Propriétés des blocs */
 #define BLOCK_SIZE   8
@@ -68,7 +69,35 @@
 }
 
 /* Flags des paramètres d'appel */
-extern bool P_VERBOSE, P_BLABLA, P_PROG_STEP, P_MULTITHREAD;
+extern bool P_VERBOSE, P_BLABLA, P_PROG_STEP, P_MULTITHREAD, P_COMPACT, P_BENCH, P_CACHE, P_LUMA, P_STATS;
+
+/* Moteur d'iDCT sélectionné (option -idct=, voir idct.c) */
+enum idct_engine { IDCT_REF, IDCT_FLOAT, IDCT_INT, IDCT_SSE2, IDCT_AVX2, IDCT_NB_ENGINES };
+extern enum idct_engine P_IDCT;
+
+/* Décodage réduit (option -scale=) : dénominateur de l'échelle, 1, 2, 4 ou 8 */
+extern uint8_t P_SCALE;
+
+/* Orientation de la sortie (option -orient=), numérotation EXIF : 1 telle quelle,
+   2 miroir horizontal, 3 rotation de 180, 4 miroir vertical, 5 transposition,
+   6 rotation de 90 (sens horaire), 7 transposition inverse, 8 rotation de 270 */
+extern uint8_t P_ORIENTATION;
+
+/* Niveau de jeu d'instructions des noyaux (option -cpu= ou variable JPEG2PPM_CPU),
+   du moins au plus étendu ; CPU_AUTO : niveau détecté au démarrage */
+enum cpu_tier { CPU_SCALAR, CPU_SSE2, CPU_SSE4, CPU_AVX2, CPU_AVX512, CPU_AUTO };
+extern enum cpu_tier P_CPU;
+
+/* Format des pixels de sortie (option -format=, voir export_format.c) */
+enum pixel_format { FMT_RGB, FMT_RGBX, FMT_BGRA, FMT_I420, FMT_NV12, FMT_YUV444, FMT_NCHW, FMT_NHWC, FMT_NB };
+extern enum pixel_format P_FORMAT;
+
+/* Sorties tenseur (formats nchw et nhwc) : type des éléments (option -dtype=),
+   normalisation par canal (options -mean= et -std=), conteneur .npy (option -npy) */
+enum tensor_dtype { DTYPE_FLOAT32, DTYPE_UINT8 };
+extern enum tensor_dtype P_DTYPE;
+extern float P_MEAN[3], P_STD[3];
+extern bool P_NPY;
 
 /* Sortie "verbose" */
 #define INFO_MSG(format, ...) do {              \
@@ -21,6 +21,8 @@ struct jpeg_desc
     uint8_t     **quantization_tables_8;
     // => Nombre de tables sur 8 bits
     uint8_t     ntables_qt_8;
+    // => Tables 8 bits en ordre naturel, prémultipliées pour l'iDCT
+    int32_t     **quantization_tables_idct;
     // => Sur 16 bits
     uint16_t     **quantization_tables_16;
     // => Nombre de tables sur 16 bits
@@ -31,6 +33,10 @@ struct jpeg_desc
     struct huff_table *tables_AC[2], *tables_DC[2];
     // => Nombre de tables stockées par coefficients
     uint8_t     ntables_AC, ntables_DC;
+    // => Tables redéfinies par une section DHT, conservées jusqu'à la fermeture
+    //    (les scans progressifs repérés à l'avance y font référence)
+    struct huff_table **tables_remplacees;
+    uint16_t    ntables_remplacees;
 
     /* Largeur\Hauteur de l'image en pixels */
     uint16_t    largeur, hauteur;
@@ -60,9 +66,14 @@ struct jpeg_desc
     /* Nombre de blocs/MCUs */
     uint8_t     nb_cp_mcu[3];
     uint32_t    nb_mcus;
-
-    /* Tableaux de remapping des MCUs */
-    uint32_t*   mcu_maps[3];
+    // => Nombre de MCUs en largeur\hauteur
+    uint32_t    nb_mcus_h, nb_mcus_v;
+
+    /* Stockage des coefficients : ordre raster propre à chaque composante */
+    // => Nombre de blocs d'une ligne stockée (MCUs incomplets compris)
+    uint32_t    comp_stride[3];
+    // => Largeur\hauteur en blocs couvertes par un scan non entrelacé
+    uint32_t    comp_blocs_h[3], comp_blocs_v[3];
 };
 
 
@@ -104,6 +115,9 @@ extern uint8_t get_nb_quantization_tables(const struct jpeg_desc *jpeg);
 extern uint8_t *get_quantization_table(const struct jpeg_desc *jpeg,
                                        uint8_t index);
 
+extern const int32_t *get_idct_quantization_table(const struct jpeg_desc *jpeg,
+                                                  uint8_t index);
+
 extern uint8_t get_nb_huffman_tables(const struct jpeg_desc *jpeg,
                                      enum acdc acdc);
 
@@ -112,6 +126,10 @@ extern struct huff_table *get_huffman_table(const struct jpeg_desc *jpeg,
 
 extern uint16_t get_image_size(struct jpeg_desc *jpeg, enum direction dir);
 
+extern uint16_t get_output_size(struct jpeg_desc *jpeg, enum direction dir);
+
+extern uint16_t get_oriented_size(struct jpeg_desc *jpeg, enum direction dir);
+
 extern uint8_t get_nb_components(const struct jpeg_desc *jpeg);
 
 extern uint8_t get_frame_component_id(const struct jpeg_desc *jpeg,
@@ -3,6 +3,12 @@
 
 #include <stdint.h>
 
-extern uint8_t *loeffler_idct_loeffler(float* swap_bloc, int16_t *bloc);
+extern uint8_t *loeffler_idct_dc(int32_t dc);
+
+extern void loeffler_idct_dc_signe(int32_t dc, int16_t *sortie);
+
+extern uint8_t *loeffler_idct_loeffler(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille);
+
+extern void loeffler_idct_loeffler_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie);
 
 #endif
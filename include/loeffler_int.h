@@ -0,0 +1,10 @@
+#ifndef __LOEFFLER_INT_H__
+#define __LOEFFLER_INT_H__
+
+#include <stdint.h>
+
+extern uint8_t *loeffler_idct_int(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille);
+
+extern void loeffler_idct_int_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie);
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef __LOEFFLER_SIMD_H__
+#define __LOEFFLER_SIMD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+extern uint8_t *loeffler_idct_sse2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille);
+
+extern uint8_t *loeffler_idct_avx2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille);
+
+extern void loeffler_idct_sse2_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie);
+
+extern void loeffler_idct_avx2_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie);
+
+extern void loeffler_idct_lot_avx2(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, uint8_t **sorties);
+
+extern void loeffler_idct_lot_avx512(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, uint8_t **sorties);
+
+extern void loeffler_idct_lot_avx2_signe(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, int16_t **sorties);
+
+extern void loeffler_idct_lot_avx512_signe(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, int16_t **sorties);
+
+#endif
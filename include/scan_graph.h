@@ -0,0 +1,10 @@
+#ifndef __SCAN_GRAPH_H__
+#define __SCAN_GRAPH_H__
+
+#include "jpeg_reader.h"
+#include "extract_image.h"
+
+
+extern void extract_scans_parallel(struct jpeg_desc *jdesc, image16_t* prog_image);
+
+#endif
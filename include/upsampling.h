@@ -1,9 +1,51 @@
 #ifndef __UPSAMPLES_H__
 #define __UPSAMPLES_H__
 
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
 #include "extract_image.h"
 #include "jpeg_reader.h"
 
-extern void upsamples(image8_t* image, struct jpeg_desc* desc);
+extern void double_pixels(const uint8_t* src, uint8_t* dest, size_t nb);
+
+extern void double_pixels_sse2(const uint8_t* src, uint8_t* dest, size_t nb);
+
+/* Lecture ligne à ligne d'une composante à pleine résolution (suréchantillonnage à la volée) */
+typedef struct
+{
+    uint8_t** blocs;        // Blocs de la composante, en ordre des MCUs
+    uint8_t   n;            // Côté des blocs en pixels
+    uint8_t   h_comp;       // Facteurs d'échantillonnage de la composante
+    uint8_t   v_comp;
+    uint8_t   fh;           // Rapports de suréchantillonnage dans le repère de sortie (facteurs du MCU / de la composante)
+    uint8_t   fv;
+    bool      transpose;    // Lignes de sortie lues dans les colonnes de la composante (rotation de 90 ou 270)
+    bool      inverse_lignes; // Lignes de sortie prises en partant de la dernière
+    bool      inverse_pixels; // Pixels de chaque ligne de sortie pris de droite à gauche
+    size_t    nb_mcus_h;    // Nombre de MCUs par ligne
+    size_t    largeur;      // Largeur de l'image de sortie (orientée) en pixels
+    size_t    hauteur;      // Hauteur de l'image de sortie (orientée) en pixels
+    size_t    sous_largeur; // Largeur des lignes de la composante (dans le repère de sortie)
+    size_t    derniere;     // Ligne de la composante lue en cache (SIZE_MAX : aucune)
+    size_t    repetee;      // Ligne de la composante répétée en cache (SIZE_MAX : aucune)
+    size_t    renversee;    // Ligne de la composante renversée en cache (SIZE_MAX : aucune)
+    uint8_t*  sous_ligne;   // Ligne de la composante lue dans les blocs (n lignes transposées si transpose)
+    uint8_t*  ligne;        // Ligne à pleine résolution
+    uint8_t*  miroir;       // Ligne à pleine résolution renversée (NULL sans inverse_pixels)
+    void      (*repete)(const uint8_t* src, uint8_t* dest, size_t nb); // Répétition horizontale (NULL si fh = 1)
+} upsampler_t;
+
+extern upsampler_t* create_upsampler(const image8_t* image, const struct jpeg_desc* desc, uint8_t comp,
+                                     size_t largeur, size_t hauteur, uint8_t orientation);
+
+extern void free_upsampler(upsampler_t* up);
+
+extern const uint8_t* composante_ligne(upsampler_t* up, size_t sous_ligne);
+
+extern const uint8_t* upsample_ligne(upsampler_t* up, size_t ligne);
+
+extern void check_sampling_factors(const struct jpeg_desc* desc);
 
 #endif
\ No newline at end of file
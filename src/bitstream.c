@@ -228,6 +228,63 @@ void skip_bytes(struct bitstream* stream, uint32_t n_bytes)
     flush_stream(stream);
 }
 
+/*
+ * Fonction:  tell_bitstream, seek_bitstream
+ * --------------------
+ * renvoie (resp. fixe) la position courante du flux ouvert,
+ * en octets depuis le début du fichier. Le repositionnement
+ * remet le flux à zéro.
+ *
+ *  stream   : bitstream du fichier ouvert
+ *  position : position à atteindre
+ * 
+ */
+long tell_bitstream(struct bitstream* stream)
+{
+    return ftell(stream->filehandle);
+}
+void seek_bitstream(struct bitstream* stream, long position)
+{
+    if (fseek(stream->filehandle, position, SEEK_SET) != 0) {
+        EXIT_ERROR("bitstream", "Position %ld inaccessible dans le flux.", position);
+    }
+
+    /* Remise à zéro du stream */
+    flush_stream(stream);
+}
+
+/*
+ * Fonction:  skip_entropy_data
+ * --------------------
+ * passe les données codées d'un scan sans les décoder :
+ * avance jusqu'au prochain marqueur (0xFF suivi d'un octet
+ * autre que 0x00 ou 0xFF), sur lequel le flux est repositionné.
+ *
+ *  stream : bitstream positionné au début des données du scan
+ * 
+ */
+void skip_entropy_data(struct bitstream* stream)
+{
+    int octet;
+
+    flush_stream(stream);
+    while ((octet = fgetc(stream->filehandle)) != EOF) {
+        if (octet != 0xFF) continue;
+
+        /* 0xFF : octet de bourrage (0xFF00), de remplissage ou marqueur */
+        do {
+            octet = fgetc(stream->filehandle);
+        } while (octet == 0xFF);
+        if (octet == 0x00) continue;
+        if (octet == EOF) break;
+
+        /* Marqueur : on revient sur son 0xFF */
+        fseek(stream->filehandle, -2, SEEK_CUR);
+        return;
+    }
+    EXIT_ERROR("bitstream", "Fin inattendue du fichier : données de scan sans marqueur final.");
+}
+
 /*
  * Fonction:  flush_stream
  * --------------------
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "jpeg_const.h"
+#include "coeff_store.h"
+#include "iqzz.h"
+
+/* Fin de liste des emplacements libres */
+#define FREE_END UINT32_MAX
+
+
+/*
+ * Fonction:  create_coeff_store
+ * --------------------
+ * alloue un stockage compact vide pour [num_blocs] blocs.
+ *
+ *  num_blocs : nombre de blocs de la composante
+ *
+ */
+coeff_store_t* create_coeff_store(size_t num_blocs)
+{
+    coeff_store_t* store = malloc(sizeof(coeff_store_t));
+
+    store->num_blocs = num_blocs;
+    store->offsets   = calloc(num_blocs, sizeof(uint32_t));
+    store->classes   = calloc(num_blocs, sizeof(uint8_t));
+
+    /* Estimation initiale : un emplacement de la plus petite classe par bloc */
+    store->pool_size  = 0;
+    store->pool_alloc = STORE_CLASS_SIZE*num_blocs;
+    store->peak_alloc = store->pool_alloc;
+    store->pool       = malloc(sizeof(int16_t)*store->pool_alloc);
+
+    for (size_t k=0; k<STORE_NB_CLASSES; k++)
+        store->free_lists[k] = FREE_END;
+
+    return store;
+}
+
+/*
+ * Fonction:  free_coeff_store
+ * --------------------
+ * libère un stockage compact.
+ *
+ *  store : stockage à libérer
+ *
+ */
+void free_coeff_store(coeff_store_t* store)
+{
+    free(store->offsets);
+    free(store->classes);
+    free(store->pool);
+    free(store);
+}
+
+/*
+ * Fonction:  resize_pool
+ * --------------------
+ * réalloue le pool d'un stockage compact avec [taille] entrées.
+ *
+ *  store  : stockage compact
+ *  taille : nouveau nombre d'entrées allouées
+ *
+ */
+static void resize_pool(coeff_store_t* store, size_t taille)
+{
+    store->pool = realloc(store->pool, sizeof(int16_t)*taille);
+    if (store->pool == NULL) {
+        EXIT_ERROR("coeff_store", "Allocation du stockage compact impossible");
+    }
+    store->pool_alloc = taille;
+    if (taille > store->peak_alloc) store->peak_alloc = taille;
+}
+
+/*
+ * Fonction:  alloc_slot
+ * --------------------
+ * réserve un emplacement de la classe [classe] dans le pool,
+ * en réutilisant en priorité un emplacement libéré.
+ *
+ *  store  : stockage compact
+ *  classe : classe de taille (emplacement de classe*STORE_CLASS_SIZE valeurs)
+ *
+ * renvoie la position de l'emplacement dans le pool
+ */
+static uint32_t alloc_slot(coeff_store_t* store, uint8_t classe)
+{
+    uint32_t offset = store->free_lists[classe-1];
+
+    /* Emplacement libre disponible : le suivant est rangé dans ses deux premières valeurs */
+    if (offset != FREE_END) {
+        memcpy(&store->free_lists[classe-1], &store->pool[offset], sizeof(uint32_t));
+        return offset;
+    }
+
+    /* Sinon on étend le pool, par pas de 25% pour limiter la mémoire inutilisée */
+    size_t taille = (size_t)classe*STORE_CLASS_SIZE;
+    if (store->pool_size + taille > store->pool_alloc) {
+        size_t nouvelle_taille = store->pool_alloc + store->pool_alloc/4;
+        if (nouvelle_taille < store->pool_size + taille) nouvelle_taille = store->pool_size + taille;
+        resize_pool(store, nouvelle_taille);
+    }
+    offset = (uint32_t)store->pool_size;
+    store->pool_size += taille;
+    return offset;
+}
+
+/*
+ * Fonction:  free_slot
+ * --------------------
+ * rend un emplacement du pool à la liste libre de sa classe.
+ *
+ *  store  : stockage compact
+ *  offset : position de l'emplacement
+ *  classe : classe de taille de l'emplacement
+ *
+ */
+static void free_slot(coeff_store_t* store, uint32_t offset, uint8_t classe)
+{
+    memcpy(&store->pool[offset], &store->free_lists[classe-1], sizeof(uint32_t));
+    store->free_lists[classe-1] = offset;
+}
+
+/*
+ * Fonction:  expand_bloc
+ * --------------------
+ * développe un bloc compact sous forme dense (ordre naturel).
+ *
+ *  store : stockage compact
+ *  index : index du bloc dans la composante
+ *  mask  : masque zig-zag des coefficients non nuls du bloc
+ *  bloc  : bloc dense de destination, supposé nul
+ *
+ */
+void expand_bloc(const coeff_store_t* store, size_t index, uint64_t mask, int16_t* bloc)
+{
+    const int16_t* valeurs = &store->pool[store->offsets[index]];
+    for (size_t k=0; mask; k++, mask &= mask-1)
+        bloc[EQUIV_ZZ[__builtin_ctzll(mask)]] = valeurs[k];
+}
+
+/*
+ * Fonction:  pack_bloc
+ * --------------------
+ * range les coefficients non nuls d'un bloc dense dans le stockage
+ * compact, puis remet le bloc dense à zéro.
+ *
+ *  store : stockage compact
+ *  index : index du bloc dans la composante
+ *  mask  : masque zig-zag des coefficients non nuls du bloc
+ *  bloc  : bloc dense (ordre naturel)
+ *
+ * Remarque : les coefficients d'un bloc ne redeviennent jamais nuls,
+ * l'emplacement d'un bloc ne fait donc que grandir.
+ */
+void pack_bloc(coeff_store_t* store, size_t index, uint64_t mask, int16_t* bloc)
+{
+    uint8_t nb_valeurs = (uint8_t)__builtin_popcountll(mask);
+    if (nb_valeurs == 0) return;
+
+    /* Plus petite classe pouvant contenir le bloc */
+    uint8_t classe = (nb_valeurs + STORE_CLASS_SIZE - 1)/STORE_CLASS_SIZE;
+
+    if (classe != store->classes[index]) {
+        uint32_t offset = alloc_slot(store, classe);
+        if (store->classes[index] != 0)
+            free_slot(store, store->offsets[index], store->classes[index]);
+        store->offsets[index] = offset;
+        store->classes[index] = classe;
+    }
+
+    int16_t* valeurs = &store->pool[store->offsets[index]];
+    for (size_t k=0; mask; k++, mask &= mask-1) {
+        uint8_t c_i = EQUIV_ZZ[__builtin_ctzll(mask)];
+        valeurs[k] = bloc[c_i];
+        bloc[c_i]  = 0;
+    }
+}
+
+/* Comparaison de deux entiers 64 bits (qsort) */
+static int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Fonction:  compact_coeff_store
+ * --------------------
+ * supprime les emplacements libérés du pool en faisant glisser
+ * les blocs vers son début (à appeler en fin de scan).
+ *
+ *  store : stockage compact
+ *
+ */
+void compact_coeff_store(coeff_store_t* store)
+{
+    /* Blocs non vides triés par position dans le pool : (position << 32) | index */
+    size_t    nb_pleins = 0;
+    uint64_t* ordre = malloc(sizeof(uint64_t)*store->num_blocs);
+    for (size_t i=0; i<store->num_blocs; i++)
+        if (store->classes[i] != 0) ordre[nb_pleins++] = ((uint64_t)store->offsets[i] << 32) | i;
+    qsort(ordre, nb_pleins, sizeof(uint64_t), compare_u64);
+
+    /* Les emplacements occupés glissent vers le début, les trous disparaissent */
+    size_t fin = 0;
+    for (size_t k=0; k<nb_pleins; k++) {
+        uint32_t i = (uint32_t)ordre[k];
+        size_t   taille = (size_t)store->classes[i]*STORE_CLASS_SIZE;
+        memmove(&store->pool[fin], &store->pool[store->offsets[i]], sizeof(int16_t)*taille);
+        store->offsets[i] = (uint32_t)fin;
+        fin += taille;
+    }
+    free(ordre);
+
+    store->pool_size = fin;
+    for (size_t k=0; k<STORE_NB_CLASSES; k++)
+        store->free_lists[k] = FREE_END;
+}
+
+/*
+ * Fonction:  coeff_store_bytes
+ * --------------------
+ * renvoie la mémoire maximale occupée par un stockage compact, en octets.
+ *
+ *  store : stockage compact
+ *
+ */
+size_t coeff_store_bytes(const coeff_store_t* store)
+{
+    return sizeof(coeff_store_t) + store->peak_alloc*sizeof(int16_t)
+         + store->num_blocs*(sizeof(uint32_t) + sizeof(uint8_t));
+}
@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "cpu_dispatch.h"
+#include "jpeg_const.h"
+#include "idct.h"
+#include "loeffler.h"
+#include "loeffler_simd.h"
+#include "export_ppm.h"
+#include "upsampling.h"
+
+/*
+    Répartition des noyaux de calcul : le niveau de jeu d'instructions du
+    processeur est lu une seule fois (cpuid) au démarrage, puis chaque noyau
+    chaud est lié à sa meilleure version pour ce niveau. Un niveau sans
+    version dédiée d'un noyau reprend celle du niveau inférieur, jusqu'à la
+    version scalaire.
+*/
+
+/* Noms des niveaux (option -cpu= et variable JPEG2PPM_CPU) */
+static const char* NOMS_NIVEAUX[CPU_AUTO] = {"scalar", "sse2", "sse4", "avx2", "avx512"};
+
+/* Noyaux liés par cpu_dispatch_init */
+struct cpu_kernels KERNELS;
+
+
+/*
+ * Fonction:  cpu_detect
+ * --------------------
+ * renvoie le niveau de jeu d'instructions le plus étendu dont dispose
+ * le processeur (et que le système d'exploitation autorise)
+ *
+ */
+enum cpu_tier cpu_detect(void)
+{
+    enum cpu_tier tier = CPU_SCALAR;
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        tier = CPU_SSE2;
+        if (__builtin_cpu_supports("sse4.1")) {
+            tier = CPU_SSE4;
+            if (__builtin_cpu_supports("avx2")) {
+                tier = CPU_AVX2;
+                if (__builtin_cpu_supports("avx512f")) tier = CPU_AVX512;
+            }
+        }
+    }
+#endif
+
+    return tier;
+}
+
+/*
+ * Fonction:  cpu_tier_from_name
+ * --------------------
+ * renvoie le niveau de jeu d'instructions désigné par [nom]
+ * ("auto" pour le niveau détecté)
+ *
+ *  nom : nom du niveau (scalar, sse2, sse4, avx2, avx512 ou auto)
+ */
+enum cpu_tier cpu_tier_from_name(const char *nom)
+{
+    if (!strcmp(nom, "auto")) return CPU_AUTO;
+
+    for (enum cpu_tier tier = CPU_SCALAR; tier < CPU_AUTO; tier++) {
+        if (!strcmp(nom, NOMS_NIVEAUX[tier])) return tier;
+    }
+
+    EXIT_ERROR("cpu_dispatch", "Niveau de jeu d'instructions inconnu : %s", nom);
+}
+
+/*
+ * Fonction:  cpu_tier_name
+ * --------------------
+ * renvoie le nom d'un niveau de jeu d'instructions
+ *
+ *  tier : niveau de jeu d'instructions
+ */
+const char *cpu_tier_name(enum cpu_tier tier)
+{
+    return (tier < CPU_AUTO) ? NOMS_NIVEAUX[tier] : "auto";
+}
+
+/*
+ * Fonction:  cpu_dispatch_init
+ * --------------------
+ * lie les noyaux de KERNELS au niveau [tier] : iDCT (moteur de l'option
+ * -idct=, le Loeffler flottant étant vectorisé selon le niveau, par lots
+ * de blocs en AVX2 et AVX-512),
+ * conversions YCbCr -> RGB et RGBX/BGRA et doublement de pixels de l'upsampling.
+ *
+ *  tier : niveau imposé, ou CPU_AUTO pour le niveau détecté
+ */
+void cpu_dispatch_init(enum cpu_tier tier)
+{
+    enum cpu_tier detecte = cpu_detect();
+
+    if (tier == CPU_AUTO) {
+        tier = detecte;
+    } else if (tier > detecte) {
+        EXIT_ERROR("cpu_dispatch", "Niveau %s non supporté par ce processeur (niveau détecté : %s)",
+                   cpu_tier_name(tier), cpu_tier_name(detecte));
+    }
+    KERNELS.tier = tier;
+
+    /* iDCT : moteur de l'option -idct=, le Loeffler flottant suivant le niveau */
+    if (P_IDCT == IDCT_FLOAT) {
+        KERNELS.idct = (tier >= CPU_AVX2) ? loeffler_idct_avx2 :
+                       ((tier >= CPU_SSE2) ? loeffler_idct_sse2 : loeffler_idct_loeffler);
+    } else if (tier < IDCT_ENGINES[P_IDCT].niveau) {
+        EXIT_ERROR("cpu_dispatch", "iDCT %s indisponible au niveau %s", IDCT_ENGINES[P_IDCT].nom, cpu_tier_name(tier));
+    } else {
+        KERNELS.idct = IDCT_ENGINES[P_IDCT].idct;
+    }
+
+    /* iDCT par lots (un bloc par voie) : Loeffler flottant en pleine résolution seulement */
+    KERNELS.idct_lot = NULL;
+    KERNELS.voies    = 1;
+    if (P_IDCT == IDCT_FLOAT && P_SCALE == 1 && tier >= CPU_AVX2) {
+        KERNELS.idct_lot = (tier >= CPU_AVX512) ? loeffler_idct_lot_avx512 : loeffler_idct_lot_avx2;
+        KERNELS.voies    = (tier >= CPU_AVX512) ? 16 : 8;
+    }
+
+    /* Conversion YCbCr -> RGB et upsampling */
+    KERNELS.ycbcr_rgb     = (tier >= CPU_AVX2) ? ycbcr_to_rgb_ligne_avx2 :
+                            ((tier >= CPU_SSE4) ? ycbcr_to_rgb_ligne_sse4 : ycbcr_to_rgb_ligne);
+    KERNELS.ycbcr_rgbx    = (tier >= CPU_AVX2) ? ycbcr_to_rgbx_ligne_avx2 :
+                            ((tier >= CPU_SSE4) ? ycbcr_to_rgbx_ligne_sse4 : ycbcr_to_rgbx_ligne);
+    KERNELS.double_pixels = (tier >= CPU_SSE2) ? double_pixels_sse2 : double_pixels;
+
+    INFO_MSG("* Noyaux : niveau %s (détecté : %s)\n", cpu_tier_name(tier), cpu_tier_name(detecte));
+}
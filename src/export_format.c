@@ -0,0 +1,904 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "export_format.h"
+#include "jpeg_const.h"
+#include "jpeg_reader.h"
+#include "extract_image.h"
+#include "upsampling.h"
+#include "cpu_dispatch.h"
+
+/*
+    Formats de pixels de sortie : RGB (PPM), RGBX/BGRA entrelacés, issus de
+    la conversion YCbCr -> RGB fusionnée au suréchantillonnage, et YUV
+    planaires (I420, NV12, 4:4:4), écrits directement depuis les
+    composantes décodées sans passer par RGB. Les chrominances 4:2:0 d'une
+    image déjà échantillonnée en h2v2 sont recopiées sans
+    suréchantillonnage. Les pixels sont produits ligne par ligne, plan
+    par plan, sans image de sortie complète en mémoire : directement dans
+    un tampon fourni par l'appelant (pas de ligne quelconque, voir
+    decode_to_buffer), ou dans un fichier par grands blocs de lignes
+    écrits à leur position (pwrite). Avec l'option -m, chaque plan est
+    découpé en bandes produites et écrites en parallèle.
+
+    Les sorties tenseur (nchw, nhwc) donnent les canaux R, G, B en uint8 ou
+    en float32, normalisés par canal ((v/255 - mean)/std) au moment de la
+    conversion de chaque ligne : une table de 256 valeurs par canal remplace
+    le calcul. Elles peuvent être précédées d'un en-tête .npy.
+
+    Si l'image porte des statistiques à remplir (image8_t.stats), chaque
+    ligne produite est comptée dans les histogrammes de ses canaux tant
+    qu'elle est en cache, chaque bande dans les siens ; sommes, moyennes et
+    extrêmes s'en déduisent exactement une fois toutes les lignes produites.
+*/
+
+/* Noms des formats (option -format=) et extensions des fichiers de sortie */
+static const char* NOMS_FORMATS[FMT_NB] = {"rgb", "rgbx", "bgra", "i420", "nv12", "yuv444", "nchw", "nhwc"};
+static const char* EXTENSIONS[FMT_NB]   = {"ppm", "rgbx", "bgra", "yuv", "yuv", "yuv", "raw", "raw"};
+
+/* Chrominance neutre (images en niveaux de gris) */
+#define CHROMA_NEUTRE 128
+
+/* Nombre maximal de bandes produites en parallèle (option -m) */
+#define EXPORT_BANDES_MAX 16
+
+/* Taille visée des écritures dans un fichier en octets */
+#define EXPORT_ECRITURE (1 << 20)
+
+/* Contenu d'un plan de sortie */
+enum contenu_plan { PLAN_RGB, PLAN_RGBX, PLAN_BGRA, PLAN_Y, PLAN_U, PLAN_V, PLAN_U_420, PLAN_V_420, PLAN_UV_420,
+                   PLAN_NHWC, PLAN_NCHW };
+
+/* Plan de sortie : lignes de même contenu, à intervalle régulier dans la sortie
+   (un plan NCHW regroupe les trois canaux, produits ensemble ligne à ligne) */
+typedef struct
+{
+    enum contenu_plan contenu;
+    size_t            canaux;   // Nombre de canaux, plans consécutifs de même taille
+    size_t            ecart;    // Ecart entre deux canaux en octets
+    size_t            lignes;   // Nombre de lignes
+    size_t            taille;   // Taille utile d'une ligne en octets
+    size_t            pas;      // Ecart entre deux lignes en octets
+    size_t            debut;    // Position de la première ligne dans la sortie
+} plan_t;
+
+/* Lecture ligne à ligne des composantes, propre à chaque bande */
+typedef struct
+{
+    upsampler_t* y;        // Luminance
+    upsampler_t* cb;       // Chrominances (NULL en niveaux de gris ou avec -luma)
+    upsampler_t* cr;
+    uint8_t*     neutre;   // Ligne de chrominance neutre (niveaux de gris)
+    uint8_t*     tampon;   // Ligne de travail (moyennes 4:2:0)
+    uint8_t*     rgb;      // Ligne convertie en RGB (tenseurs)
+    float        normalise[3][256]; // Valeurs normalisées des canaux (tenseurs float32)
+    image_stats_t* stats;  // Statistiques de la bande (NULL : non calculées)
+    size_t       largeur;  // Dimensions de l'image de sortie
+    size_t       hauteur;
+} lecteur_t;
+
+/* Destination des pixels : tampon de l'appelant ou fichier */
+typedef struct
+{
+    uint8_t* dest;     // Tampon de l'appelant (NULL : fichier)
+    FILE*    fichier;  // Fichier de sortie
+    int      fd;       // Descripteur du fichier (-1 : non positionnable, écriture séquentielle)
+    off_t    origine;  // Position des pixels dans le fichier (après l'en-tête)
+} destination_t;
+
+/* Bande de la sortie produite par un thread */
+typedef struct
+{
+    pthread_t            thread;
+    image8_t*            image;
+    struct jpeg_desc*    jdesc;
+    const plan_t*        plans;
+    size_t               nb_plans;
+    const destination_t* destination;
+    size_t               indice;    // Numéro de la bande
+    size_t               nb_bandes; // Nombre de bandes
+    image_stats_t*       stats;     // Statistiques de la bande (NULL : non calculées)
+} bande_t;
+
+
+/*
+ * Fonction:  format_from_name
+ * --------------------
+ * renvoie le format de pixels désigné par [nom]
+ *
+ *  nom : nom du format (rgb, rgbx, bgra, i420, nv12, yuv444, nchw ou nhwc)
+ */
+enum pixel_format format_from_name(const char *nom)
+{
+    for (enum pixel_format format = FMT_RGB; format < FMT_NB; format++) {
+        if (!strcmp(nom, NOMS_FORMATS[format])) return format;
+    }
+
+    EXIT_ERROR("export_format", "Format de sortie inconnu : %s", nom);
+}
+
+/*
+ * Fonction:  format_extension
+ * --------------------
+ * renvoie l'extension par défaut des fichiers d'un format de pixels
+ * (npy pour un tenseur avec l'option -npy)
+ *
+ *  format : format de pixels
+ */
+const char *format_extension(enum pixel_format format)
+{
+    if (P_NPY) return "npy";
+
+    return EXTENSIONS[format];
+}
+
+/*
+ * Fonction:  decoupe_plans
+ * --------------------
+ * décrit les plans d'un format de pixels : contenu, nombre et taille des
+ * lignes, position dans la sortie. Les plans se suivent ; les plans U et
+ * V de I420 prennent un pas moitié (voir format_chroma_stride). Avec un
+ * pas nul, les lignes de chaque plan sont contiguës (fichiers). Renvoie
+ * le nombre de plans.
+ *
+ *  format  : format de pixels
+ *  largeur : largeur de l'image en pixels
+ *  hauteur : hauteur de l'image en pixels
+ *  pas     : écart entre deux lignes (de luminance) en octets, 0 : contiguës
+ *  plans   : plans décrits (au plus 3)
+ */
+static size_t decoupe_plans(enum pixel_format format, size_t largeur, size_t hauteur, size_t pas, plan_t plans[3])
+{
+    size_t demi_largeur = (largeur + 1)/2,
+           demi_hauteur = (hauteur + 1)/2,
+           pas_chroma   = format_chroma_stride(format, pas),
+           element      = (P_DTYPE == DTYPE_FLOAT32) ? sizeof(float) : sizeof(uint8_t),
+           nb_plans;
+
+    switch (format) {
+    case FMT_RGB:
+        plans[0] = (plan_t) {PLAN_RGB, 1, 0, hauteur, 3*largeur, pas, 0};
+        nb_plans = 1;
+        break;
+    case FMT_RGBX:
+        plans[0] = (plan_t) {PLAN_RGBX, 1, 0, hauteur, 4*largeur, pas, 0};
+        nb_plans = 1;
+        break;
+    case FMT_BGRA:
+        plans[0] = (plan_t) {PLAN_BGRA, 1, 0, hauteur, 4*largeur, pas, 0};
+        nb_plans = 1;
+        break;
+    case FMT_YUV444:
+        plans[0] = (plan_t) {PLAN_Y, 1, 0, hauteur, largeur, pas, 0};
+        plans[1] = (plan_t) {PLAN_U, 1, 0, hauteur, largeur, pas, 0};
+        plans[2] = (plan_t) {PLAN_V, 1, 0, hauteur, largeur, pas, 0};
+        nb_plans = 3;
+        break;
+    case FMT_I420:
+        plans[0] = (plan_t) {PLAN_Y, 1, 0, hauteur,      largeur,      pas,        0};
+        plans[1] = (plan_t) {PLAN_U_420, 1, 0, demi_hauteur, demi_largeur, pas_chroma, 0};
+        plans[2] = (plan_t) {PLAN_V_420, 1, 0, demi_hauteur, demi_largeur, pas_chroma, 0};
+        nb_plans = 3;
+        break;
+    case FMT_NV12:
+        plans[0] = (plan_t) {PLAN_Y, 1, 0, hauteur,      largeur,        pas, 0};
+        plans[1] = (plan_t) {PLAN_UV_420, 1, 0, demi_hauteur, 2*demi_largeur, pas, 0};
+        nb_plans = 2;
+        break;
+    case FMT_NCHW:
+        plans[0] = (plan_t) {PLAN_NCHW, 3, 0, hauteur, element*largeur, pas, 0};
+        nb_plans = 1;
+        break;
+    case FMT_NHWC:
+        plans[0] = (plan_t) {PLAN_NHWC, 1, 0, hauteur, 3*element*largeur, pas, 0};
+        nb_plans = 1;
+        break;
+    default:
+        EXIT_ERROR("export_format", "Format de sortie invalide : %d", format);
+    }
+
+    /* Plans (et canaux) successifs, lignes contiguës si aucun pas n'est imposé */
+    for (size_t p = 0; p < nb_plans; p++) {
+        if (pas == 0) plans[p].pas = plans[p].taille;
+        plans[p].ecart = plans[p].lignes*plans[p].pas;
+        if (p > 0) plans[p].debut = plans[p-1].debut + plans[p-1].canaux*plans[p-1].ecart;
+    }
+
+    return nb_plans;
+}
+
+/*
+ * Fonction:  format_min_stride
+ * --------------------
+ * renvoie le plus petit écart possible entre deux lignes (de luminance
+ * pour les formats planaires) d'une image de [largeur] pixels
+ *
+ *  format  : format de pixels
+ *  largeur : largeur de l'image en pixels
+ */
+size_t format_min_stride(enum pixel_format format, size_t largeur)
+{
+    plan_t plans[3];
+    decoupe_plans(format, largeur, 0, 0, plans);
+
+    /* NV12 : la ligne UV dépasse d'un octet une ligne de largeur impaire */
+    return (format == FMT_NV12) ? plans[1].taille : plans[0].taille;
+}
+
+/*
+ * Fonction:  format_chroma_stride
+ * --------------------
+ * renvoie l'écart entre deux lignes des plans de chrominance d'un format
+ * planaire, pour un écart [pas] entre deux lignes de luminance
+ *
+ *  format : format de pixels
+ *  pas    : écart entre deux lignes de luminance en octets
+ */
+size_t format_chroma_stride(enum pixel_format format, size_t pas)
+{
+    return (format == FMT_I420) ? (pas + 1)/2 : pas;
+}
+
+/*
+ * Fonction:  format_buffer_size
+ * --------------------
+ * renvoie la taille en octets du tampon qui reçoit une image de
+ * [largeur]x[hauteur] pixels avec des lignes espacées de [pas] octets
+ * (voir export_buffer)
+ *
+ *  format  : format de pixels
+ *  largeur : largeur de l'image en pixels
+ *  hauteur : hauteur de l'image en pixels
+ *  pas     : écart entre deux lignes en octets
+ */
+size_t format_buffer_size(enum pixel_format format, size_t largeur, size_t hauteur, size_t pas)
+{
+    plan_t plans[3];
+    const plan_t* dernier = &plans[decoupe_plans(format, largeur, hauteur, pas, plans) - 1];
+
+    return dernier->debut + dernier->canaux*dernier->ecart;
+}
+
+/*
+ * Fonction:  create_lecteur
+ * --------------------
+ * prépare la lecture ligne à ligne des composantes d'une image
+ *
+ *  jpeg_image : image JPEG à exporter, couleur ou grayscale
+ *  jdesc      : descripteur de l'image JPEG
+ */
+static lecteur_t create_lecteur(image8_t* jpeg_image, struct jpeg_desc *jdesc)
+{
+    lecteur_t lecteur;
+
+    /* Dimensions de l'image en pixel (réduites avec l'option -scale=, échangées par une rotation) */
+    lecteur.largeur = get_oriented_size(jdesc, DIR_H);
+    lecteur.hauteur = get_oriented_size(jdesc, DIR_V);
+
+    /* Chrominances absentes (niveaux de gris, option -luma) : ligne neutre.
+     * L'orientation (option -orient=) est faite par la lecture des composantes */
+    bool chroma = (jpeg_image->cb_blocs != NULL);
+    size_t largeur = get_output_size(jdesc, DIR_H), hauteur = get_output_size(jdesc, DIR_V);
+    lecteur.y  = create_upsampler(jpeg_image, jdesc, COMP_Y, largeur, hauteur, P_ORIENTATION);
+    lecteur.cb = chroma ? create_upsampler(jpeg_image, jdesc, COMP_Cb, largeur, hauteur, P_ORIENTATION) : NULL;
+    lecteur.cr = chroma ? create_upsampler(jpeg_image, jdesc, COMP_Cr, largeur, hauteur, P_ORIENTATION) : NULL;
+    lecteur.neutre = NULL;
+    if (!chroma) {
+        lecteur.neutre = malloc(lecteur.largeur*sizeof(uint8_t));
+        memset(lecteur.neutre, CHROMA_NEUTRE, lecteur.largeur);
+    }
+    lecteur.tampon = malloc(lecteur.largeur*sizeof(uint8_t));
+    lecteur.rgb    = malloc(3*lecteur.largeur*sizeof(uint8_t));
+    lecteur.stats  = NULL;
+
+    /* Normalisation des tenseurs float32 : (v/255 - mean)/std pour chaque valeur */
+    for (size_t c = 0; c < 3; c++)
+    for (size_t v = 0; v < 256; v++) {
+        lecteur.normalise[c][v] = ((float) v/255.0f - P_MEAN[c])/P_STD[c];
+    }
+
+    return lecteur;
+}
+
+/*
+ * Fonction:  free_lecteur
+ * --------------------
+ * libère une lecture ligne à ligne des composantes
+ *
+ *  lecteur : lecture à libérer
+ */
+static void free_lecteur(lecteur_t* lecteur)
+{
+    free_upsampler(lecteur->y);
+    if (lecteur->cb) free_upsampler(lecteur->cb);
+    if (lecteur->cr) free_upsampler(lecteur->cr);
+    free(lecteur->neutre);
+    free(lecteur->tampon);
+    free(lecteur->rgb);
+}
+
+/*
+ * Fonction:  chroma_420
+ * --------------------
+ * écrit une ligne de chrominance 4:2:0 (demi-largeur arrondie au-dessus).
+ * Une composante échantillonnée en h2v2 est recopiée telle quelle (ou
+ * transposée, mais sans miroir qui décalerait les paires de pixels) ; sinon,
+ * chaque pixel est la moyenne arrondie des 2x2 pixels correspondants à
+ * pleine résolution (répétés au bord droit et en bas).
+ *
+ *  up      : lecture ligne à ligne de la composante (NULL : chrominance neutre)
+ *  ligne   : numéro de la ligne de chrominance
+ *  largeur : largeur de l'image en pixels
+ *  hauteur : hauteur de l'image en pixels
+ *  tampon  : ligne de travail (largeur de l'image)
+ *  dest    : premier pixel de la ligne de sortie
+ *  pas     : écart entre deux pixels de sortie (2 pour NV12)
+ */
+static void chroma_420(upsampler_t* up, size_t ligne, size_t largeur, size_t hauteur,
+                       uint8_t* tampon, uint8_t* dest, size_t pas)
+{
+    size_t demi_largeur = (largeur + 1)/2;
+
+    if (up == NULL) {
+        /* Niveaux de gris : pas de chrominance */
+        for (size_t i = 0; i < demi_largeur; i++) dest[i*pas] = CHROMA_NEUTRE;
+    } else if (up->fh == 2 && up->fv == 2 && !up->inverse_lignes && !up->inverse_pixels) {
+        /* Déjà en 4:2:0 : recopie de la ligne de la composante */
+        const uint8_t* src = composante_ligne(up, ligne);
+        if (pas == 1) {
+            memcpy(dest, src, demi_largeur);
+        } else {
+            for (size_t i = 0; i < demi_largeur; i++) dest[i*pas] = src[i];
+        }
+    } else {
+        /* Moyenne des 2x2 pixels à pleine résolution (l'upsampler ne garde qu'une ligne) */
+        memcpy(tampon, upsample_ligne(up, 2*ligne), largeur);
+        const uint8_t* haut = tampon;
+        const uint8_t* bas  = upsample_ligne(up, (2*ligne + 1 < hauteur) ? 2*ligne + 1 : hauteur - 1);
+        for (size_t i = 0; i < demi_largeur; i++) {
+            size_t x0 = 2*i, x1 = (2*i + 1 < largeur) ? 2*i + 1 : largeur - 1;
+            dest[i*pas] = (haut[x0] + haut[x1] + bas[x0] + bas[x1] + 2) >> 2;
+        }
+    }
+}
+
+/*
+ * Fonction:  compte_canal
+ * --------------------
+ * ajoute les valeurs d'un canal à son histogramme
+ *
+ *  histogramme : histogramme du canal
+ *  valeurs     : première valeur du canal
+ *  nb          : nombre de valeurs
+ *  pas         : écart entre deux valeurs en octets
+ */
+static void compte_canal(uint64_t* histogramme, const uint8_t* valeurs, size_t nb, size_t pas)
+{
+    for (size_t i = 0; i < nb; i++) {
+        histogramme[valeurs[i*pas]]++;
+    }
+}
+
+/*
+ * Fonction:  compte_pixels
+ * --------------------
+ * ajoute des pixels entrelacés aux histogrammes de leurs trois canaux
+ *
+ *  histogrammes : histogrammes des canaux
+ *  pixels       : premier pixel
+ *  nb           : nombre de pixels
+ *  pas          : écart entre deux pixels en octets
+ *  r, g, b      : position des canaux dans un pixel (BGRA : 2, 1, 0)
+ */
+static void compte_pixels(uint64_t histogrammes[3][256], const uint8_t* pixels, size_t nb, size_t pas,
+                          size_t r, size_t g, size_t b)
+{
+    for (size_t i = 0; i < nb; i++, pixels += pas) {
+        histogrammes[0][pixels[r]]++;
+        histogrammes[1][pixels[g]]++;
+        histogrammes[2][pixels[b]]++;
+    }
+}
+
+/*
+ * Fonction:  compte_ligne
+ * --------------------
+ * ajoute une ligne d'un plan de sortie, juste produite, aux statistiques
+ * de la bande
+ *
+ *  lecteur : lecture ligne à ligne des composantes (statistiques de la bande)
+ *  contenu : contenu du plan
+ *  dest    : premier octet de la ligne produite
+ */
+static void compte_ligne(lecteur_t* lecteur, enum contenu_plan contenu, const uint8_t* dest)
+{
+    uint64_t (*histogrammes)[256] = lecteur->stats->histogramme;
+    size_t largeur = lecteur->largeur, demi_largeur = (largeur + 1)/2;
+
+    switch (contenu) {
+    case PLAN_RGB:    compte_pixels(histogrammes, dest, largeur, 3, 0, 1, 2); break;
+    case PLAN_RGBX:   compte_pixels(histogrammes, dest, largeur, 4, 0, 1, 2); break;
+    case PLAN_BGRA:   compte_pixels(histogrammes, dest, largeur, 4, 2, 1, 0); break;
+    case PLAN_Y:      compte_canal(histogrammes[0], dest, largeur, 1); break;
+    case PLAN_U:      compte_canal(histogrammes[1], dest, largeur, 1); break;
+    case PLAN_V:      compte_canal(histogrammes[2], dest, largeur, 1); break;
+    case PLAN_U_420:  compte_canal(histogrammes[1], dest, demi_largeur, 1); break;
+    case PLAN_V_420:  compte_canal(histogrammes[2], dest, demi_largeur, 1); break;
+    case PLAN_UV_420:
+        compte_canal(histogrammes[1], dest,     demi_largeur, 2);
+        compte_canal(histogrammes[2], dest + 1, demi_largeur, 2);
+        break;
+    case PLAN_NHWC:
+    case PLAN_NCHW:   compte_pixels(histogrammes, lecteur->rgb, largeur, 3, 0, 1, 2); break;
+    }
+}
+
+/*
+ * Fonction:  produit_ligne
+ * --------------------
+ * produit une ligne d'un plan de sortie (de chacun de ses canaux)
+ *
+ *  lecteur : lecture ligne à ligne des composantes
+ *  contenu : contenu du plan
+ *  ligne   : numéro de la ligne dans le plan
+ *  dest    : premier octet de la ligne de sortie (du premier canal)
+ *  ecart   : écart entre les lignes de deux canaux consécutifs en octets
+ */
+static void produit_ligne(lecteur_t* lecteur, enum contenu_plan contenu, size_t ligne, uint8_t* dest, size_t ecart)
+{
+    size_t largeur = lecteur->largeur, hauteur = lecteur->hauteur;
+
+    switch (contenu) {
+    case PLAN_RGB:
+    case PLAN_RGBX:
+    case PLAN_BGRA: {
+        /* Conversion YCbCr -> RGB */
+        const uint8_t *ly  = upsample_ligne(lecteur->y, ligne),
+                      *lcb = lecteur->cb ? upsample_ligne(lecteur->cb, ligne) : lecteur->neutre,
+                      *lcr = lecteur->cr ? upsample_ligne(lecteur->cr, ligne) : lecteur->neutre;
+        if (contenu == PLAN_RGB) {
+            KERNELS.ycbcr_rgb(ly, lcb, lcr, dest, largeur);
+        } else {
+            KERNELS.ycbcr_rgbx(ly, lcb, lcr, dest, largeur, contenu == PLAN_BGRA);
+        }
+        break;
+    }
+    case PLAN_Y:
+        memcpy(dest, upsample_ligne(lecteur->y, ligne), largeur);
+        break;
+    case PLAN_U:
+        memcpy(dest, lecteur->cb ? upsample_ligne(lecteur->cb, ligne) : lecteur->neutre, largeur);
+        break;
+    case PLAN_V:
+        memcpy(dest, lecteur->cr ? upsample_ligne(lecteur->cr, ligne) : lecteur->neutre, largeur);
+        break;
+    case PLAN_U_420:
+        chroma_420(lecteur->cb, ligne, largeur, hauteur, lecteur->tampon, dest, 1);
+        break;
+    case PLAN_V_420:
+        chroma_420(lecteur->cr, ligne, largeur, hauteur, lecteur->tampon, dest, 1);
+        break;
+    case PLAN_UV_420:
+        chroma_420(lecteur->cb, ligne, largeur, hauteur, lecteur->tampon, dest,     2);
+        chroma_420(lecteur->cr, ligne, largeur, hauteur, lecteur->tampon, dest + 1, 2);
+        break;
+    case PLAN_NHWC:
+    case PLAN_NCHW: {
+        /* Conversion YCbCr -> RGB de la ligne, puis rangement des canaux */
+        const uint8_t* rgb = lecteur->rgb;
+        KERNELS.ycbcr_rgb(upsample_ligne(lecteur->y, ligne),
+                          lecteur->cb ? upsample_ligne(lecteur->cb, ligne) : lecteur->neutre,
+                          lecteur->cr ? upsample_ligne(lecteur->cr, ligne) : lecteur->neutre,
+                          lecteur->rgb, largeur);
+        if (P_DTYPE == DTYPE_UINT8) {
+            if (contenu == PLAN_NHWC) {
+                memcpy(dest, rgb, 3*largeur);
+            } else {
+                for (size_t i = 0; i < largeur; i++) {
+                    dest[i]           = rgb[3*i];
+                    dest[ecart + i]   = rgb[3*i + 1];
+                    dest[2*ecart + i] = rgb[3*i + 2];
+                }
+            }
+        } else {
+            /* float32 normalisés, destination pas forcément alignée */
+            if (contenu == PLAN_NHWC) {
+                for (size_t i = 0; i < 3*largeur; i++) {
+                    memcpy(&dest[i*sizeof(float)], &lecteur->normalise[i%3][rgb[i]], sizeof(float));
+                }
+            } else {
+                for (size_t c = 0; c < 3; c++) {
+                    const float* normalise = lecteur->normalise[c];
+                    uint8_t* canal = &dest[c*ecart];
+                    for (size_t i = 0; i < largeur; i++) {
+                        memcpy(&canal[i*sizeof(float)], &normalise[rgb[3*i + c]], sizeof(float));
+                    }
+                }
+            }
+        }
+        break;
+    }
+    }
+
+    if (lecteur->stats != NULL) compte_ligne(lecteur, contenu, dest);
+}
+
+/*
+ * Fonction:  ecrit_lignes
+ * --------------------
+ * écrit un bloc de lignes consécutives dans le fichier de sortie, à sa
+ * position (pwrite), ou à la suite si le fichier n'est pas positionnable
+ *
+ *  destination : fichier de sortie
+ *  lignes      : lignes à écrire
+ *  taille      : taille du bloc en octets
+ *  position    : position du bloc dans les pixels de la sortie
+ */
+static void ecrit_lignes(const destination_t* destination, const uint8_t* lignes, size_t taille, size_t position)
+{
+    if (destination->fd < 0) {
+        if (fwrite(lignes, sizeof(uint8_t), taille, destination->fichier) != taille)
+            EXIT_ERROR("export_format", "Echec de l'écriture du fichier de sortie");
+        return;
+    }
+
+    while (taille > 0) {
+        ssize_t ecrits = pwrite(destination->fd, lignes, taille, destination->origine + (off_t) position);
+        if (ecrits <= 0)
+            EXIT_ERROR("export_format", "Echec de l'écriture du fichier de sortie");
+        lignes   += ecrits;
+        taille   -= ecrits;
+        position += ecrits;
+    }
+}
+
+/*
+ * Fonction:  produit_bande
+ * --------------------
+ * produit une bande de la sortie : la même part des lignes de chaque plan.
+ * Dans un tampon, les lignes sont produites en place ; dans un fichier,
+ * elles sont rassemblées par blocs d'environ EXPORT_ECRITURE octets,
+ * chacun écrit d'un seul appel.
+ *
+ *  arg : bande à produire (bande_t)
+ */
+static void* produit_bande(void* arg)
+{
+    bande_t* bande = (bande_t*) arg;
+    const destination_t* destination = bande->destination;
+    lecteur_t lecteur = create_lecteur(bande->image, bande->jdesc);
+    lecteur.stats = bande->stats;
+    uint8_t* bloc = NULL;
+
+    for (size_t p = 0; p < bande->nb_plans; p++) {
+        const plan_t* plan = &bande->plans[p];
+        size_t premiere = plan->lignes*bande->indice/bande->nb_bandes,
+               fin      = plan->lignes*(bande->indice + 1)/bande->nb_bandes;
+
+        if (destination->dest != NULL) {
+            for (size_t ligne = premiere; ligne < fin; ligne++) {
+                produit_ligne(&lecteur, plan->contenu, ligne, destination->dest + plan->debut + ligne*plan->pas, plan->ecart);
+            }
+            continue;
+        }
+
+        /* Fichier : lignes contiguës (pas = taille), écrites par blocs, un par canal */
+        size_t par_bloc = (plan->taille < EXPORT_ECRITURE) ? EXPORT_ECRITURE/plan->taille : 1,
+               canal    = par_bloc*plan->taille;
+        bloc = realloc(bloc, plan->canaux*canal*sizeof(uint8_t));
+        for (size_t ligne = premiere; ligne < fin; ligne += par_bloc) {
+            size_t nb = (fin - ligne < par_bloc) ? fin - ligne : par_bloc;
+            for (size_t l = 0; l < nb; l++) {
+                produit_ligne(&lecteur, plan->contenu, ligne + l, &bloc[l*plan->taille], canal);
+            }
+            for (size_t c = 0; c < plan->canaux; c++) {
+                ecrit_lignes(destination, &bloc[c*canal], nb*plan->taille, plan->debut + c*plan->ecart + ligne*plan->pas);
+            }
+        }
+    }
+
+    free(bloc);
+    free_lecteur(&lecteur);
+
+    return NULL;
+}
+
+/*
+ * Fonction:  termine_stats
+ * --------------------
+ * déduit des histogrammes le nombre de valeurs, la somme, la moyenne et
+ * les extrêmes de chaque canal
+ *
+ *  stats : statistiques dont les histogrammes sont remplis
+ */
+static void termine_stats(image_stats_t* stats)
+{
+    for (size_t c = 0; c < 3; c++) {
+        stats->nb[c] = 0; stats->somme[c] = 0;
+        stats->min[c] = 0; stats->max[c] = 0;
+        for (size_t v = 0; v < 256; v++) {
+            uint64_t nb = stats->histogramme[c][v];
+            if (nb == 0) continue;
+            if (stats->nb[c] == 0) stats->min[c] = v;
+            stats->max[c]    = v;
+            stats->nb[c]    += nb;
+            stats->somme[c] += nb*v;
+        }
+        stats->moyenne[c] = stats->nb[c] ? (double) stats->somme[c]/stats->nb[c] : 0.0;
+    }
+    stats->nb_canaux = (stats->nb[1] == 0) ? 1 : 3;
+}
+
+/*
+ * Fonction:  produit_plans
+ * --------------------
+ * produit tous les plans d'une sortie : en une seule bande, ou avec
+ * l'option -m en une bande par coeur (au plus EXPORT_BANDES_MAX), chacune
+ * sur son propre thread avec sa propre lecture des composantes. Les
+ * statistiques de l'image, si elle en demande, réunissent celles des bandes.
+ *
+ *  jpeg_image  : image JPEG à exporter, couleur ou grayscale
+ *  jdesc       : descripteur de l'image JPEG
+ *  plans       : plans de la sortie
+ *  nb_plans    : nombre de plans
+ *  destination : tampon ou fichier de sortie
+ */
+static void produit_plans(image8_t* jpeg_image, struct jpeg_desc *jdesc, const plan_t* plans, size_t nb_plans,
+                          const destination_t* destination)
+{
+    size_t nb_bandes = 1;
+    if (P_MULTITHREAD && (destination->dest != NULL || destination->fd >= 0)) {
+        long coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+        nb_bandes = (coeurs < 1) ? 1 : ((coeurs > EXPORT_BANDES_MAX) ? EXPORT_BANDES_MAX : (size_t) coeurs);
+        if (nb_bandes > plans[0].lignes) nb_bandes = plans[0].lignes;
+        if (nb_bandes == 0) nb_bandes = 1;
+    }
+
+    /* Statistiques : celles de l'image pour une seule bande, propres à chaque bande sinon */
+    image_stats_t* stats = jpeg_image->stats;
+    if (stats != NULL) memset(stats, 0, sizeof(image_stats_t));
+
+    bande_t bandes[EXPORT_BANDES_MAX];
+    for (size_t i = 0; i < nb_bandes; i++) {
+        image_stats_t* stats_bande = (stats == NULL || nb_bandes == 1) ? stats : calloc(1, sizeof(image_stats_t));
+        bandes[i] = (bande_t) {0, jpeg_image, jdesc, plans, nb_plans, destination, i, nb_bandes, stats_bande};
+    }
+
+    if (nb_bandes == 1) {
+        produit_bande(&bandes[0]);
+    } else {
+        for (size_t i = 0; i < nb_bandes; i++) {
+            pthread_create(&bandes[i].thread, NULL, produit_bande, (void*) &bandes[i]);
+        }
+        for (size_t i = 0; i < nb_bandes; i++) {
+            pthread_join(bandes[i].thread, NULL);
+        }
+    }
+
+    if (stats == NULL) return;
+    if (nb_bandes > 1) {
+        for (size_t i = 0; i < nb_bandes; i++) {
+            for (size_t c = 0; c < 3; c++)
+            for (size_t v = 0; v < 256; v++) {
+                stats->histogramme[c][v] += bandes[i].stats->histogramme[c][v];
+            }
+            free(bandes[i].stats);
+        }
+    }
+    termine_stats(stats);
+}
+
+/*
+ * Fonction:  export_plans
+ * --------------------
+ * écrit les plans d'une sortie dans un fichier, à la suite de ce qui y est
+ * déjà écrit (en-tête) : par positions calculées si le fichier est
+ * positionnable, à la suite sinon (tube, sortie standard)
+ *
+ *  jpeg_image : image JPEG à exporter, couleur ou grayscale
+ *  jdesc      : descripteur de l'image JPEG
+ *  plans      : plans de la sortie (lignes contiguës)
+ *  nb_plans   : nombre de plans
+ *  fichier    : fichier de sortie
+ */
+static void export_plans(image8_t* jpeg_image, struct jpeg_desc *jdesc, const plan_t* plans, size_t nb_plans, FILE* fichier)
+{
+    destination_t destination = {NULL, fichier, -1, 0};
+
+    fflush(fichier);
+    destination.origine = ftello(fichier);
+    if (destination.origine >= 0) destination.fd = fileno(fichier);
+
+    produit_plans(jpeg_image, jdesc, plans, nb_plans, &destination);
+
+    /* Position du flux après les pixels écrits par pwrite */
+    if (destination.fd >= 0) {
+        const plan_t* dernier = &plans[nb_plans - 1];
+        fseeko(fichier, destination.origine + (off_t) (dernier->debut + dernier->canaux*dernier->ecart), SEEK_SET);
+    }
+}
+
+/*
+ * Fonction:  export_pixels
+ * --------------------
+ * écrit les pixels d'une image dans un fichier, sans en-tête : lignes
+ * entrelacées (RGB, RGBX, BGRA, tenseur NHWC) ou plans successifs (Y puis
+ * U et V pour I420 et YUV444, Y puis UV entrelacés pour NV12, R, G puis B
+ * pour un tenseur NCHW)
+ *
+ *  jpeg_image : image JPEG à exporter, couleur ou grayscale
+ *  jdesc      : descripteur de l'image JPEG
+ *  format     : format de pixels
+ *  fichier    : fichier de sortie
+ */
+void export_pixels(image8_t* jpeg_image, struct jpeg_desc *jdesc, enum pixel_format format, FILE* fichier)
+{
+    size_t largeur = get_oriented_size(jdesc, DIR_H),
+           hauteur = get_oriented_size(jdesc, DIR_V);
+
+    plan_t plans[3];
+    size_t nb_plans = decoupe_plans(format, largeur, hauteur, 0, plans);
+
+    export_plans(jpeg_image, jdesc, plans, nb_plans, fichier);
+}
+
+/*
+ * Fonction:  export_luminance
+ * --------------------
+ * écrit le plan de luminance d'une image dans un fichier, sans en-tête
+ *
+ *  jpeg_image : image JPEG à exporter, couleur ou grayscale
+ *  jdesc      : descripteur de l'image JPEG
+ *  fichier    : fichier de sortie
+ */
+void export_luminance(image8_t* jpeg_image, struct jpeg_desc *jdesc, FILE* fichier)
+{
+    size_t largeur = get_oriented_size(jdesc, DIR_H),
+           hauteur = get_oriented_size(jdesc, DIR_V);
+
+    plan_t plan = {PLAN_Y, 1, hauteur*largeur, hauteur, largeur, largeur, 0};
+
+    export_plans(jpeg_image, jdesc, &plan, 1, fichier);
+}
+
+/*
+ * Fonction:  export_buffer
+ * --------------------
+ * écrit les pixels d'une image directement dans un tampon fourni par
+ * l'appelant (texture, tampon de transfert...), sans image de sortie
+ * intermédiaire. Les lignes sont espacées de [pas] octets ; pour les
+ * formats planaires, les plans se suivent (le plan UV de NV12 et les plans
+ * de YUV444 gardent ce pas, les plans U et V de I420 prennent un pas
+ * moitié arrondi au-dessus, voir format_chroma_stride). Le tampon doit
+ * contenir format_buffer_size octets.
+ *
+ *  jpeg_image : image JPEG à exporter, couleur ou grayscale
+ *  jdesc      : descripteur de l'image JPEG
+ *  format     : format de pixels
+ *  dest       : premier pixel du tampon
+ *  pas        : écart entre deux lignes du tampon en octets
+ */
+void export_buffer(image8_t* jpeg_image, struct jpeg_desc *jdesc, enum pixel_format format, uint8_t* dest, size_t pas)
+{
+    size_t largeur = get_oriented_size(jdesc, DIR_H),
+           hauteur = get_oriented_size(jdesc, DIR_V),
+           minimal = format_min_stride(format, largeur);
+    if (pas < minimal) {
+        EXIT_ERROR("export_format", "Pas de ligne trop petit pour le format %s : %zu < %zu",
+                   NOMS_FORMATS[format], pas, minimal);
+    }
+
+    plan_t plans[3];
+    size_t nb_plans = decoupe_plans(format, largeur, hauteur, pas, plans);
+
+    destination_t destination = {dest, NULL, -1, 0};
+    produit_plans(jpeg_image, jdesc, plans, nb_plans, &destination);
+}
+
+/*
+ * Fonction:  decode_to_buffer
+ * --------------------
+ * décode une image JPEG ouverte et écrit ses pixels dans un tampon fourni
+ * par l'appelant (voir export_buffer) : aucun fichier n'est écrit et
+ * aucune image de sortie n'est allouée, seuls les blocs décodés le sont.
+ * Les dimensions s'obtiennent avant l'appel avec get_oriented_size
+ * (celles de get_output_size, échangées par une rotation de 90 ou 270).
+ * Les statistiques des pixels écrits (histogrammes, moyennes, extrêmes)
+ * sont rendues dans [stats] sans relire le tampon.
+ *
+ *  jdesc  : descripteur de l'image JPEG (read_jpeg)
+ *  format : format de pixels
+ *  dest   : premier pixel du tampon
+ *  pas    : écart entre deux lignes du tampon en octets
+ *  stats  : statistiques des pixels à remplir (NULL : non calculées)
+ */
+void decode_to_buffer(struct jpeg_desc *jdesc, enum pixel_format format, uint8_t* dest, size_t pas, image_stats_t* stats)
+{
+    image8_t* jpeg_image = extract_image(jdesc);
+
+    jpeg_image->stats = stats;
+    export_buffer(jpeg_image, jdesc, format, dest, pas);
+
+    free_image(jpeg_image);
+}
+
+/*
+ * Fonction:  entete_npy
+ * --------------------
+ * écrit l'en-tête .npy (version 1.0) d'un tenseur : type des éléments et
+ * dimensions (1, 3, H, W) ou (1, H, W, 3), complété pour aligner les
+ * données sur 64 octets
+ *
+ *  fichier : fichier de sortie
+ *  format  : format de tenseur (FMT_NCHW ou FMT_NHWC)
+ *  largeur : largeur de l'image en pixels
+ *  hauteur : hauteur de l'image en pixels
+ */
+static void entete_npy(FILE* fichier, enum pixel_format format, size_t largeur, size_t hauteur)
+{
+    char dico[128];
+    int longueur;
+    if (format == FMT_NCHW) {
+        longueur = snprintf(dico, sizeof(dico), "{'descr': '%s', 'fortran_order': False, 'shape': (1, 3, %zu, %zu), }",
+                            (P_DTYPE == DTYPE_FLOAT32) ? "<f4" : "|u1", hauteur, largeur);
+    } else {
+        longueur = snprintf(dico, sizeof(dico), "{'descr': '%s', 'fortran_order': False, 'shape': (1, %zu, %zu, 3), }",
+                            (P_DTYPE == DTYPE_FLOAT32) ? "<f4" : "|u1", hauteur, largeur);
+    }
+
+    /* Magique, version, taille du dictionnaire (complété d'espaces et d'un saut de ligne) */
+    size_t taille = ((10 + longueur + 1 + 63)/64)*64 - 10;
+    uint8_t prefixe[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, taille & 0xff, taille >> 8};
+    fwrite(prefixe, sizeof(uint8_t), 10, fichier);
+    fprintf(fichier, "%s%*s\n", dico, (int) (taille - longueur - 1), "");
+}
+
+/*
+ * Fonction:  export_raw
+ * --------------------
+ * exporte une image en pixels bruts dans un format de pixels (voir
+ * export_pixels), sans en-tête, ou avec l'en-tête .npy d'un tenseur
+ * (option -npy)
+ *
+ *  jpeg_image : image JPEG à exporter, couleur ou grayscale
+ *  jdesc      : descripteur de l'image JPEG
+ *  format     : format de pixels
+ *  filename   : nom du fichier de sortie
+ */
+void export_raw(image8_t* jpeg_image, struct jpeg_desc *jdesc, enum pixel_format format, const char* filename)
+{
+    FILE* sortie = fopen(filename, "w");
+    if (P_NPY) {
+        entete_npy(sortie, format, get_oriented_size(jdesc, DIR_H), get_oriented_size(jdesc, DIR_V));
+    }
+    export_pixels(jpeg_image, jdesc, format, sortie);
+    fclose(sortie);
+}
+
+/*
+ * Fonction:  print_stats
+ * --------------------
+ * affiche les statistiques des pixels d'une sortie : valeur moyenne,
+ * valeurs extrêmes de chaque canal
+ *
+ *  stats  : statistiques remplies à l'export
+ *  format : format de pixels de la sortie (noms des canaux)
+ */
+void print_stats(const image_stats_t* stats, enum pixel_format format)
+{
+    bool yuv = (format == FMT_I420 || format == FMT_NV12 || format == FMT_YUV444);
+    const char* noms = (yuv || stats->nb_canaux == 1) ? "YUV" : "RGB";
+
+    for (size_t c = 0; c < stats->nb_canaux; c++) {
+        printf("Canal %c : moyenne %.2f, min %u, max %u (%llu valeurs)\n", noms[c],
+               stats->moyenne[c], stats->min[c], stats->max[c], (unsigned long long) stats->nb[c]);
+    }
+}
@@ -1,10 +1,18 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 #include "extract_image.h"
 #include "jpeg_const.h"
 #include "jpeg_reader.h"
+#include "cpu_dispatch.h"
+#include "upsampling.h"
+#include "export_format.h"
 
 
 /*
@@ -32,12 +40,289 @@ static void ycbcr_to_rgb(uint8_t Y, uint8_t Cb, uint8_t Cr, uint8_t pixel[3]) {
     }
 }
 
+/*
+ * Fonction:  ycbcr_to_rgb_ligne
+ * --------------------
+ * noyau scalaire : convertit [nb] pixels YCbCr consécutifs en pixels RGB
+ * entrelacés (voir KERNELS.ycbcr_rgb)
+ *
+ *  y, cb, cr : composantes des pixels à convertir
+ *  rgb       : pixels RGB de sortie (3*nb octets)
+ *  nb        : nombre de pixels
+ *
+ */
+void ycbcr_to_rgb_ligne(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb)
+{
+    for (size_t i = 0; i < nb; i++) {
+        ycbcr_to_rgb(y[i], cb[i], cr[i], &rgb[3*i]);
+    }
+}
+
+/*
+ * Fonction:  ycbcr_to_rgbx_ligne
+ * --------------------
+ * noyau scalaire : convertit [nb] pixels YCbCr consécutifs en pixels de
+ * 4 octets, le quatrième (X ou A) valant 255 (voir KERNELS.ycbcr_rgbx)
+ *
+ *  y, cb, cr : composantes des pixels à convertir
+ *  dest      : pixels de sortie (4*nb octets)
+ *  nb        : nombre de pixels
+ *  bgr       : ordre B, G, R, A au lieu de R, G, B, X
+ *
+ */
+void ycbcr_to_rgbx_ligne(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr)
+{
+    uint8_t pixel[3];
+    for (size_t i = 0; i < nb; i++) {
+        ycbcr_to_rgb(y[i], cb[i], cr[i], pixel);
+        dest[4*i]   = pixel[bgr ? 2 : 0];
+        dest[4*i+1] = pixel[1];
+        dest[4*i+2] = pixel[bgr ? 0 : 2];
+        dest[4*i+3] = 255;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/*
+ * Fonction:  entrelace_rgb
+ * --------------------
+ * entrelace 16 octets R, G et B en 16 pixels RGB (48 octets) par
+ * permutations d'octets
+ *
+ *  r, g, b : composantes de 16 pixels
+ *  rgb     : pixels RGB de sortie
+ *
+ */
+__attribute__((target("ssse3")))
+static inline void entrelace_rgb(__m128i r, __m128i g, __m128i b, uint8_t* rgb)
+{
+    /* Octet k de la sortie : composante k%3 du pixel k/3 (-1 : octet mis à zéro) */
+    const __m128i r0 = _mm_setr_epi8( 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1,-1, 5),
+                  g0 = _mm_setr_epi8(-1, 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1,-1),
+                  b0 = _mm_setr_epi8(-1,-1, 0,-1,-1, 1,-1,-1, 2,-1,-1, 3,-1,-1, 4,-1),
+                  r1 = _mm_setr_epi8(-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1,10,-1),
+                  g1 = _mm_setr_epi8( 5,-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1,10),
+                  b1 = _mm_setr_epi8(-1, 5,-1,-1, 6,-1,-1, 7,-1,-1, 8,-1,-1, 9,-1,-1),
+                  r2 = _mm_setr_epi8(-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1,-1),
+                  g2 = _mm_setr_epi8(-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15,-1),
+                  b2 = _mm_setr_epi8(10,-1,-1,11,-1,-1,12,-1,-1,13,-1,-1,14,-1,-1,15);
+
+    _mm_storeu_si128((__m128i*)&rgb[0],  _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r0), _mm_shuffle_epi8(g, g0)), _mm_shuffle_epi8(b, b0)));
+    _mm_storeu_si128((__m128i*)&rgb[16], _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r1), _mm_shuffle_epi8(g, g1)), _mm_shuffle_epi8(b, b1)));
+    _mm_storeu_si128((__m128i*)&rgb[32], _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, r2), _mm_shuffle_epi8(g, g2)), _mm_shuffle_epi8(b, b2)));
+}
+
+/*
+ * Fonction:  entrelace_rgbx
+ * --------------------
+ * entrelace 16 octets R, G et B en 16 pixels de 4 octets, le quatrième
+ * (X ou A) valant 255 : ordre R, G, B, X ou B, G, R, A
+ *
+ *  r, g, b : composantes de 16 pixels
+ *  dest    : pixels de sortie (64 octets)
+ *  bgr     : ordre B, G, R, A au lieu de R, G, B, X
+ *
+ */
+static inline void entrelace_rgbx(__m128i r, __m128i g, __m128i b, uint8_t* dest, bool bgr)
+{
+    const __m128i opaque = _mm_set1_epi8((char)0xff);
+    __m128i premiere = bgr ? b : r, troisieme = bgr ? r : b;
+    __m128i pg_bas = _mm_unpacklo_epi8(premiere, g), pg_haut = _mm_unpackhi_epi8(premiere, g),
+            tx_bas = _mm_unpacklo_epi8(troisieme, opaque), tx_haut = _mm_unpackhi_epi8(troisieme, opaque);
+
+    _mm_storeu_si128((__m128i*)&dest[0],  _mm_unpacklo_epi16(pg_bas, tx_bas));
+    _mm_storeu_si128((__m128i*)&dest[16], _mm_unpackhi_epi16(pg_bas, tx_bas));
+    _mm_storeu_si128((__m128i*)&dest[32], _mm_unpacklo_epi16(pg_haut, tx_haut));
+    _mm_storeu_si128((__m128i*)&dest[48], _mm_unpackhi_epi16(pg_haut, tx_haut));
+}
+
+/*
+ * Fonction:  ycbcr_to_rgb_sse4
+ * --------------------
+ * formule de ycbcr_to_rgb sur 4 pixels en entiers 32 bits
+ * (résultats non saturés)
+ *
+ *  y, cb, cr : composantes des 4 pixels
+ *  rgb       : composantes R, G et B des 4 pixels
+ *
+ */
+__attribute__((target("sse4.1")))
+static inline void ycbcr_to_rgb_sse4(__m128i y, __m128i cb, __m128i cr, __m128i rgb[3])
+{
+    const __m128i centre = _mm_set1_epi32(128);
+
+    y  = _mm_slli_epi32(y, 17);
+    cb = _mm_sub_epi32(cb, centre);
+    cr = _mm_sub_epi32(cr, centre);
+    rgb[0] = _mm_srai_epi32(_mm_add_epi32(y, _mm_mullo_epi32(cr, _mm_set1_epi32(183763))), 17);
+    rgb[1] = _mm_srai_epi32(_mm_sub_epi32(_mm_sub_epi32(y, _mm_mullo_epi32(cb, _mm_set1_epi32(45107))),
+                                          _mm_mullo_epi32(cr, _mm_set1_epi32(93604))), 17);
+    rgb[2] = _mm_srai_epi32(_mm_add_epi32(y, _mm_mullo_epi32(cb, _mm_set1_epi32(232260))), 17);
+}
+
+/*
+ * Fonction:  convertit16_sse4
+ * --------------------
+ * convertit 16 pixels YCbCr en 16 octets R, G et B (4 groupes de 4 en
+ * entiers 32 bits, saturation par compactage)
+ *
+ *  y, cb, cr : composantes des 16 pixels
+ *  octets    : composantes R, G et B des 16 pixels
+ *
+ */
+__attribute__((target("sse4.1")))
+static inline void convertit16_sse4(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, __m128i octets[3])
+{
+    __m128i vy  = _mm_loadu_si128((const __m128i*)y),
+            vcb = _mm_loadu_si128((const __m128i*)cb),
+            vcr = _mm_loadu_si128((const __m128i*)cr);
+    __m128i groupes[4][3];
+
+    for (uint8_t k = 0; k < 4; k++) {
+        ycbcr_to_rgb_sse4(_mm_cvtepu8_epi32(vy), _mm_cvtepu8_epi32(vcb), _mm_cvtepu8_epi32(vcr), groupes[k]);
+        vy  = _mm_srli_si128(vy, 4);
+        vcb = _mm_srli_si128(vcb, 4);
+        vcr = _mm_srli_si128(vcr, 4);
+    }
+    for (uint8_t c = 0; c < 3; c++) {
+        octets[c] = _mm_packus_epi16(_mm_packs_epi32(groupes[0][c], groupes[1][c]),
+                                     _mm_packs_epi32(groupes[2][c], groupes[3][c]));
+    }
+}
+
+/*
+ * Fonction:  convertit16_avx2
+ * --------------------
+ * convertit 16 pixels YCbCr en 16 octets R, G et B (2 groupes de 8 en
+ * entiers 32 bits, saturation par compactage)
+ *
+ *  y, cb, cr : composantes des 16 pixels
+ *  octets    : composantes R, G et B des 16 pixels
+ *
+ */
+__attribute__((target("avx2")))
+static inline void convertit16_avx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, __m128i octets[3])
+{
+    const __m256i centre = _mm256_set1_epi32(128);
+
+    for (uint8_t h = 0; h < 2; h++) {
+        __m256i vy  = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&y[8*h])), 17),
+                vcb = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&cb[8*h])), centre),
+                vcr = _mm256_sub_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&cr[8*h])), centre);
+        __m256i c[3];
+        c[0] = _mm256_srai_epi32(_mm256_add_epi32(vy, _mm256_mullo_epi32(vcr, _mm256_set1_epi32(183763))), 17);
+        c[1] = _mm256_srai_epi32(_mm256_sub_epi32(_mm256_sub_epi32(vy, _mm256_mullo_epi32(vcb, _mm256_set1_epi32(45107))),
+                                                  _mm256_mullo_epi32(vcr, _mm256_set1_epi32(93604))), 17);
+        c[2] = _mm256_srai_epi32(_mm256_add_epi32(vy, _mm256_mullo_epi32(vcb, _mm256_set1_epi32(232260))), 17);
+
+        /* packs travaille par moitié de 128 bits : on réordonne les 8 mots avant de compacter */
+        for (uint8_t k = 0; k < 3; k++) {
+            __m256i mots = _mm256_permute4x64_epi64(_mm256_packs_epi32(c[k], c[k]), 0x08);
+            __m128i m = _mm256_castsi256_si128(mots);
+            octets[k] = h ? _mm_unpacklo_epi64(octets[k], _mm_packus_epi16(m, m)) : _mm_packus_epi16(m, m);
+        }
+    }
+}
+
+/*
+ * Fonction:  ycbcr_to_rgb_ligne_sse4
+ * --------------------
+ * ycbcr_to_rgb_ligne par paquets de 16 pixels, le reste en scalaire
+ *
+ */
+__attribute__((target("sse4.1,ssse3")))
+void ycbcr_to_rgb_ligne_sse4(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb)
+{
+    size_t i = 0;
+    for (; i+16 <= nb; i += 16) {
+        __m128i octets[3];
+        convertit16_sse4(&y[i], &cb[i], &cr[i], octets);
+        entrelace_rgb(octets[0], octets[1], octets[2], &rgb[3*i]);
+    }
+    ycbcr_to_rgb_ligne(&y[i], &cb[i], &cr[i], &rgb[3*i], nb-i);
+}
+
+/*
+ * Fonction:  ycbcr_to_rgb_ligne_avx2
+ * --------------------
+ * ycbcr_to_rgb_ligne par paquets de 16 pixels, le reste en scalaire
+ *
+ */
+__attribute__((target("avx2")))
+void ycbcr_to_rgb_ligne_avx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb)
+{
+    size_t i = 0;
+    for (; i+16 <= nb; i += 16) {
+        __m128i octets[3];
+        convertit16_avx2(&y[i], &cb[i], &cr[i], octets);
+        entrelace_rgb(octets[0], octets[1], octets[2], &rgb[3*i]);
+    }
+    ycbcr_to_rgb_ligne(&y[i], &cb[i], &cr[i], &rgb[3*i], nb-i);
+}
+
+/*
+ * Fonction:  ycbcr_to_rgbx_ligne_sse4
+ * --------------------
+ * ycbcr_to_rgbx_ligne par paquets de 16 pixels, le reste en scalaire
+ *
+ */
+__attribute__((target("sse4.1")))
+void ycbcr_to_rgbx_ligne_sse4(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr)
+{
+    size_t i = 0;
+    for (; i+16 <= nb; i += 16) {
+        __m128i octets[3];
+        convertit16_sse4(&y[i], &cb[i], &cr[i], octets);
+        entrelace_rgbx(octets[0], octets[1], octets[2], &dest[4*i], bgr);
+    }
+    ycbcr_to_rgbx_ligne(&y[i], &cb[i], &cr[i], &dest[4*i], nb-i, bgr);
+}
+
+/*
+ * Fonction:  ycbcr_to_rgbx_ligne_avx2
+ * --------------------
+ * ycbcr_to_rgbx_ligne par paquets de 16 pixels, le reste en scalaire
+ *
+ */
+__attribute__((target("avx2")))
+void ycbcr_to_rgbx_ligne_avx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr)
+{
+    size_t i = 0;
+    for (; i+16 <= nb; i += 16) {
+        __m128i octets[3];
+        convertit16_avx2(&y[i], &cb[i], &cr[i], octets);
+        entrelace_rgbx(octets[0], octets[1], octets[2], &dest[4*i], bgr);
+    }
+    ycbcr_to_rgbx_ligne(&y[i], &cb[i], &cr[i], &dest[4*i], nb-i, bgr);
+}
+#else
+void ycbcr_to_rgb_ligne_sse4(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb)
+{
+    ycbcr_to_rgb_ligne(y, cb, cr, rgb, nb);
+}
+
+void ycbcr_to_rgb_ligne_avx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* rgb, size_t nb)
+{
+    ycbcr_to_rgb_ligne(y, cb, cr, rgb, nb);
+}
+
+void ycbcr_to_rgbx_ligne_sse4(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr)
+{
+    ycbcr_to_rgbx_ligne(y, cb, cr, dest, nb, bgr);
+}
+
+void ycbcr_to_rgbx_ligne_avx2(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* dest, size_t nb, bool bgr)
+{
+    ycbcr_to_rgbx_ligne(y, cb, cr, dest, nb, bgr);
+}
+#endif
+
 /*
  * Fonction:  export_pgm
  * --------------------
  * exporte des blocs de luminance en un format PGM standard.
  *
- *  jpeg_image : image JPEG grayscale à exporter
+ *  jpeg_image : image JPEG grayscale (ou couleur décodée avec -luma) à exporter
  *  jdesc      : descripteur de l'image JPEG
  *  filename   : nom du fichier de sortie
  *
@@ -47,49 +332,17 @@ void export_pgm(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filen
     FILE* output_ppm;
     output_ppm = fopen(filename, "w");
 
-    /* Lecture des dimensions de l'image */
-    uint16_t largeur = get_image_size(jdesc, DIR_H),
-             hauteur = get_image_size(jdesc, DIR_V);
+    /* Lecture des dimensions de l'image (réduites avec l'option -scale=, orientées avec -orient=) */
+    uint16_t largeur = get_oriented_size(jdesc, DIR_H),
+             hauteur = get_oriented_size(jdesc, DIR_V);
 
     /* Ecriture de l'en-tête en ASCII */
     fprintf(output_ppm, "P5\n");
     fprintf(output_ppm, "%u %u\n", largeur, hauteur);
     fprintf(output_ppm, "%u\n", 255); // maximum value
 
-    /* Ecriture des données du fichier en binaire */
-    size_t bloc_offset = 0,  // Décalage des index de blocs dans l'itération
-           cur_offset = 0,   // Décalage permanent des index de blocs
-           cur_width = 0,    // Largeur courante dans l'itération
-           cur_height = 0,   // Hauteur courante dans l'itération
-           total_height = 0, // Hauteur écrite totale
-           restant = 0,      // Pixels restant à écrire sur la ligne
-           bloc_index, pixel_index;
-
-    while (total_height<hauteur) {    
-        while (cur_width<largeur) {
-            /* Index du bloc à écrire */
-            bloc_index = bloc_offset+cur_offset;
-            /* Index de la ligne de pixels dans le bloc */
-            pixel_index = BLOCK_SIZE*cur_height;
-            /* Calcul du nombre de pixels restant à écrire */
-            restant = (largeur-cur_width>BLOCK_SIZE) ? BLOCK_SIZE : (largeur-cur_width);
-
-            /* On écrit BLOCK_SIZE données depuis le bloc*/
-            fwrite(&jpeg_image->y_blocs[bloc_index][pixel_index], sizeof(uint8_t), restant, output_ppm);
-            cur_width += BLOCK_SIZE;
-            bloc_offset++;
-        }
-        /* Si on a écrit une hauteur de bloc : on passe au bloc suivant */
-        if (cur_height == BLOCK_SIZE-1) {
-            cur_offset += bloc_offset;
-            cur_height = 0;
-        } else {
-            cur_height++;
-        }
-        bloc_offset = 0;
-        cur_width = 0;
-        total_height++;
-    }
+    /* Ecriture des données du fichier en binaire : lignes complètes, par grands blocs */
+    export_luminance(jpeg_image, jdesc, output_ppm);
 
     fclose(output_ppm);
 }
@@ -97,9 +350,13 @@ void export_pgm(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filen
 /*
  * Fonction:  export_ppm
  * --------------------
- * exporte des blocs couleurs en un format PPM standard
+ * exporte des blocs couleurs en un format PPM standard. Les chrominances
+ * restent sous-échantillonnées : chaque ligne est suréchantillonnée à la
+ * volée (voir upsample_ligne) puis directement convertie en RGB. Les
+ * lignes sont rassemblées en grands blocs écrits à leur position dans le
+ * fichier, par bandes parallèles avec l'option -m (voir export_format.c).
  *
- *  jpeg_image : image JPEG grayscale à exporter
+ *  jpeg_image : image JPEG couleur à exporter
  *  jdesc      : descripteur de l'image JPEG
  *  filename   : nom du fichier de sortie
  *
@@ -109,65 +366,17 @@ void export_ppm(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filen
     FILE* output_ppm;
     output_ppm = fopen(filename, "w");
 
-    /* Lecture des dimensions de l'image en pixel */
-    uint16_t largeur = get_image_size(jdesc, DIR_H),
-             hauteur = get_image_size(jdesc, DIR_V);
-    uint8_t pixel[3];
-
-    /* Remapping des MCUs (sous-échantillonnage) */
-    uint32_t* mcu_map = jdesc->mcu_maps[0];
+    /* Lecture des dimensions de l'image en pixel (réduites avec l'option -scale=, orientées avec -orient=) */
+    uint16_t largeur = get_oriented_size(jdesc, DIR_H),
+             hauteur = get_oriented_size(jdesc, DIR_V);
 
     /* Ecriture de l'en-tête en ASCII */
     fprintf(output_ppm, "P6\n");
     fprintf(output_ppm, "%u %u\n", largeur, hauteur);
     fprintf(output_ppm, "%u\n", 255); // maximum value
 
-    /* Ecriture des données du fichier en binaire */
-    size_t bloc_offset = 0,  // Décalage des index de blocs dans l'itération
-           cur_offset = 0,   // Décalage permanent des index de blocs
-           cur_width = 0,    // Largeur courante dans l'itération
-           cur_height = 0,   // Hauteur courante dans l'itération
-           total_height = 0, // Hauteur écrite totale
-           restant = 0,      // Pixels restant à écrire sur la ligne
-           bloc_index, pixel_index;
-
-    while (total_height<hauteur) {
-        while (cur_width<largeur) {
-            // Index du bloc à écrire
-            bloc_index = bloc_offset+cur_offset;
-            // -> Remapping de l'index
-            bloc_index = mcu_map[bloc_index];
-            // Index de la ligne de pixels dans le bloc
-            pixel_index = BLOCK_SIZE*cur_height;
-            // Calcul du nombre de pixels restant à écrire
-            restant = (largeur-cur_width>BLOCK_SIZE) ? BLOCK_SIZE : (largeur-cur_width);
-
-            for (size_t to_write=0; to_write<restant; to_write++) {
-                // Conversion YCbCr -> RGB 
-                ycbcr_to_rgb(jpeg_image->y_blocs[bloc_index][pixel_index+to_write],
-                             jpeg_image->cb_blocs[bloc_index][pixel_index+to_write],
-                             jpeg_image->cr_blocs[bloc_index][pixel_index+to_write],
-                             pixel);
-
-                for (uint8_t cmp = 0; cmp < 3; cmp++) {
-                    // On écrit un pixel de chaque composante
-                    fwrite(&pixel[cmp], sizeof(uint8_t), 1, output_ppm);
-                }
-            }
-            cur_width += BLOCK_SIZE;
-            bloc_offset++;
-        }
-        /* Si on a écrit une hauteur de bloc : on passe au bloc suivant */
-        if (cur_height == BLOCK_SIZE-1) {
-            cur_offset += bloc_offset;
-            cur_height = 0;
-        } else {
-            cur_height++;
-        }
-        bloc_offset = 0;
-        cur_width = 0;
-        total_height++;
-    }
+    /* Ecriture des données du fichier en binaire : conversion YCbCr -> RGB ligne par ligne */
+    export_pixels(jpeg_image, jdesc, FMT_RGB, output_ppm);
 
     fclose(output_ppm);
 }
@@ -175,7 +384,9 @@ void export_ppm(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filen
 /*
  * Fonction:  export_img
  * --------------------
- * exporte une image dans un format PPM approprié
+ * exporte une image dans le format de sortie choisi (option -format=) :
+ * par défaut PPM, ou PGM pour une image en niveaux de gris ou décodée sans
+ * ses chrominances (option -luma), pixels bruts sinon
  *
  *  jpeg_image : image JPEG à exporter, couleur ou grayscale
  *  jdesc      : descripteur de l'image JPEG
@@ -184,7 +395,9 @@ void export_ppm(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filen
  */
 void export_img(image8_t* jpeg_image, struct jpeg_desc *jdesc, const char* filename)
 {
-    if (jpeg_image->color) {
+    if (P_FORMAT != FMT_RGB) {
+        export_raw(jpeg_image, jdesc, P_FORMAT, filename);
+    } else if (jpeg_image->cb_blocs != NULL) {
         export_ppm(jpeg_image, jdesc, filename);
     } else {
         export_pgm(jpeg_image, jdesc, filename);
@@ -6,6 +6,7 @@
 #include "bitstream.h"
 #include "huffman.h"
 #include "extract_image.h"
+#include "iqzz.h"
 
 
 /*
@@ -75,19 +76,37 @@ static int16_t read_DC(int16_t last_DC, struct bitstream *stream, struct huff_ta
     return (read_coeff(stream, magnitude) + last_DC);
 }
 
+/*
+ * Fonction:  mark_coeff 
+ * --------------------
+ * enregistre un coefficient non nul dans les métadonnées
+ * de parcimonie du bloc, dont la version transformée n'est
+ * plus à jour.
+ *  
+ *  info : métadonnées du bloc
+ *  c_i  : indice zig-zag du coefficient non nul
+ */
+static void mark_coeff(bloc_info_t* info, uint8_t c_i)
+{
+    info->mask |= (uint64_t)1 << c_i;
+    if (c_i >= info->eob) info->eob = c_i + 1;
+    info->a_jour = false;
+}
+
 /*
  * Fonction:  extract_bloc 
  * --------------------
  * extrait un bloc du bitstream passé en paramètres (mode séquentiel).
  * 
- *  bloc     : pointeur vers le tableau de pixels à initialiser
+ *  bloc     : pointeur vers le tableau de pixels à initialiser (ordre naturel)
+ *  info     : métadonnées de parcimonie du bloc
  *  last_DC  : valeur du dernier coefficient DC lu (calcul différentiel)
  *  stream   : flux courant ouvert
  *  table_DC : table de Huffman courante pour les coefficients DC
  *  table_AC : table de Huffman courante pour les coefficients AC
  *
  */
-static void extract_bloc(int16_t* bloc, int16_t last_DC, struct bitstream *stream, struct huff_table *table_DC, struct huff_table *table_AC)
+static void extract_bloc(int16_t* bloc, bloc_info_t* info, int16_t last_DC, struct bitstream *stream, struct huff_table *table_DC, struct huff_table *table_AC)
 {
     uint32_t data;
     uint16_t magnitude, n_zeros;
@@ -95,7 +114,8 @@ static void extract_bloc(int16_t* bloc, int16_t last_DC, struct bitstream *strea
 
     // On ajoute la valeur du coefficient DC calculée
     // + Valeur du dernier coefficient DC
-    bloc[c_i] = read_DC(last_DC, stream, table_DC);
+    bloc[EQUIV_ZZ[c_i]] = read_DC(last_DC, stream, table_DC);
+    if (bloc[EQUIV_ZZ[c_i]] != 0) mark_coeff(info, c_i);
     c_i++;
 
     /* Lecture des coefficients AC */
@@ -126,16 +146,81 @@ static void extract_bloc(int16_t* bloc, int16_t last_DC, struct bitstream *strea
         n_zeros = (data&0xF0) >> 4;
         // On écrit le nombre n_zeros dans le bloc
         c_i += n_zeros;
+        if (c_i >= BLOCK_PIXELS)
+            EXIT_ERROR("extract_bloc", "Bloc corrompu : coefficient %d hors du bloc", c_i);
 
         // Lecture de la magnitude :
         magnitude = (uint16_t)(data&0x0F);
 
         // On ajoute la valeur du coefficient AC calculée
-        bloc[c_i] = read_coeff(stream, magnitude);
+        bloc[EQUIV_ZZ[c_i]] = read_coeff(stream, magnitude);
+        if (bloc[EQUIV_ZZ[c_i]] != 0) mark_coeff(info, c_i);
         c_i++;
     }
 }
 
+/*
+ * Fonctions:  get_comp_blocs, get_comp_infos
+ * --------------------
+ * renvoient les blocs (resp. métadonnées) d'une composante de l'image.
+ * 
+ *  image : image en cours d'extraction
+ *  comp  : composante sélectionnée
+ *
+ */
+static int16_t** get_comp_blocs(image16_t* image, uint8_t comp)
+{
+    return (comp == COMP_Y) ? image->y_blocs : ((comp == COMP_Cb) ? image->cb_blocs : image->cr_blocs);
+}
+static bloc_info_t* get_comp_infos(image16_t* image, uint8_t comp)
+{
+    return (comp == COMP_Y) ? image->y_infos : ((comp == COMP_Cb) ? image->cb_infos : image->cr_infos);
+}
+static coeff_store_t* get_comp_store(image16_t* image, uint8_t comp)
+{
+    return (comp == COMP_Y) ? image->y_store : ((comp == COMP_Cb) ? image->cb_store : image->cr_store);
+}
+
+/* Bloc dense de travail pour le stockage compact (toujours nul entre deux blocs) */
+static int16_t store_swp[BLOCK_PIXELS];
+
+/*
+ * Fonction:  load_bloc
+ * --------------------
+ * renvoie le bloc dense à mettre à jour par un scan progressif :
+ * le bloc lui-même, ou son développement si le stockage est compact.
+ * 
+ *  image : image en cours d'extraction
+ *  comp  : composante du bloc
+ *  index : index raster du bloc
+ *
+ */
+static int16_t* load_bloc(image16_t* image, uint8_t comp, size_t index)
+{
+    coeff_store_t* store = get_comp_store(image, comp);
+    if (store == NULL) return get_comp_blocs(image, comp)[index];
+
+    expand_bloc(store, index, get_comp_infos(image, comp)[index].mask, store_swp);
+    return store_swp;
+}
+
+/*
+ * Fonction:  store_bloc
+ * --------------------
+ * range dans le stockage compact le bloc renvoyé par load_bloc
+ * (sans effet si le stockage est dense).
+ * 
+ *  image : image en cours d'extraction
+ *  comp  : composante du bloc
+ *  index : index raster du bloc
+ *
+ */
+static void store_bloc(image16_t* image, uint8_t comp, size_t index)
+{
+    coeff_store_t* store = get_comp_store(image, comp);
+    if (store != NULL) pack_bloc(store, index, get_comp_infos(image, comp)[index].mask, store_swp);
+}
+
 /*
  * Fonction:  extract_blocs_grey
  * --------------------
@@ -160,7 +245,7 @@ void extract_blocs_grey(struct jpeg_desc *jdesc, image16_t* grey_image)
     /* On charge tous les blocs de l'image dans le tableau */       
     for (size_t i=0; i<grey_image->num_blocs; i++) {
         /* On charge le dernier coefficient DC, et on le passe en paramètres*/
-        extract_bloc(grey_image->y_blocs[i], last_DC, jdesc->bitstream, table_DC, table_AC);
+        extract_bloc(grey_image->y_blocs[i], &grey_image->y_infos[i], last_DC, jdesc->bitstream, table_DC, table_AC);
         last_DC = grey_image->y_blocs[i][0];
     }
 }
@@ -191,40 +276,26 @@ void extract_blocs_color(struct jpeg_desc *jdesc, image16_t *color_image)
     /* Derniers coefficients DC lus */
     int16_t last_DC[3] = {0, 0, 0};
 
-    /* Calcul du nombre de blocs d'une composante par MCU */
-    uint8_t nb_blocs_y_mcu  = jdesc->nb_cp_mcu[0],
-            nb_blocs_cb_mcu = jdesc->nb_cp_mcu[1],
-            nb_blocs_cr_mcu = jdesc->nb_cp_mcu[2];
+    /* Bloc de rebut : composantes non stockées (chrominances avec l'option -luma),
+       décodées seulement pour avancer dans le flux et suivre leur DC */
+    int16_t     rebut[BLOCK_PIXELS];
+    bloc_info_t rebut_info = {0, 0, false};
 
-    /* On lit les composantes selon l'ordre enregistré dans ordre_composants */
-    size_t  offt[3] = {0, 0, 0};
+    /* On lit les composantes selon l'ordre enregistré dans ordre_composants
+       -> chaque bloc est rangé à sa position raster dans sa composante */
+    size_t  index;
     for (size_t i=0; i<jdesc->nb_mcus; i++)
     for (size_t w=0; w<3; w++) {
-        switch (jdesc->ordre_composants[w]) {
-            case COMP_Y:
-                /* Chargement des blocs Y */
-                for (size_t j=0; j<nb_blocs_y_mcu; j++) {
-                    extract_bloc(color_image->y_blocs[offt[0]], last_DC[0], jdesc->bitstream, tables_DC[0], tables_AC[0]);
-                    last_DC[0] = color_image->y_blocs[offt[0]][0];
-                    offt[0]++;
-                }
-                break;
-            case COMP_Cb:
-                /* Chargement des blocs Cb */
-                for (size_t j=0; j<nb_blocs_cb_mcu; j++) {
-                    extract_bloc(color_image->cb_blocs[offt[1]], last_DC[1], jdesc->bitstream, tables_DC[1], tables_AC[1]);
-                    last_DC[1] = color_image->cb_blocs[offt[1]][0];
-                    offt[1]++;
-                }
-                break;
-            default:
-                /* Chargement des blocs Cr */
-                for (size_t j=0; j<nb_blocs_cr_mcu; j++) {
-                    extract_bloc(color_image->cr_blocs[offt[2]], last_DC[2], jdesc->bitstream, tables_DC[1], tables_AC[1]);
-                    last_DC[2] = color_image->cr_blocs[offt[2]][0];
-                    offt[2]++;
-                }
-                break;
+        uint8_t       cp     = jdesc->ordre_composants[w];
+        int16_t**     blocs  = get_comp_blocs(color_image, cp);
+        bloc_info_t*  infos  = get_comp_infos(color_image, cp);
+
+        for (size_t j=0; j<jdesc->nb_cp_mcu[cp]; j++) {
+            index = mcu_bloc_index(jdesc, cp, i, j);
+            int16_t*     bloc = (blocs != NULL) ? blocs[index]  : rebut;
+            bloc_info_t* info = (infos != NULL) ? &infos[index] : &rebut_info;
+            extract_bloc(bloc, info, last_DC[cp], jdesc->bitstream, tables_DC[cp > 0], tables_AC[cp > 0]);
+            last_DC[cp] = bloc[0];
         }
     }
 }
@@ -257,16 +328,20 @@ static uint32_t read_EOB_value(struct bitstream* stream, uint16_t n_zeros)
  * 
  *     jdesc : descripteur JPEG du fichier ouvert
  *   bloc_ci : NZH à corriger
+ *      info : métadonnées de parcimonie du bloc
  * 
  */
-static void correct_coeff(struct jpeg_desc* jdesc, int16_t* bloc_ci)
+static void correct_coeff(struct jpeg_desc* jdesc, int16_t* bloc_ci, bloc_info_t* info)
 {
     // Lecture du bit de correction
     uint32_t bit;
     read_bitstream(jdesc->bitstream, 1, &bit, true);
 
     // Correction du coefficient
-    if (bit) *bloc_ci |= 1 << jdesc->prog_al;
+    if (bit) {
+        *bloc_ci |= 1 << jdesc->prog_al;
+        info->a_jour = false;
+    }
 }
 
 /*
@@ -277,16 +352,18 @@ static void correct_coeff(struct jpeg_desc* jdesc, int16_t* bloc_ci)
  *  
  *     jdesc : descripteur JPEG du fichier ouvert
  *      bloc : bloc à initialiser
+ *      info : métadonnées de parcimonie du bloc
  *   last_DC : valeur du dernier coefficient DC lu (calcul différentiel)
  *  table_DC : table de Huffman courante pour les coefficients DC
  *
  * renvoie : le coefficient DC lu, avant application du bitshift (scaling)
  */
-static int16_t extract_first_DC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, int16_t last_DC, struct huff_table *table_DC)
+static int16_t extract_first_DC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, bloc_info_t* info, int16_t last_DC, struct huff_table *table_DC)
 {   
     int16_t new_DC;
     new_DC = read_DC(last_DC, jdesc->bitstream, table_DC);
     *bloc  = new_DC << jdesc->prog_al;
+    if (*bloc != 0) mark_coeff(info, 0);
     return new_DC;
 }
 
@@ -298,15 +375,20 @@ static int16_t extract_first_DC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, int
  * 
  *  jdesc : descripteur JPEG du fichier ouvert
  *   bloc : bloc à initialiser
+ *   info : métadonnées de parcimonie du bloc
  * 
  */
-static void extract_next_DC_bloc(struct jpeg_desc *jdesc, int16_t* bloc)
+static void extract_next_DC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, bloc_info_t* info)
 {   
     uint32_t bit;
 
-    /* On lit un bit de précision supplémentaire du coefficient DC */
+    /* On lit un bit de précision supplémentaire du coefficient DC
+       (un bit nul ne modifie pas le bloc) */
     read_bitstream(jdesc->bitstream, 1, &bit, true);
-    *bloc |= bit << jdesc->prog_al;
+    if (bit) {
+        *bloc |= bit << jdesc->prog_al;
+        mark_coeff(info, 0);
+    }
 }
 
 /*
@@ -316,11 +398,12 @@ static void extract_next_DC_bloc(struct jpeg_desc *jdesc, int16_t* bloc)
  * 
  *     jdesc : descripteur JPEG du fichier ouvert
  *      bloc : bloc à initialiser
+ *      info : métadonnées de parcimonie du bloc
  *  table_AC : table de Huffman pour les coefficients
  * 
  * renvoie le nombre de blocs EOB (zéro) à passer
  */
-static uint32_t extract_first_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, struct huff_table *table_AC)
+static uint32_t extract_first_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, bloc_info_t* info, struct huff_table *table_AC)
 {
     uint32_t data;
     uint16_t magnitude, n_zeros;
@@ -351,9 +434,12 @@ static uint32_t extract_first_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, st
         } else {
             // On écrit le nombre n_zeros dans le bloc
             c_i += n_zeros;
+            if (c_i > jdesc->prog_se)
+                EXIT_ERROR("extract_bloc", "Bloc corrompu : coefficient %u hors de la bande", c_i);
 
             // On ajoute la valeur du coefficient AC calculée
-            bloc[c_i] = read_coeff(jdesc->bitstream, magnitude) << jdesc->prog_al;
+            bloc[EQUIV_ZZ[c_i]] = read_coeff(jdesc->bitstream, magnitude) << jdesc->prog_al;
+            mark_coeff(info, c_i);
         }
         c_i++;
     }
@@ -369,11 +455,12 @@ static uint32_t extract_first_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, st
  * 
  *     jdesc : descripteur JPEG du fichier ouvert
  *      bloc : bloc à initialiser
+ *      info : métadonnées de parcimonie du bloc
  *  table_AC : table de Huffman pour les coefficients
  * 
  * renvoie le nombre de blocs EOB (zéro) à passer
  */
-static uint32_t extract_next_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, struct huff_table *table_AC)
+static uint32_t extract_next_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, bloc_info_t* info, struct huff_table *table_AC)
 {
     uint32_t data, skip_num;
     uint16_t magnitude, value;
@@ -415,17 +502,17 @@ static uint32_t extract_next_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, str
                              | 1 magnitude décodée du coefficient
         */
         if (magnitude == 1) {
-            /* On lit la valeur de bloc[c_i] */
+            /* On lit la valeur du nouveau coefficient */
             value = read_coeff(jdesc->bitstream, magnitude) << jdesc->prog_al;
 
             /* On applique les corrections des NZH trouvés */
-            for (; n_zeros>0 || bloc[c_i]!=0; c_i++) {
+            for (; n_zeros>0 || bloc[EQUIV_ZZ[c_i]]!=0; c_i++) {
                 // -> NZH trouvé : correction du coefficient
-                if (bloc[c_i] != 0) correct_coeff(jdesc, &bloc[c_i]);
+                if (bloc[EQUIV_ZZ[c_i]] != 0) correct_coeff(jdesc, &bloc[EQUIV_ZZ[c_i]], info);
                 // -> 0 à passer
                 else n_zeros-=1;
             }
-            bloc[c_i] = value; c_i++;
+            bloc[EQUIV_ZZ[c_i]] = value; mark_coeff(info, c_i); c_i++;
 
         /* EOBn ou ZRL
            Dans les deux cas, on corrige les coefficients suivants
@@ -439,14 +526,14 @@ static uint32_t extract_next_AC_bloc(struct jpeg_desc *jdesc, int16_t* bloc, str
 
                 /* On corrige les derniers NZH de la bande */
                 for (; c_i<=jdesc->prog_se; c_i++)
-                    if (bloc[c_i] != 0) correct_coeff(jdesc, &bloc[c_i]);
+                    if (bloc[EQUIV_ZZ[c_i]] != 0) correct_coeff(jdesc, &bloc[EQUIV_ZZ[c_i]], info);
 
                 return skip_num;
             // -> ZRL
             } else if (data == ZRL) {
                 /* On corrige les NZH suivants dans la bande en passant 16 zéros */
                 for (; n_zeros>=0; c_i++) {
-                    if (bloc[c_i] != 0) correct_coeff(jdesc, &bloc[c_i]);
+                    if (bloc[EQUIV_ZZ[c_i]] != 0) correct_coeff(jdesc, &bloc[EQUIV_ZZ[c_i]], info);
                     else {
                         n_zeros -= 1;
                     }
@@ -483,10 +570,16 @@ void extract_first_DC_blocs_grey(struct jpeg_desc *jdesc, image16_t* prog_image)
     /* Dernier coefficient DC lu*/
     int16_t last_DC = 0;
 
+    /* Métadonnées absentes (scans décodés en parallèle) : bloc de rebut */
+    bloc_info_t* infos = prog_image->y_infos;
+    bloc_info_t  rebut_info = {0, 0, false};
+
     /* On charge tous les blocs de l'image dans le tableau */       
     for (size_t i=0; i<prog_image->num_blocs; i++) {
         /* On charge le dernier coefficient DC, et on le passe en paramètres*/
-        last_DC = extract_first_DC_bloc(jdesc, &prog_image->y_blocs[i][0], last_DC, table_DC);
+        int16_t* bloc = load_bloc(prog_image, COMP_Y, i);
+        last_DC = extract_first_DC_bloc(jdesc, &bloc[0], (infos != NULL) ? &infos[i] : &rebut_info, last_DC, table_DC);
+        store_bloc(prog_image, COMP_Y, i);
         // -> Les coefficients AC valent 0 temporairement
     }
 }
@@ -503,9 +596,14 @@ void extract_first_DC_blocs_grey(struct jpeg_desc *jdesc, image16_t* prog_image)
  */
 void extract_next_DC_blocs_grey(struct jpeg_desc *jdesc, image16_t* prog_image)
 {   
+    bloc_info_t* infos = prog_image->y_infos;
+    bloc_info_t  rebut_info = {0, 0, false};
+
     /* On charge tous les blocs de l'image dans le tableau */       
     for (size_t i=0; i<prog_image->num_blocs; i++) {
-        extract_next_DC_bloc(jdesc, &prog_image->y_blocs[i][0]);
+        int16_t* bloc = load_bloc(prog_image, COMP_Y, i);
+        extract_next_DC_bloc(jdesc, &bloc[0], (infos != NULL) ? &infos[i] : &rebut_info);
+        store_bloc(prog_image, COMP_Y, i);
     }
 }
 
@@ -524,11 +622,15 @@ void extract_first_AC_blocs_grey(struct jpeg_desc *jdesc, image16_t* prog_image)
     struct huff_table *table_AC;
     table_AC = get_huffman_table(jdesc, AC, COMP_Y);
 
+    bloc_info_t* infos = prog_image->y_infos;
+    bloc_info_t  rebut_info = {0, 0, false};
+
     /* On charge tous les coefficients AC dans la bande */
     uint32_t skip_num = 0;
     INFO_MSG("* starting at : "); print_offset(jdesc->bitstream);
     for (size_t i=0; i<prog_image->num_blocs; i++) {
-        skip_num = extract_first_AC_bloc(jdesc, prog_image->y_blocs[i], table_AC);
+        skip_num = extract_first_AC_bloc(jdesc, load_bloc(prog_image, COMP_Y, i), (infos != NULL) ? &infos[i] : &rebut_info, table_AC);
+        store_bloc(prog_image, COMP_Y, i);
         i += skip_num; // On passe les blocs EOB
     }
     INFO_MSG("* ending at : "); print_offset(jdesc->bitstream);
@@ -549,17 +651,23 @@ void extract_next_AC_blocs_grey(struct jpeg_desc *jdesc, image16_t* prog_image)
     struct huff_table *table_AC;
     table_AC = get_huffman_table(jdesc, AC, COMP_Y);
 
+    bloc_info_t* infos = prog_image->y_infos;
+    bloc_info_t  rebut_info = {0, 0, false};
+
     uint32_t skip_num = 0;
     for (size_t i=0; i<prog_image->num_blocs; i++) {
+        int16_t*     bloc = load_bloc(prog_image, COMP_Y, i);
+        bloc_info_t* info = (infos != NULL) ? &infos[i] : &rebut_info;
         if (skip_num == 0) {
-            skip_num = extract_next_AC_bloc(jdesc, prog_image->y_blocs[i], table_AC);
+            skip_num = extract_next_AC_bloc(jdesc, bloc, info, table_AC);
         /* Dans le cas où des blocs EOB sont à passer */
         } else {
             for (size_t c_i = jdesc->prog_ss; c_i <= jdesc->prog_se; c_i++) {
-                if (prog_image->y_blocs[i][c_i] != 0) correct_coeff(jdesc, &prog_image->y_blocs[i][c_i]);
+                if (bloc[EQUIV_ZZ[c_i]] != 0) correct_coeff(jdesc, &bloc[EQUIV_ZZ[c_i]], info);
             }
             skip_num--;
         }
+        store_bloc(prog_image, COMP_Y, i);
     }
 }
 
@@ -579,21 +687,24 @@ void extract_first_AC_blocs_color(struct jpeg_desc *jdesc, image16_t* prog_image
 {
     /* Les coefficients ACs ne peuvent pas être entrelacés */
     uint8_t current_cp = jdesc->ordre_composants[0];
-    int16_t** comp = (current_cp == COMP_Y) ? prog_image->y_blocs : ((current_cp == COMP_Cb) ? prog_image->cb_blocs : prog_image->cr_blocs);    
+    bloc_info_t* infos = get_comp_infos(prog_image, current_cp);
+    bloc_info_t  rebut_info = {0, 0, false};
 
-    /* Nombre de blocs de la composante */
-    size_t num_blocs_cp = (current_cp == COMP_Y) ? prog_image->num_blocs : ((current_cp == COMP_Cb) ? prog_image->num_blocs_Cb : prog_image->num_blocs_Cr);
-
-    /* Mapping des MCUs*/
-    uint32_t* mcu_map = jdesc->mcu_maps[0];
+    /* Nombre de blocs de la composante parcourus par le scan */
+    size_t num_blocs_cp = scan_nb_blocs(jdesc, current_cp);
 
     /* Chargement des tables de Huffman */
     struct huff_table *table_AC;
     table_AC = get_huffman_table(jdesc, AC, current_cp);
 
+    /* Le stockage est en ordre raster : parcours séquentiel des blocs */
     uint32_t skip_num = 0;
+    size_t   index;
     for (size_t i=0; i<num_blocs_cp; i++) {
-        skip_num = extract_first_AC_bloc(jdesc, comp[mcu_map[i]], table_AC);
+        index = scan_bloc_index(jdesc, current_cp, i);
+        skip_num = extract_first_AC_bloc(jdesc, load_bloc(prog_image, current_cp, index),
+                                         (infos != NULL) ? &infos[index] : &rebut_info, table_AC);
+        store_bloc(prog_image, current_cp, index);
         i += skip_num; // On passe les blocs EOB
         INFO_MSG(" %zu | ", i);
     }
@@ -614,34 +725,54 @@ void extract_next_AC_blocs_color(struct jpeg_desc *jdesc, image16_t* prog_image)
     /* Les coefficients ACs ne peuvent pas être entrelacés
        -> on charge la composante courante */
     uint8_t current_cp = jdesc->ordre_composants[0];
-    int16_t** comp = (current_cp == COMP_Y) ? prog_image->y_blocs : ((current_cp == COMP_Cb) ? prog_image->cb_blocs : prog_image->cr_blocs);
-
-    /* Nombre de blocs de la composante */
-    size_t num_blocs_cp = (current_cp == COMP_Y) ? prog_image->num_blocs : ((current_cp == COMP_Cb) ? prog_image->num_blocs_Cb : prog_image->num_blocs_Cr);
+    bloc_info_t* infos = get_comp_infos(prog_image, current_cp);
+    bloc_info_t  rebut_info = {0, 0, false};
 
-    /* Mapping des MCUs*/
-    uint32_t* mcu_map = jdesc->mcu_maps[0];
+    /* Nombre de blocs de la composante parcourus par le scan */
+    size_t num_blocs_cp = scan_nb_blocs(jdesc, current_cp);
 
     /* Chargement des tables de Huffman */
     struct huff_table *table_AC;
     table_AC = get_huffman_table(jdesc, AC, current_cp);
 
+    /* Le stockage est en ordre raster : parcours séquentiel des blocs */
     uint32_t skip_num = 0;
+    size_t   index;
     for (size_t i=0; i<num_blocs_cp; i++) {
+        index = scan_bloc_index(jdesc, current_cp, i);
+        int16_t*     bloc = load_bloc(prog_image, current_cp, index);
+        bloc_info_t* info = (infos != NULL) ? &infos[index] : &rebut_info;
         if (skip_num == 0) {
-            skip_num = extract_next_AC_bloc(jdesc, comp[mcu_map[i]], table_AC);
+            skip_num = extract_next_AC_bloc(jdesc, bloc, info, table_AC);
         /* Dans le cas où des blocs EOB sont à passer */
         } else {
             for (size_t c_i=jdesc->prog_ss; c_i<=jdesc->prog_se; c_i++) {
-                if (comp[mcu_map[i]][c_i] != 0) correct_coeff(jdesc, &comp[mcu_map[i]][c_i]);
+                if (bloc[EQUIV_ZZ[c_i]] != 0) correct_coeff(jdesc, &bloc[EQUIV_ZZ[c_i]], info);
             }
             skip_num--;
         }
+        store_bloc(prog_image, current_cp, index);
         INFO_MSG(" %zu | ", i);
     }
     INFO_MSG("\n");
 }
 
+/*
+ * Fonction:  scan_nb_unites
+ * --------------------
+ * renvoie le nombre d'unités (MCUs, ou blocs si le scan
+ * n'est pas entrelacé) d'un scan DC progressif couleur.
+ * 
+ *  jdesc : descripteur JPEG du fichier ouvert
+ *
+ */
+static size_t scan_nb_unites(struct jpeg_desc *jdesc)
+{
+    if (jdesc->scan_nb_comp == 1)
+        return scan_nb_blocs(jdesc, jdesc->ordre_composants[0]);
+    return jdesc->nb_mcus;
+}
+
 /*
  * Fonction:  extract_next_DC_blocs_color
  * --------------------
@@ -656,39 +787,25 @@ void extract_next_AC_blocs_color(struct jpeg_desc *jdesc, image16_t* prog_image)
  */
 void extract_next_DC_blocs_color(struct jpeg_desc *jdesc, image16_t* prog_image)
 {   
-    /* Calcul du nombre de blocs d'une composante par MCU */
-    uint8_t nb_blocs_y_mcu  = jdesc->nb_cp_mcu[0],
-            nb_blocs_cb_mcu = jdesc->nb_cp_mcu[1],
-            nb_blocs_cr_mcu = jdesc->nb_cp_mcu[2];
-    size_t  nb_mcus = jdesc->nb_mcus;
+    bool   entrelace = (jdesc->scan_nb_comp > 1);
+    size_t nb_unites = scan_nb_unites(jdesc), index;
+
+    bloc_info_t rebut_info = {0, 0, false};
 
     /* On ne passe que sur les composantes de l'en-tête scannée */
-    size_t  offt[3] = {0, 0, 0};
-    for (size_t i=0; i<nb_mcus; i++)
+    for (size_t i=0; i<nb_unites; i++)
     for (size_t w=0; w<jdesc->scan_nb_comp; w++) {
-        switch (jdesc->ordre_composants[w]) {
-            case COMP_Y:
-                /* Chargement des blocs Y */
-                for (size_t j=0; j<nb_blocs_y_mcu; j++) {
-                    extract_next_DC_bloc(jdesc, &prog_image->y_blocs[offt[0]][0]);
-                    offt[0]++;
-                }
-                break;
-            case COMP_Cb:
-                /* Chargement des blocs Cb */
-                for (size_t j=0; j<nb_blocs_cb_mcu; j++) {
-                    extract_next_DC_bloc(jdesc, &prog_image->cb_blocs[offt[1]][0]);
-                    offt[1]++;
-                }
-                break;
-            default:
-                /* Chargement des blocs Cr */
-                for (size_t j=0; j<nb_blocs_cr_mcu; j++) {
-                    extract_next_DC_bloc(jdesc, &prog_image->cr_blocs[offt[2]][0]);
-                    offt[2]++;
-                }
-                break;
-        }            
+        uint8_t       cp    = jdesc->ordre_composants[w];
+        bloc_info_t*  infos = get_comp_infos(prog_image, cp);
+
+        /* Scan entrelacé : ordre des MCUs, sinon ordre raster */
+        size_t nb_blocs = entrelace ? jdesc->nb_cp_mcu[cp] : 1;
+        for (size_t j=0; j<nb_blocs; j++) {
+            index = entrelace ? mcu_bloc_index(jdesc, cp, i, j) : scan_bloc_index(jdesc, cp, i);
+            int16_t* bloc = load_bloc(prog_image, cp, index);
+            extract_next_DC_bloc(jdesc, &bloc[0], (infos != NULL) ? &infos[index] : &rebut_info);
+            store_bloc(prog_image, cp, index);
+        }
     }
 }
 
@@ -714,38 +831,101 @@ void extract_first_DC_blocs_color(struct jpeg_desc *jdesc, image16_t* prog_image
 
     int16_t last_DC[3] = {0, 0, 0};
 
-    /* Calcul du nombre de blocs d'une composante par MCU */
-    uint8_t nb_blocs_y_mcu  = jdesc->nb_cp_mcu[0],
-            nb_blocs_cb_mcu = jdesc->nb_cp_mcu[1],
-            nb_blocs_cr_mcu = jdesc->nb_cp_mcu[2];
-    size_t  nb_mcus = jdesc->nb_mcus;
+    bloc_info_t rebut_info = {0, 0, false};
+
+    bool   entrelace = (jdesc->scan_nb_comp > 1);
+    size_t nb_unites = scan_nb_unites(jdesc), index;
 
     /* On ne passe que sur les composantes de l'en-tête scannée */
-    size_t  offt[3] = {0, 0, 0};
-    for (size_t i=0; i<nb_mcus; i++)
+    for (size_t i=0; i<nb_unites; i++)
     for (size_t w=0; w<jdesc->scan_nb_comp; w++) {
-        switch (jdesc->ordre_composants[w]) {
-            case COMP_Y:
-                /* Chargement des blocs Y */
-                for (size_t j=0; j<nb_blocs_y_mcu; j++) {
-                    last_DC[w] = extract_first_DC_bloc(jdesc, &prog_image->y_blocs[offt[0]][0], last_DC[w], tables_DC[0]);
-                    offt[0]++;
-                }
-                break;
-            case COMP_Cb:
-                /* Chargement des blocs Cb */
-                for (size_t j=0; j<nb_blocs_cb_mcu; j++) {
-                    last_DC[w] = extract_first_DC_bloc(jdesc, &prog_image->cb_blocs[offt[1]][0], last_DC[w], tables_DC[1]);
-                    offt[1]++;
-                }
-                break;
-            default:
-                /* Chargement des blocs Cr */
-                for (size_t j=0; j<nb_blocs_cr_mcu; j++) {
-                    last_DC[w] = extract_first_DC_bloc(jdesc, &prog_image->cr_blocs[offt[2]][0], last_DC[w], tables_DC[1]);
-                    offt[2]++;
-                }
-                break;
+        uint8_t       cp    = jdesc->ordre_composants[w];
+        bloc_info_t*  infos = get_comp_infos(prog_image, cp);
+
+        /* Scan entrelacé : ordre des MCUs, sinon ordre raster */
+        size_t nb_blocs = entrelace ? jdesc->nb_cp_mcu[cp] : 1;
+        for (size_t j=0; j<nb_blocs; j++) {
+            index = entrelace ? mcu_bloc_index(jdesc, cp, i, j) : scan_bloc_index(jdesc, cp, i);
+            int16_t* bloc = load_bloc(prog_image, cp, index);
+            last_DC[w] = extract_first_DC_bloc(jdesc, &bloc[0], (infos != NULL) ? &infos[index] : &rebut_info,
+                                               last_DC[w], tables_DC[cp > 0]);
+            store_bloc(prog_image, cp, index);
+        }
+    }
+}
+
+//===============================================================================================
+// Scan progressif
+
+/*
+ * Fonction:  extract_scan
+ * --------------------
+ * décode le scan progressif courant du descripteur (paramètres
+ * de la dernière section SOS lue) dans l'image, selon sa nature :
+ * premier passage ou raffinement, coefficients DC ou AC.
+ * 
+ *       jdesc : descripteur JPEG du fichier ouvert, positionné
+ *               au début des données du scan
+ *  prog_image : image progressive à mettre à jour
+ * 
+ */
+void extract_scan(struct jpeg_desc *jdesc, image16_t* prog_image)
+{
+    if (jdesc->prog_ss == 0) {
+        if (jdesc->prog_ah == 0) {
+            INFO_MSG("-- First DC\n");
+            if (prog_image->color)
+                extract_first_DC_blocs_color(jdesc, prog_image);
+            else
+                extract_first_DC_blocs_grey(jdesc, prog_image);
+        } else {
+            INFO_MSG("-- Next DC\n");
+            if (prog_image->color)
+                extract_next_DC_blocs_color(jdesc, prog_image);
+            else
+                extract_next_DC_blocs_grey(jdesc, prog_image);
+        }
+    } else if (jdesc->prog_ah == 0) {
+        INFO_MSG("-- First AC\n");
+        if (prog_image->color)
+            extract_first_AC_blocs_color(jdesc, prog_image);
+        else
+            extract_first_AC_blocs_grey(jdesc, prog_image);
+    } else {
+        INFO_MSG("-- Next AC\n");
+        if (prog_image->color)
+            extract_next_AC_blocs_color(jdesc, prog_image);
+        else
+            extract_next_AC_blocs_grey(jdesc, prog_image);
+    }
+}
+
+/*
+ * Fonction:  update_bloc_infos
+ * --------------------
+ * recalcule les métadonnées de parcimonie de tous les blocs
+ * d'une image à partir de leurs coefficients (stockage dense),
+ * quand les scans ont été décodés sans les tenir à jour.
+ * 
+ * un coefficient progressif ne redevient jamais nul : le masque
+ * obtenu est celui que les scans auraient construit.
+ * 
+ *  image : image dont tous les scans ont été décodés
+ * 
+ */
+void update_bloc_infos(image16_t* image)
+{
+    for (uint8_t cp=COMP_Y; cp<=(image->color ? COMP_Cr : COMP_Y); cp++) {
+        int16_t**    blocs = get_comp_blocs(image, cp);
+        bloc_info_t* infos = get_comp_infos(image, cp);
+        size_t       nb    = (cp == COMP_Y) ? image->num_blocs
+                           : ((cp == COMP_Cb) ? image->num_blocs_Cb : image->num_blocs_Cr);
+
+        for (size_t i=0; i<nb; i++) {
+            infos[i] = (bloc_info_t) {0, 0, false};
+            for (uint8_t c_i=0; c_i<BLOCK_PIXELS; c_i++) {
+                if (blocs[i][EQUIV_ZZ[c_i]] != 0) mark_coeff(&infos[i], c_i);
+            }
         }
     }
 }
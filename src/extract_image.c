@@ -5,6 +5,7 @@
 #include <stdio.h>
 
 #include "process.h"
+#include "idct_bench.h"
 #include "export_ppm.h"
 #include "extract_bloc.h"
 #include "extract_image.h"
@@ -12,6 +13,7 @@
 #include "jpeg_const.h"
 #include "bitstream.h"
 #include "upsampling.h"
+#include "scan_graph.h"
 
 
 /*
@@ -21,11 +23,30 @@
  * arrondie à l'excès.
  *
  */
-static uint16_t ceil_value(uint16_t value, uint16_t divider)
+static uint32_t ceil_value(uint32_t value, uint32_t divider)
 {
     return (1 + ((value - 1) / divider));
 }
 
+/*
+ * Fonction:  allocate_coeffs_16 
+ * --------------------
+ * alloue un tableau contigu de coefficients pour [num_blocs] blocs,
+ * et fait pointer chaque case de [blocs] sur le bloc correspondant.
+ *
+ *  num_blocs : nombre de blocs à allouer
+ *  blocs     : tableau de pointeurs à initialiser
+ *
+ * renvoie : le tableau de coefficients alloué
+ */
+static int16_t* allocate_coeffs_16(size_t num_blocs, int16_t** blocs)
+{
+    int16_t* coeffs = calloc(num_blocs*BLOCK_PIXELS, sizeof(int16_t));
+    for (size_t i=0; i<num_blocs; i++)
+        blocs[i] = &coeffs[i*BLOCK_PIXELS];
+    return coeffs;
+}
+
 /*
  * Fonction:  allocate_luminance_16 
  * --------------------
@@ -35,14 +56,23 @@ static uint16_t ceil_value(uint16_t value, uint16_t divider)
  */
 static void allocate_luminance_16(image16_t* new_image)
 {    
-    new_image->y_blocs = malloc(sizeof(int16_t*)*(new_image->num_blocs));
-    for (size_t i=0; i<new_image->num_blocs; i++)
-        new_image->y_blocs[i] = calloc(BLOCK_PIXELS, sizeof(int16_t));
+    new_image->y_blocs  = malloc(sizeof(int16_t*)*(new_image->num_blocs));
+    new_image->y_coeffs = allocate_coeffs_16(new_image->num_blocs, new_image->y_blocs);
+    new_image->y_infos = calloc(new_image->num_blocs, sizeof(bloc_info_t));
+    new_image->y_store = NULL;
+}
+// stockage compact
+static void allocate_luminance_compact(image16_t* new_image)
+{
+    new_image->y_blocs  = NULL;
+    new_image->y_coeffs = NULL;
+    new_image->y_infos  = calloc(new_image->num_blocs, sizeof(bloc_info_t));
+    new_image->y_store  = create_coeff_store(new_image->num_blocs);
 }
 // sur 8 bits
 static void allocate_luminance_8(image8_t* new_image)
 {
-    new_image->y_blocs = malloc(sizeof(uint8_t*)*(new_image->num_blocs));
+    new_image->y_blocs = calloc(new_image->num_blocs, sizeof(uint8_t*));
 }
 
 /*
@@ -54,18 +84,30 @@ static void allocate_luminance_8(image8_t* new_image)
  */
 static void allocate_colors_16(image16_t* new_image)
 {
-    new_image->cr_blocs = malloc(sizeof(int16_t*)*(new_image->num_blocs));
-    new_image->cb_blocs = malloc(sizeof(int16_t*)*(new_image->num_blocs));
-    for (size_t i=0; i<new_image->num_blocs_Cr; i++)
-        new_image->cr_blocs[i] = calloc(BLOCK_PIXELS, sizeof(int16_t));
-    for (size_t i=0; i<new_image->num_blocs_Cb; i++)
-        new_image->cb_blocs[i] = calloc(BLOCK_PIXELS, sizeof(int16_t));
+    new_image->cr_blocs  = malloc(sizeof(int16_t*)*(new_image->num_blocs_Cr));
+    new_image->cb_blocs  = malloc(sizeof(int16_t*)*(new_image->num_blocs_Cb));
+    new_image->cr_coeffs = allocate_coeffs_16(new_image->num_blocs_Cr, new_image->cr_blocs);
+    new_image->cb_coeffs = allocate_coeffs_16(new_image->num_blocs_Cb, new_image->cb_blocs);
+    new_image->cr_infos = calloc(new_image->num_blocs_Cr, sizeof(bloc_info_t));
+    new_image->cb_infos = calloc(new_image->num_blocs_Cb, sizeof(bloc_info_t));
+    new_image->cr_store = NULL;
+    new_image->cb_store = NULL;
+}
+// stockage compact
+static void allocate_colors_compact(image16_t* new_image)
+{
+    new_image->cr_blocs  = NULL;               new_image->cb_blocs  = NULL;
+    new_image->cr_coeffs = NULL;               new_image->cb_coeffs = NULL;
+    new_image->cr_infos = calloc(new_image->num_blocs_Cr, sizeof(bloc_info_t));
+    new_image->cb_infos = calloc(new_image->num_blocs_Cb, sizeof(bloc_info_t));
+    new_image->cr_store = create_coeff_store(new_image->num_blocs_Cr);
+    new_image->cb_store = create_coeff_store(new_image->num_blocs_Cb);
 }
 // sur 8 bits
 static void allocate_colors_8(image8_t* new_image)
 {
-    new_image->cr_blocs = malloc(sizeof(uint8_t*)*(new_image->num_blocs));
-    new_image->cb_blocs = malloc(sizeof(uint8_t*)*(new_image->num_blocs));
+    new_image->cr_blocs = calloc(new_image->num_blocs_Cr, sizeof(uint8_t*));
+    new_image->cb_blocs = calloc(new_image->num_blocs_Cb, sizeof(uint8_t*));
 }
 
 /*
@@ -96,8 +138,8 @@ void free_image(image8_t* jpeg_image)
 {
     if (jpeg_image->color) {
         /* On libère les blocs de chrominance */
-        free_blocs(jpeg_image->num_blocs, jpeg_image->cb_blocs);
-        free_blocs(jpeg_image->num_blocs, jpeg_image->cr_blocs);
+        free_blocs(jpeg_image->num_blocs_Cb, jpeg_image->cb_blocs);
+        free_blocs(jpeg_image->num_blocs_Cr, jpeg_image->cr_blocs);
         /* On libère les tableaux de pointeurs */
         free(jpeg_image->cb_blocs);
         free(jpeg_image->cr_blocs);
@@ -120,12 +162,21 @@ void free_image(image8_t* jpeg_image)
 static void free_zipped_image(image16_t* jpeg_image)
 {
     if (jpeg_image->color) {
-        /* On libère les tableaux de pointeurs */
+        /* On libère les coefficients et les tableaux de pointeurs */
+        free(jpeg_image->cb_coeffs);
+        free(jpeg_image->cr_coeffs);
         free(jpeg_image->cb_blocs);
         free(jpeg_image->cr_blocs);
+        free(jpeg_image->cb_infos);
+        free(jpeg_image->cr_infos);
+        if (jpeg_image->cb_store) free_coeff_store(jpeg_image->cb_store);
+        if (jpeg_image->cr_store) free_coeff_store(jpeg_image->cr_store);
     }
-    /* Libération du tableau de pointeurs */
+    /* Libération des coefficients et du tableau de pointeurs */
+    free(jpeg_image->y_coeffs);
     free(jpeg_image->y_blocs);
+    free(jpeg_image->y_infos);
+    if (jpeg_image->y_store) free_coeff_store(jpeg_image->y_store);
     free(jpeg_image);
 }
 
@@ -158,19 +209,41 @@ static void init_zip_unzip(struct jpeg_desc *jdesc, image16_t** zip, image8_t**
 
     /* Profil couleur de l'image */
     bool isColor = jdesc->nb_comp>1;
+
+    /* Stockage compact des coefficients : uniquement en mode progressif */
+    bool compact = P_COMPACT && jdesc->isProgressive;
+
+    /* Luminance seule (option -luma) : les chrominances ne sont ni stockées (en
+       baseline, elles sont décodées dans un bloc de rebut) ni transformées */
+    bool luma = P_LUMA && isColor;
     (*zip)->color = isColor; (*unzip)->color = isColor;
 
     /* Initialisation du nombre de blocs */
     (*zip)->bloc_width  = ceil_value(largeur, BLOCK_SIZE);
     (*zip)->bloc_height = ceil_value(hauteur, BLOCK_SIZE);
-    (*zip)->num_blocs   = ceil_value(largeur, h_MCU*BLOCK_SIZE)*h_MCU*ceil_value(hauteur, v_MCU*BLOCK_SIZE)*v_MCU;
+    if (isColor) {
+        jdesc->nb_mcus_h = ceil_value(largeur, h_MCU*BLOCK_SIZE);
+        jdesc->nb_mcus_v = ceil_value(hauteur, v_MCU*BLOCK_SIZE);
+        (*zip)->num_blocs = jdesc->nb_mcus_h*h_MCU*jdesc->nb_mcus_v*v_MCU;
+    } else {
+        /* Image en niveaux de gris : un MCU = un bloc */
+        jdesc->nb_mcus_h = (*zip)->bloc_width;
+        jdesc->nb_mcus_v = (*zip)->bloc_height;
+        (*zip)->num_blocs = (*zip)->bloc_width*(*zip)->bloc_height;
+        jdesc->comp_stride[0]  = (*zip)->bloc_width;
+        jdesc->comp_blocs_h[0] = (*zip)->bloc_width;
+        jdesc->comp_blocs_v[0] = (*zip)->bloc_height;
+    }
     // --
     (*unzip)->bloc_width  = (*zip)->bloc_width;
     (*unzip)->bloc_height = (*zip)->bloc_height;
     (*unzip)->num_blocs   = (*zip)->num_blocs;
+    (*unzip)->bloc_size   = BLOCK_SIZE/P_SCALE;
+    (*unzip)->stats       = NULL;
 
     /* Allocation des composantes de luminance */
-    allocate_luminance_16(*zip);
+    if (compact) allocate_luminance_compact(*zip);
+    else         allocate_luminance_16(*zip);
     allocate_luminance_8(*unzip);
 
     if (isColor) {
@@ -181,18 +254,44 @@ static void init_zip_unzip(struct jpeg_desc *jdesc, image16_t** zip, image8_t**
         jdesc->nb_cp_mcu[2] = get_frame_component_sampling_factor(jdesc, DIR_H, 2)*get_frame_component_sampling_factor(jdesc, DIR_V, 2);
         jdesc->nb_mcus = (*zip)->num_blocs/jdesc->nb_cp_mcu[0];
 
+        /* Dimensions du stockage raster de chaque composante */
+        for (size_t i=COMP_Y; i<COMP_NB; i++) {
+            uint8_t h_comp = get_frame_component_sampling_factor(jdesc, DIR_H, i),
+                    v_comp = get_frame_component_sampling_factor(jdesc, DIR_V, i);
+            jdesc->comp_stride[i]  = jdesc->nb_mcus_h*h_comp;
+            jdesc->comp_blocs_h[i] = ceil_value(ceil_value(largeur*h_comp, h_MCU), BLOCK_SIZE);
+            jdesc->comp_blocs_v[i] = ceil_value(ceil_value(hauteur*v_comp, v_MCU), BLOCK_SIZE);
+        }
+
         /* Nombre total de blocs avant sur-échantillonnage */
         (*zip)->num_blocs_Cb = jdesc->nb_mcus*jdesc->nb_cp_mcu[1];
         (*zip)->num_blocs_Cr = jdesc->nb_mcus*jdesc->nb_cp_mcu[2];
-        (*unzip)->num_blocs_Cb = (*zip)->num_blocs_Cb;
-        (*unzip)->num_blocs_Cr = (*zip)->num_blocs_Cr;
+        (*unzip)->num_blocs_Cb = luma ? 0 : (*zip)->num_blocs_Cb;
+        (*unzip)->num_blocs_Cr = luma ? 0 : (*zip)->num_blocs_Cr;
+
+        /* Allocation des composantes couleur (coefficients conservés en progressif :
+           les scans suivants s'y appuient) */
+        if (luma && !jdesc->isProgressive) {
+            (*zip)->cr_blocs = NULL;         (*zip)->cb_blocs = NULL;
+            (*zip)->cr_infos = NULL;         (*zip)->cb_infos = NULL;
+            (*zip)->cr_coeffs = NULL;        (*zip)->cb_coeffs = NULL;
+            (*zip)->cr_store = NULL;         (*zip)->cb_store = NULL;
+            (*zip)->num_blocs_Cr = 0;        (*zip)->num_blocs_Cb = 0;
+        }
+        else if (compact) allocate_colors_compact(*zip);
+        else              allocate_colors_16(*zip);
 
-        /* Allocation des composantes couleur */
-        allocate_colors_16(*zip);
-        allocate_colors_8(*unzip);
+        if (luma) {
+            (*unzip)->cr_blocs = NULL;       (*unzip)->cb_blocs = NULL;
+        } else {
+            allocate_colors_8(*unzip);
+        }
 
     } else {
         (*zip)->cr_blocs = NULL;         (*zip)->cb_blocs = NULL;
+        (*zip)->cr_infos = NULL;         (*zip)->cb_infos = NULL;
+        (*zip)->cr_coeffs = NULL;        (*zip)->cb_coeffs = NULL;
+        (*zip)->cr_store = NULL;         (*zip)->cb_store = NULL;
         (*unzip)->cr_blocs = NULL;       (*unzip)->cb_blocs = NULL;
 
         (*zip)->num_blocs_Cr = 0;        (*zip)->num_blocs_Cb = 0;
@@ -219,143 +318,140 @@ static char* create_outputname_prog(size_t count)
 }
 
 /*
- * Fonction:  export_copy
+ * Fonction:  export_step
  * --------------------
- * création d'une chaîne de caractères pour le fichier
- * de sortie.
+ * exporte l'image intermédiaire d'une étape de décodage progressif
+ * (option -p) : seuls les blocs dont les coefficients ont changé pendant
+ * le scan sont transformés, en place dans l'image 8 bits qui deviendra
+ * l'image finale, puis celle-ci est exportée.
  * 
- *  jdesc     : descripteur JPEG
- *  zip_image : image 16 bits compressée
- *  count     : itération de décodage progressif
+ *  jdesc          : descripteur JPEG
+ *  zip_image      : image 16 bits compressée
+ *  unzipped_image : image 8 bits décompressée, mise à jour en place
+ *  count          : itération de décodage progressif
  *
  */
-static void export_copy(struct jpeg_desc *jdesc, image16_t* zip_image, size_t count)
+static void export_step(struct jpeg_desc *jdesc, image16_t* zip_image, image8_t* unzipped_image, size_t count)
 {
-    /* Création d'une copie complète de zip_image */
-    image16_t* zip_copy = malloc(sizeof(image16_t));
-    image8_t* unzipped_image = malloc(sizeof(image8_t));
-
-    /* Copie des champs primaires */
-    zip_copy->color        = zip_image->color;
-    zip_copy->num_blocs    = zip_image->num_blocs;
-    zip_copy->num_blocs_Cb = zip_image->num_blocs_Cb;
-    zip_copy->num_blocs_Cr = zip_image->num_blocs_Cr;
-    zip_copy->bloc_width   = zip_image->bloc_width;
-    zip_copy->bloc_height  = zip_image->bloc_height;
-
-    /* Initialisation de la sortie décompressée */
-    unzipped_image->color        = zip_image->color;
-    unzipped_image->num_blocs    = zip_image->num_blocs;
-    unzipped_image->num_blocs_Cb = zip_image->num_blocs_Cb;
-    unzipped_image->num_blocs_Cr = zip_image->num_blocs_Cr;
-    unzipped_image->bloc_width   = zip_image->bloc_width;
-    unzipped_image->bloc_height  = zip_image->bloc_height;
-
-    /* Copie des blocs */
-    allocate_luminance_16(zip_copy);
-    allocate_luminance_8(unzipped_image);
-    for (size_t i=0; i<zip_image->num_blocs; i++) {
-        memcpy(zip_copy->y_blocs[i], zip_image->y_blocs[i], sizeof(int16_t)*BLOCK_PIXELS);
-    }
-    //
-    if (zip_copy->color) {
-        allocate_colors_16(zip_copy);
-        allocate_colors_8(unzipped_image);
-        for (size_t i=0; i<zip_image->num_blocs_Cb; i++) {
-            memcpy(zip_copy->cb_blocs[i], zip_image->cb_blocs[i], sizeof(int16_t)*BLOCK_PIXELS);
-        }
-        for (size_t i=0; i<zip_image->num_blocs_Cr; i++) {
-            memcpy(zip_copy->cr_blocs[i], zip_image->cr_blocs[i], sizeof(int16_t)*BLOCK_PIXELS);
-        }
-    }
-
-    /* Décompression des blocs */    
+    /* Décompression des blocs modifiés par le scan */
     if (P_MULTITHREAD)
-        unzip_parallel(jdesc, zip_copy, unzipped_image);
+        unzip_parallel(jdesc, zip_image, unzipped_image);
     else
-        unzip_image(jdesc, zip_copy, unzipped_image);
-
-    /* Upsampling de l'image */
-    if (zip_copy->color) upsamples(unzipped_image, jdesc);
+        unzip_image(jdesc, zip_image, unzipped_image);
 
-    /* Exportation PPM de l'image intermédiaire */
+    /* Exportation de l'image intermédiaire (PPM/PGM ou format de sortie choisi) */
     char* outputname = create_outputname_prog(count);
-    if (zip_copy->color) {
-        export_ppm(unzipped_image, jdesc, outputname);
-    } else {
-        export_pgm(unzipped_image, jdesc, outputname);
-    }
+    export_img(unzipped_image, jdesc, outputname);
     free(outputname);
+}
 
-    /* Libération de la copie */
-    free_zipped_image(zip_copy);
+/*
+ * Fonction:  print_store_memory
+ * --------------------
+ * affiche (mode verbose) la mémoire occupée par le stockage
+ * compact des coefficients, comparée au stockage dense.
+ *
+ *  zip_image : image 16 bits compressée
+ *
+ */
+static void print_store_memory(image16_t* zip_image)
+{
+    size_t num_blocs = zip_image->num_blocs + zip_image->num_blocs_Cb + zip_image->num_blocs_Cr;
 
-    /* Libération de la version décompressée */
-    free_image(unzipped_image);
+    /* Stockage dense : coefficients et pointeurs de blocs */
+    size_t dense   = num_blocs*(sizeof(int16_t)*BLOCK_PIXELS + sizeof(int16_t*));
+    size_t compact = coeff_store_bytes(zip_image->y_store);
+    if (zip_image->color)
+        compact += coeff_store_bytes(zip_image->cb_store) + coeff_store_bytes(zip_image->cr_store);
+
+    INFO_MSG("* Stockage compact : %zu octets (dense : %zu octets, %.1f%% économisés)\n",
+             compact, dense, 100.0*(1.0 - (double)compact/dense));
 }
 
 /*
- * Fonction:  remap_mcus
+ * Fonction:  scan_nb_blocs
  * --------------------
- * renvoie un tableau associant l'index du bloc
- * dans une grille 2D "lambda" à l'index du bloc
- * réel paramétré par les dimensions des MCUs.
+ * renvoie le nombre de blocs d'une composante parcourus
+ * par un scan non entrelacé.
+ *
+ *  jdesc : descripteur JPEG de l'image ouverte
+ *  comp  : composante parcourue
+ *
+ */
+size_t scan_nb_blocs(const struct jpeg_desc *jdesc, uint8_t comp)
+{
+    return (size_t)jdesc->comp_blocs_h[comp]*jdesc->comp_blocs_v[comp];
+}
+
+/*
+ * Fonction:  scan_bloc_index
+ * --------------------
+ * renvoie l'index dans le stockage raster d'une composante
+ * du bloc lu en position [scan_index] par un scan non entrelacé.
  *
  *  jdesc      : descripteur JPEG de l'image ouverte
- *  jpeg_image : image JPEG couleur à exporter
- *  comp       : composante sélectionnée à réordonner
- * 
+ *  comp       : composante parcourue
+ *  scan_index : numéro du bloc dans le scan
+ *
  */
-uint32_t* remap_mcus(struct jpeg_desc *jdesc, image16_t* jpeg_image, uint8_t comp)
+size_t scan_bloc_index(const struct jpeg_desc *jdesc, uint8_t comp, size_t scan_index)
 {
-    uint8_t h_MCU = get_frame_component_sampling_factor(jdesc, DIR_H, comp),
-            v_MCU = get_frame_component_sampling_factor(jdesc, DIR_V, comp);
-
-    size_t  blocs_largeur = jpeg_image->bloc_width,  // Largeur en nombre de blocs
-            blocs_hauteur = jpeg_image->bloc_height, // Hauteur en nombre de blocs
-            bloc_offset = 0,                         // Indice du bloc en tête de la ligne courante
-            index = 0,                               // Index global dans le tableau à renvoyer
-            curw_blocs,                              // Nombre courant de blocs écrits en largeur
-            curw_mcu,                                // Nombre courant de blocs écrits en largeur dans le MCU
-            curh_blocs = 0,                          // Nombre total de blocs écrits en hauteur
-            curh_mcu = 0,                            // Nombre courant de blocs écrits en hauteur dans le MCU
-            cur_index = 0,                           // Index du bloc en tête du MCU courant
-            line_offset = h_MCU*v_MCU,               // Saut d'une ligne à l'autre
-            col_offset = blocs_largeur*v_MCU;        // Saut d'une colonne à l'autre
-
-    /* Tableau associé reliant ancien index à nouvel index */
-    uint32_t *index_map = malloc(sizeof(uint32_t)*jpeg_image->num_blocs);
-
-    while (curh_blocs < blocs_hauteur) {
-        curw_blocs = 0;
-        curw_mcu = 0;
-        while (curw_blocs < blocs_largeur) {
-            if (curw_mcu == h_MCU) {
-                // On saute au MCU suivant en ligne
-                cur_index += line_offset;
-                curw_mcu = 0;
-            }
-            // Calcul de l'index du bloc courant
-            index_map[index] = cur_index+curw_mcu;
-
-            curw_blocs++;
-            curw_mcu++;
-            index++;
-        }
-        curh_blocs++; 
-        curh_mcu++;
+    /* Les MCUs incomplets ne sont pas parcourus en non entrelacé */
+    if (jdesc->comp_blocs_h[comp] == jdesc->comp_stride[comp])
+        return scan_index;
 
-        // On saute au MCU suivant en colonne
-        if (curh_mcu < v_MCU) {
-            cur_index = bloc_offset+h_MCU;
-        } else {
-            bloc_offset += col_offset;
-            cur_index += h_MCU;
-            curh_mcu = 0;
-        }
-    }
+    size_t ligne   = scan_index/jdesc->comp_blocs_h[comp],
+           colonne = scan_index%jdesc->comp_blocs_h[comp];
+    return ligne*jdesc->comp_stride[comp] + colonne;
+}
 
-    return index_map;
+/*
+ * Fonction:  mcu_bloc_index
+ * --------------------
+ * renvoie l'index dans le stockage raster d'une composante
+ * du bloc [bloc] du MCU [mcu] (scans entrelacés).
+ *
+ *  jdesc : descripteur JPEG de l'image ouverte
+ *  comp  : composante du bloc
+ *  mcu   : numéro du MCU, dans l'ordre du flux
+ *  bloc  : numéro du bloc dans le MCU
+ *
+ */
+size_t mcu_bloc_index(const struct jpeg_desc *jdesc, uint8_t comp, size_t mcu, uint8_t bloc)
+{
+    uint8_t h_comp = get_frame_component_sampling_factor(jdesc, DIR_H, comp),
+            v_comp = get_frame_component_sampling_factor(jdesc, DIR_V, comp);
+
+    size_t ligne   = (mcu/jdesc->nb_mcus_h)*v_comp + bloc/h_comp,
+           colonne = (mcu%jdesc->nb_mcus_h)*h_comp + bloc%h_comp;
+    return ligne*jdesc->comp_stride[comp] + colonne;
+}
+
+/*
+ * Fonction:  mcu_order_index
+ * --------------------
+ * convertit un index du stockage raster d'une composante
+ * en index dans l'ordre des MCUs (ordre attendu par l'upsampling
+ * et l'export).
+ *
+ *  jdesc : descripteur JPEG de l'image ouverte
+ *  comp  : composante du bloc
+ *  index : index raster du bloc
+ *
+ */
+size_t mcu_order_index(const struct jpeg_desc *jdesc, uint8_t comp, size_t index)
+{
+    /* Niveaux de gris : les deux ordres sont confondus */
+    if (jdesc->nb_comp == 1)
+        return index;
+
+    uint8_t h_comp = get_frame_component_sampling_factor(jdesc, DIR_H, comp),
+            v_comp = get_frame_component_sampling_factor(jdesc, DIR_V, comp);
+
+    size_t ligne   = index/jdesc->comp_stride[comp],
+           colonne = index%jdesc->comp_stride[comp],
+           mcu     = (ligne/v_comp)*jdesc->nb_mcus_h + colonne/h_comp;
+    return mcu*h_comp*v_comp + (ligne%v_comp)*h_comp + colonne%h_comp;
 }
 
 /*
@@ -376,50 +472,40 @@ image8_t* extract_image(struct jpeg_desc *jdesc)
     /* Initialisation des variables source\destination */
     init_zip_unzip(jdesc, &zip_image, &unzipped_image);
 
-    /* Remapping des MCUs */
-    if (zip_image->color) for (size_t i=COMP_Y; i<COMP_NB; i++)
-        jdesc->mcu_maps[i] = remap_mcus(jdesc, zip_image, i);
+    /* Facteurs d'échantillonnage (suréchantillonnage fait à l'export) */
+    if (zip_image->color) check_sampling_factors(jdesc);
 
     /* On extrait tous les blocs : luminance et chrominances */
     size_t count = 0;
     if (jdesc->isProgressive) {
-        /* Cas progressif ->
-            On extrait chaque frame, en reparsant les sections SOS et DHT */
-        do {
-            print_offset(jdesc->bitstream);
-            if (jdesc->prog_ss == 0) {
-                if (jdesc->prog_ah == 0) {
-                    INFO_MSG("-- First DC\n");
-                    if (zip_image->color)
-                        extract_first_DC_blocs_color(jdesc, zip_image);
-                    else
-                        extract_first_DC_blocs_grey(jdesc, zip_image);
-                } else {
-                    INFO_MSG("-- Next DC\n");
-                    if (zip_image->color)
-                        extract_next_DC_blocs_color(jdesc, zip_image);
-                    else
-                        extract_next_DC_blocs_grey(jdesc, zip_image);
+        /* Cas progressif, option -m : scans indépendants décodés en parallèle
+           (stockage dense, pas d'image intermédiaire) */
+        if (P_MULTITHREAD && !P_PROG_STEP && zip_image->y_store == NULL) {
+            extract_scans_parallel(jdesc, zip_image);
+        } else {
+            /* Cas progressif ->
+                On extrait chaque frame, en reparsant les sections SOS et DHT */
+            do {
+                print_offset(jdesc->bitstream);
+                extract_scan(jdesc, zip_image);
+
+                /* Stockage compact : on récupère les emplacements libérés par le scan */
+                if (zip_image->y_store != NULL) {
+                    compact_coeff_store(zip_image->y_store);
+                    if (zip_image->color) {
+                        compact_coeff_store(zip_image->cb_store);
+                        compact_coeff_store(zip_image->cr_store);
+                    }
                 }
-            } else if (jdesc->prog_ah == 0) {
-                INFO_MSG("-- First AC\n");
-                if (zip_image->color)
-                    extract_first_AC_blocs_color(jdesc, zip_image);
-                else
-                    extract_first_AC_blocs_grey(jdesc, zip_image);
-            } else {
-                INFO_MSG("-- Next AC\n");
-                if (zip_image->color)
-                    extract_next_AC_blocs_color(jdesc, zip_image);
-                else
-                    extract_next_AC_blocs_grey(jdesc, zip_image);
-            }
-
-            /* Extraction d'une copie intermédiaire de l'image */
-            if (P_PROG_STEP) export_copy(jdesc, zip_image, count);
-            count++;
-            // if (count == 5) break;
-        } while (next_progressive_scan(jdesc));
+
+                /* Extraction de l'image intermédiaire, mise à jour en place */
+                if (P_PROG_STEP) export_step(jdesc, zip_image, unzipped_image, count);
+                count++;
+                // if (count == 5) break;
+            } while (next_progressive_scan(jdesc));
+        }
+
+        if (zip_image->y_store != NULL) print_store_memory(zip_image);
     } else {
         /* Cas baseline */
         if (zip_image->color)
@@ -429,16 +515,14 @@ image8_t* extract_image(struct jpeg_desc *jdesc)
     }
 
     if (P_BLABLA) jpeg_blabla(jdesc, zip_image);
+    if (P_BENCH) idct_bench(jdesc, zip_image);
 
-    /* Décompression des blocs */    
+    /* Décompression des blocs (déjà à jour après chaque scan avec l'option -p) */    
     if (P_MULTITHREAD)
         unzip_parallel(jdesc, zip_image, unzipped_image);
     else
         unzip_image(jdesc, zip_image, unzipped_image);
 
-    /* Upsampling de l'image */
-    if (zip_image->color) upsamples(unzipped_image, jdesc);
-
     /* Libération de l'image compressée intermédiaire */
     free_zipped_image(zip_image);
 
@@ -1,9 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
-#define M_PI 3.14159265358979323846
+#include "idct.h"
+#include "jpeg_const.h"
+#include "iqzz.h"
+#include "loeffler.h"
+#include "loeffler_int.h"
+#include "loeffler_simd.h"
 
 /* Stockage des coefficients utiles pour l'iDCT */
 #define a_c 0.98078528040323044912618223613
@@ -16,62 +22,174 @@
 
 
 // Tableau avec les coeffs pour le calcul tab_coefs[i][j] = cos((2i+1)j*M_PI/16)
-static float tab_coefs[8][8] = {{1.0,  a_c,  e_c,  b_c,  g_c,  c_c,  f_c,  d_c},
-                                {1.0,  b_c,  f_c, -d_c, -g_c, -a_c, -e_c, -c_c},
-                                {1.0,  c_c, -f_c, -a_c, -g_c,  d_c,  e_c,  b_c},
-                                {1.0,  d_c, -e_c, -c_c,  g_c,  b_c, -f_c, -a_c},
-                                {1.0, -d_c, -e_c,  c_c,  g_c, -b_c, -f_c,  a_c},
-                                {1.0, -c_c, -f_c,  a_c, -g_c, -d_c,  e_c, -b_c},
-                                {1.0, -b_c,  f_c,  d_c, -g_c,  a_c, -e_c,  c_c},
-                                {1.0, -a_c,  e_c, -b_c,  g_c, -c_c,  f_c, -d_c}};
+static const double tab_coefs[8][8] = {{1.0,  a_c,  e_c,  b_c,  g_c,  c_c,  f_c,  d_c},
+                                       {1.0,  b_c,  f_c, -d_c, -g_c, -a_c, -e_c, -c_c},
+                                       {1.0,  c_c, -f_c, -a_c, -g_c,  d_c,  e_c,  b_c},
+                                       {1.0,  d_c, -e_c, -c_c,  g_c,  b_c, -f_c, -a_c},
+                                       {1.0, -d_c, -e_c,  c_c,  g_c, -b_c, -f_c,  a_c},
+                                       {1.0, -c_c, -f_c,  a_c, -g_c, -d_c,  e_c, -b_c},
+                                       {1.0, -b_c,  f_c,  d_c, -g_c,  a_c, -e_c,  c_c},
+                                       {1.0, -a_c,  e_c, -b_c,  g_c, -c_c,  f_c, -d_c}};
+
+/* Moteurs d'iDCT sélectionnables (option -idct=) */
+const struct idct_engine_desc IDCT_ENGINES[IDCT_NB_ENGINES] = {
+    [IDCT_REF]   = {"ref",   idct_reference,         idct_reference_signe,         1,                   CPU_SCALAR},
+    [IDCT_FLOAT] = {"float", loeffler_idct_loeffler, loeffler_idct_loeffler_signe, IDCT_PRESCALE_FLOAT, CPU_SCALAR},
+    [IDCT_INT]   = {"int",   loeffler_idct_int,      loeffler_idct_int_signe,      1,                   CPU_SCALAR},
+    [IDCT_SSE2]  = {"sse2",  loeffler_idct_sse2,     loeffler_idct_sse2_signe,     IDCT_PRESCALE_FLOAT, CPU_SSE2},
+    [IDCT_AVX2]  = {"avx2",  loeffler_idct_avx2,     loeffler_idct_avx2_signe,     IDCT_PRESCALE_FLOAT, CPU_AVX2},
+};
+
+/* Côté du carré de coefficients non nuls de chaque chemin d'iDCT */
+const uint8_t IDCT_PATH_SIZE[IDCT_NB_PATHS] = {1, 2, 4, 8};
+
+/* Masques zig-zag des carrés 2x2 et 4x4 en haut à gauche du bloc */
+#define MASK_2x2 UINT64_C(0x17)
+#define MASK_4x4 UINT64_C(0x1063bff)
+
 
 /*
  * Fonction:  C
  * --------------------
  * fonction mathématique C définie dans le poly
  */
-static float C(uint8_t lambda)
+static double C(uint8_t lambda)
 {
-  float racine = 1.41421356237309504880168872420;
-  return (lambda == 0) ? (1.0/racine) : 1.0;
+    double racine = 1.41421356237309504880168872420;
+    return (lambda == 0) ? (1.0/racine) : 1.0;
 }
 
 /*
- * Fonction:  inv_DCT
+ * Fonction:  idct_reference_calcul
  * --------------------
- * transformée DCT inverse sur le bloc passé en paramètres
- * passe de fréquentiel [-128, 127] à spatial [0, 255]
+ * iDCT de référence, par application directe de la formule (en O(n^4),
+ * en double précision), sans recentrage ni arrondi
  *
- * renvoie : bloc de 64 entiers sur 8 bits avec DCT inverse appliquée
+ *    bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+ *  qtable : table de quantification en ordre naturel (non mise à l'échelle)
+ *     eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+ *  sortie : reçoit les 64 échantillons spatiaux, centrés sur 0
  */
-uint8_t* inv_DCT(int16_t* bloc)
+static void idct_reference_calcul(const int16_t *bloc, const int32_t *qtable, uint8_t eob, double sortie[BLOCK_PIXELS])
 {
     uint8_t colonne, ligne;
-    /* Allocation d'un nouveau bloc de valeurs sur 8 bits */
-    uint8_t* nvx_bloc = malloc(64*sizeof(uint8_t));
+    int32_t coeffs[BLOCK_PIXELS];
+
+    iqzz_int(coeffs, bloc, qtable, eob);
     for (uint8_t x = 0; x < 8; x++) {
         /* Calcul de S(x,y) */
         for (uint8_t y = 0; y < 8; y++) {
-            float valeur = 0.0;
+            double valeur = 0.0;
             /* Application du produit sur toutes les valeurs du bloc*/
             for (uint8_t i = 0; i < 64; i++) {
                 colonne = i % 8;
                 ligne = (i - colonne) / 8;
-                valeur += C(ligne)*C(colonne)*tab_coefs[x][ligne]*tab_coefs[y][colonne]*bloc[i];
-            }
-            valeur *= 0.25;
-            valeur += 128.0;
-            
-            /* Saturation des valeurs sur 8 bits */
-            if (valeur < 0.0) {
-                valeur = 0.0;
-            } else if (valeur > 255.0) {
-                valeur = 255.0;
+                valeur += C(ligne)*C(colonne)*tab_coefs[x][ligne]*tab_coefs[y][colonne]*coeffs[i];
             }
-            nvx_bloc[8*x + y] = (uint8_t) round(valeur);
+            sortie[8*x + y] = valeur*0.25;
+        }
+    }
+}
+
+/*
+ * Fonction:  idct_reference
+ * --------------------
+ * iDCT de référence : sert de base de comparaison aux autres moteurs.
+ * passe de fréquentiel [-128, 127] à spatial [0, 255]
+ *
+ *    bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+ *  qtable : table de quantification en ordre naturel (non mise à l'échelle)
+ *     eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+ *  taille : inutilisé (tous les coefficients sont parcourus)
+ *
+ * renvoie : bloc de 64 entiers sur 8 bits avec DCT inverse appliquée
+ */
+uint8_t *idct_reference(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille)
+{
+    (void) taille;
+    double valeurs[BLOCK_PIXELS];
+    /* Allocation d'un nouveau bloc de valeurs sur 8 bits */
+    uint8_t* nvx_bloc = malloc(BLOCK_PIXELS*sizeof(uint8_t));
+
+    idct_reference_calcul(bloc, qtable, eob, valeurs);
+    for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+        double valeur = valeurs[i] + 128.0;
+
+        /* Saturation des valeurs sur 8 bits */
+        if (valeur < 0.0) {
+            valeur = 0.0;
+        } else if (valeur > 255.0) {
+            valeur = 255.0;
         }
+        nvx_bloc[i] = (uint8_t) round(valeur);
     }
-    free(bloc);
 
     return nvx_bloc;
 }
+
+/*
+ * Fonction:  idct_reference_signe
+ * --------------------
+ * iDCT de référence, sortie signée (voir idct_signe_fn)
+ *
+ *  sortie : reçoit les 64 échantillons arrondis et bornés
+ */
+void idct_reference_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie)
+{
+    (void) taille;
+    double valeurs[BLOCK_PIXELS];
+
+    idct_reference_calcul(bloc, qtable, eob, valeurs);
+    for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+        sortie[i] = idct_arrondi_signe(valeurs[i]);
+    }
+}
+
+/*
+ * Fonction:  idct_arrondi_signe
+ * --------------------
+ * arrondit un échantillon de sortie d'iDCT à l'entier le plus proche
+ * (les demis vers +inf, comme le recentrage sur [0, 255] puis l'arrondi
+ * des moteurs) et le borne à [IDCT_SIGNE_MIN, IDCT_SIGNE_MAX]
+ *
+ *  valeur : échantillon centré sur 0
+ */
+int16_t idct_arrondi_signe(double valeur)
+{
+    double arrondi = floor(valeur + 0.5);
+    if (arrondi < IDCT_SIGNE_MIN) return IDCT_SIGNE_MIN;
+    if (arrondi > IDCT_SIGNE_MAX) return IDCT_SIGNE_MAX;
+    return (int16_t) arrondi;
+}
+
+/*
+ * Fonction:  idct_engine_from_name
+ * --------------------
+ * renvoie le moteur d'iDCT désigné par [nom] (option -idct=)
+ *
+ *  nom : nom du moteur (ref, float, int, sse2 ou avx2)
+ */
+enum idct_engine idct_engine_from_name(const char *nom)
+{
+    for (enum idct_engine moteur = 0; moteur < IDCT_NB_ENGINES; moteur++) {
+        if (!strcmp(nom, IDCT_ENGINES[moteur].nom)) return moteur;
+    }
+
+    EXIT_ERROR("idct", "Moteur d'iDCT inconnu : %s", nom);
+}
+
+/*
+ * Fonction:  idct_path
+ * --------------------
+ * renvoie le chemin d'iDCT d'un bloc d'après son masque de coefficients
+ * non nuls : DC seul, carré 2x2, carré 4x4 ou bloc complet.
+ *
+ *  mask : masque zig-zag des coefficients non nuls du bloc
+ */
+enum idct_path idct_path(uint64_t mask)
+{
+    if ((mask & ~UINT64_C(1)) == 0) return IDCT_PATH_DC;
+    if ((mask & ~MASK_2x2) == 0)    return IDCT_PATH_2x2;
+    if ((mask & ~MASK_4x4) == 0)    return IDCT_PATH_4x4;
+    return IDCT_PATH_FULL;
+}
@@ -0,0 +1,456 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "idct_bench.h"
+#include "idct.h"
+#include "iqzz.h"
+#include "jpeg_const.h"
+#include "jpeg_reader.h"
+#include "cpu_dispatch.h"
+#include "coeff_store.h"
+#include "loeffler_simd.h"
+
+/*
+    Banc d'essai des moteurs d'iDCT (option -bench) : chaque moteur disponible
+    au niveau de jeu d'instructions retenu traite les blocs de l'image décodée
+    puis des blocs aléatoires générés comme dans la norme IEEE 1180-1990.
+    Son débit est mesuré en blocs par seconde sur sa version utilisée au
+    décodage (sorties recentrées et saturées sur [0, 255]). Ses erreurs sont
+    mesurées sur sa variante signée (idct_signe_fn) : mêmes calculs, sorties
+    arrondies et bornées à [-256, 255] avant recentrage et saturation, comme
+    dans la norme, comparées à celles de l'iDCT de référence. Chaque plage et
+    chaque signe des blocs aléatoires fait l'objet d'un verdict de conformité.
+    Les iDCT par lots (un bloc par voie SIMD) sont mesurées de la même façon,
+    les blocs consécutifs de même table étant groupés par lots complets.
+*/
+
+#define PI 3.14159265358979323846
+
+/* Blocs aléatoires par plage et par signe */
+#define NB_ALEATOIRES 10000
+
+/* Plages [-L, H] des échantillons des blocs aléatoires (IEEE 1180) */
+static const int32_t PLAGES[][2] = {{256, 255}, {5, 5}, {300, 300}};
+#define NB_PLAGES (sizeof(PLAGES)/sizeof(PLAGES[0]))
+
+/* iDCT par lots, hors de IDCT_ENGINES car non sélectionnables par -idct= */
+static const struct
+{
+    const char*        nom;
+    idct_lot_fn        lot;
+    idct_lot_signe_fn  signe;
+    uint8_t            voies;     // Blocs par lot
+    enum cpu_tier      niveau;    // Niveau de jeu d'instructions requis
+} MOTEURS_LOT[] = {
+    {"lot8",  loeffler_idct_lot_avx2,   loeffler_idct_lot_avx2_signe,   8,  CPU_AVX2},
+    {"lot16", loeffler_idct_lot_avx512, loeffler_idct_lot_avx512_signe, 16, CPU_AVX512},
+};
+#define NB_MOTEURS_LOT (sizeof(MOTEURS_LOT)/sizeof(MOTEURS_LOT[0]))
+
+/* Seuils de conformité IEEE 1180 */
+#define IEEE_PIC        1
+#define IEEE_EQM_PIXEL  0.06
+#define IEEE_EQM        0.02
+#define IEEE_MOY_PIXEL  0.015
+#define IEEE_MOY        0.0015
+
+/* Tables de quantification des blocs de test */
+enum { TABLE_Y, TABLE_C, TABLE_UNITE, NB_TABLES };
+
+/* Lot de blocs de test, coefficients quantifiés en ordre naturel */
+typedef struct
+{
+    size_t    nb;           // Nombre de blocs
+    int16_t*  coeffs;       // Coefficients (BLOCK_PIXELS par bloc)
+    uint8_t*  tables;       // Table de quantification de chaque bloc
+    uint8_t*  eobs;         // Nombre de coefficients zig-zag utiles
+    uint8_t*  tailles;      // Côté du carré des coefficients non nuls
+    int16_t*  references;   // Sorties signées de l'iDCT de référence
+} lot_t;
+
+/* Erreurs d'un moteur par rapport à la référence, sur un lot */
+typedef struct
+{
+    uint16_t  pic;                       // Erreur absolue maximale
+    int64_t   somme[BLOCK_PIXELS];       // Somme des erreurs, par pixel
+    uint64_t  carres[BLOCK_PIXELS];      // Somme des carrés des erreurs, par pixel
+} erreurs_t;
+
+
+/*
+ * Fonction:  ieee_rand
+ * --------------------
+ * générateur pseudo-aléatoire de la norme IEEE 1180 : renvoie
+ * un entier uniforme dans [-L, H]
+ *
+ *  graine : état du générateur
+ *  L, H   : bornes de l'intervalle
+ */
+static int32_t ieee_rand(uint32_t* graine, int32_t L, int32_t H)
+{
+    *graine = *graine*1103515245u + 12345u;
+    double x = (double)(*graine & 0x7ffffffe)/(double)0x7fffffff;
+    return (int32_t)(x*(L + H + 1)) - L;
+}
+
+/*
+ * Fonction:  lot_alloue
+ * --------------------
+ * alloue un lot de [nb] blocs de test
+ *
+ */
+static void lot_alloue(lot_t* lot, size_t nb)
+{
+    lot->nb         = nb;
+    lot->coeffs     = calloc(nb*BLOCK_PIXELS, sizeof(int16_t));
+    lot->tables     = malloc(nb*sizeof(uint8_t));
+    lot->eobs       = malloc(nb*sizeof(uint8_t));
+    lot->tailles    = malloc(nb*sizeof(uint8_t));
+    lot->references = malloc(nb*BLOCK_PIXELS*sizeof(int16_t));
+}
+
+static void lot_libere(lot_t* lot)
+{
+    free(lot->coeffs); free(lot->tables); free(lot->eobs);
+    free(lot->tailles); free(lot->references);
+}
+
+/*
+ * Fonction:  lot_image
+ * --------------------
+ * rassemble dans un lot tous les blocs d'une image (développés
+ * s'ils sont en stockage compact)
+ *
+ *  lot   : lot à remplir
+ *  image : image compressée
+ */
+static void lot_image(lot_t* lot, const image16_t* image)
+{
+    size_t nb_comp = image->color ? 3 : 1;
+    size_t nb_blocs[3] = {image->num_blocs, image->num_blocs_Cb, image->num_blocs_Cr};
+    int16_t** blocs[3] = {image->y_blocs, image->cb_blocs, image->cr_blocs};
+    bloc_info_t* infos[3] = {image->y_infos, image->cb_infos, image->cr_infos};
+    coeff_store_t* stores[3] = {image->y_store, image->cb_store, image->cr_store};
+
+    size_t total = 0;
+    for (size_t c = 0; c < nb_comp; c++) total += nb_blocs[c];
+    lot_alloue(lot, total);
+
+    size_t n = 0;
+    for (size_t c = 0; c < nb_comp; c++) {
+        for (size_t j = 0; j < nb_blocs[c]; j++, n++) {
+            int16_t* dest = &lot->coeffs[n*BLOCK_PIXELS];
+            if (stores[c] == NULL)
+                memcpy(dest, blocs[c][j], sizeof(int16_t)*BLOCK_PIXELS);
+            else
+                expand_bloc(stores[c], j, infos[c][j].mask, dest);
+
+            lot->tables[n]  = (c > 0) ? TABLE_C : TABLE_Y;
+            lot->eobs[n]    = infos[c][j].eob;
+            lot->tailles[n] = IDCT_PATH_SIZE[idct_path(infos[c][j].mask)];
+        }
+    }
+}
+
+/*
+ * Fonction:  lot_aleatoire
+ * --------------------
+ * génère les blocs aléatoires de la norme IEEE 1180 pour une plage et
+ * un signe : blocs de pixels uniformes sur la plage (ou leurs opposés),
+ * passés dans une DCT directe en double précision, arrondie et saturée
+ * sur [-2048, 2047]
+ *
+ *  lot    : lot à remplir
+ *  plage  : indice de la plage dans PLAGES
+ *  signe  : 1, ou -1 pour les blocs opposés
+ *  graine : état du générateur, partagé entre les lots
+ */
+static void lot_aleatoire(lot_t* lot, size_t plage, int8_t signe, uint32_t* graine)
+{
+    double cosinus[BLOCK_SIZE][BLOCK_SIZE]; // cosinus[x][u] = C(u)/2 * cos((2x+1)u*pi/16)
+    for (uint8_t x = 0; x < BLOCK_SIZE; x++)
+    for (uint8_t u = 0; u < BLOCK_SIZE; u++) {
+        cosinus[x][u] = ((u == 0) ? sqrt(0.5) : 1.0)/2*cos((2*x + 1)*u*PI/16);
+    }
+
+    lot_alloue(lot, NB_ALEATOIRES);
+
+    for (size_t n = 0; n < NB_ALEATOIRES; n++) {
+        double pixels[BLOCK_PIXELS];
+        for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+            pixels[i] = signe*ieee_rand(graine, PLAGES[plage][0], PLAGES[plage][1]);
+        }
+
+        int16_t* coeffs = &lot->coeffs[n*BLOCK_PIXELS];
+        for (uint8_t v = 0; v < BLOCK_SIZE; v++)
+        for (uint8_t u = 0; u < BLOCK_SIZE; u++) {
+            double somme = 0.0;
+            for (uint8_t y = 0; y < BLOCK_SIZE; y++)
+            for (uint8_t x = 0; x < BLOCK_SIZE; x++) {
+                somme += cosinus[y][v]*cosinus[x][u]*pixels[BLOCK_SIZE*y + x];
+            }
+            somme = round(somme);
+            coeffs[BLOCK_SIZE*v + u] = (int16_t)((somme < -2048) ? -2048 : ((somme > 2047) ? 2047 : somme));
+        }
+
+        lot->tables[n]  = TABLE_UNITE;
+        lot->eobs[n]    = BLOCK_PIXELS;
+        lot->tailles[n] = BLOCK_SIZE;
+    }
+}
+
+/*
+ * Fonction:  compare_sorties
+ * --------------------
+ * cumule les erreurs des sorties signées d'un lot par rapport à celles
+ * de la référence du lot
+ *
+ *  lot     : lot de blocs
+ *  sorties : sorties signées du moteur (BLOCK_PIXELS par bloc)
+ *  erreurs : erreurs à cumuler
+ */
+static void compare_sorties(const lot_t* lot, const int16_t* sorties, erreurs_t* erreurs)
+{
+    for (size_t n = 0; n < lot->nb; n++)
+    for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+        int32_t e = (int32_t)sorties[n*BLOCK_PIXELS + i] - lot->references[n*BLOCK_PIXELS + i];
+        uint16_t a = (uint16_t)abs(e);
+        if (a > erreurs->pic) erreurs->pic = a;
+        erreurs->somme[i]  += e;
+        erreurs->carres[i] += (uint64_t)(e*e);
+    }
+}
+
+/*
+ * Fonction:  lot_passe
+ * --------------------
+ * passe tous les blocs d'un lot dans un moteur d'iDCT (passe chronométrée,
+ * version du décodage), puis dans sa variante signée : si [erreurs] est non
+ * NULL, les sorties signées sont comparées à celles de la référence du lot,
+ * sinon elles sont rangées comme sorties de référence.
+ * renvoie la durée de la passe chronométrée en secondes
+ *
+ *  lot     : lot de blocs
+ *  moteur  : moteur d'iDCT
+ *  tables  : tables de quantification mises à l'échelle du moteur
+ *  erreurs : erreurs à cumuler (NULL pour la passe de référence)
+ */
+static double lot_passe(lot_t* lot, const struct idct_engine_desc* moteur, int32_t* tables[NB_TABLES], erreurs_t* erreurs)
+{
+    struct timespec debut, fin;
+
+    clock_gettime(CLOCK_MONOTONIC, &debut);
+    for (size_t n = 0; n < lot->nb; n++) {
+        free(moteur->idct(&lot->coeffs[n*BLOCK_PIXELS], tables[lot->tables[n]], lot->eobs[n], lot->tailles[n]));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+
+    int16_t* sorties = (erreurs == NULL) ? lot->references : malloc(lot->nb*BLOCK_PIXELS*sizeof(int16_t));
+    for (size_t n = 0; n < lot->nb; n++) {
+        moteur->signe(&lot->coeffs[n*BLOCK_PIXELS], tables[lot->tables[n]], lot->eobs[n], lot->tailles[n],
+                      &sorties[n*BLOCK_PIXELS]);
+    }
+    if (erreurs != NULL) {
+        compare_sorties(lot, sorties, erreurs);
+        free(sorties);
+    }
+
+    return (fin.tv_sec - debut.tv_sec) + (fin.tv_nsec - debut.tv_nsec)*1e-9;
+}
+
+/*
+ * Fonction:  lot_groupe
+ * --------------------
+ * forme le groupe de blocs commençant au bloc [debut] : au plus [voies]
+ * blocs consécutifs de même table, complété si besoin en répétant
+ * le dernier bloc. renvoie le nombre de blocs réels du groupe
+ *
+ *  lot    : lot de blocs
+ *  debut  : premier bloc du groupe
+ *  voies  : taille du groupe
+ *  blocs  : reçoit les adresses des blocs du groupe
+ *  eobs   : reçoit leurs nombres de coefficients utiles
+ */
+static uint8_t lot_groupe(const lot_t* lot, size_t debut, uint8_t voies,
+                          const int16_t* blocs[IDCT_LOT_MAX], uint8_t eobs[IDCT_LOT_MAX])
+{
+    uint8_t nb = 0;
+    while (nb < voies && debut + nb < lot->nb && lot->tables[debut + nb] == lot->tables[debut]) {
+        blocs[nb] = &lot->coeffs[(debut + nb)*BLOCK_PIXELS];
+        eobs[nb]  = lot->eobs[debut + nb];
+        nb++;
+    }
+    for (uint8_t j = nb; j < voies; j++) {
+        blocs[j] = blocs[nb - 1];
+        eobs[j]  = eobs[nb - 1];
+    }
+    return nb;
+}
+
+/*
+ * Fonction:  lot_passe_lots
+ * --------------------
+ * équivalent de lot_passe pour une iDCT par lots : passe chronométrée
+ * puis comparaison des sorties signées à celles de la référence du lot.
+ * renvoie la durée de la passe chronométrée en secondes
+ *
+ *  moteur  : indice de l'iDCT par lots dans MOTEURS_LOT
+ */
+static double lot_passe_lots(lot_t* lot, size_t moteur, int32_t* tables[NB_TABLES], erreurs_t* erreurs)
+{
+    const int16_t* blocs[IDCT_LOT_MAX];
+    uint8_t eobs[IDCT_LOT_MAX];
+    uint8_t voies = MOTEURS_LOT[moteur].voies;
+    struct timespec debut, fin;
+
+    clock_gettime(CLOCK_MONOTONIC, &debut);
+    for (size_t n = 0; n < lot->nb; ) {
+        uint8_t* pixels[IDCT_LOT_MAX];
+        uint8_t nb = lot_groupe(lot, n, voies, blocs, eobs);
+        MOTEURS_LOT[moteur].lot(blocs, tables[lot->tables[n]], eobs, pixels);
+        for (uint8_t j = 0; j < voies; j++) free(pixels[j]);
+        n += nb;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+
+    /* Les sorties des blocs de complément sont écrites dans un bloc perdu */
+    int16_t* sorties = malloc(lot->nb*BLOCK_PIXELS*sizeof(int16_t));
+    int16_t  perdu[BLOCK_PIXELS];
+    for (size_t n = 0; n < lot->nb; ) {
+        int16_t* signes[IDCT_LOT_MAX];
+        uint8_t nb = lot_groupe(lot, n, voies, blocs, eobs);
+        for (uint8_t j = 0; j < voies; j++) signes[j] = (j < nb) ? &sorties[(n + j)*BLOCK_PIXELS] : perdu;
+        MOTEURS_LOT[moteur].signe(blocs, tables[lot->tables[n]], eobs, signes);
+        n += nb;
+    }
+    compare_sorties(lot, sorties, erreurs);
+    free(sorties);
+
+    return (fin.tv_sec - debut.tv_sec) + (fin.tv_nsec - debut.tv_nsec)*1e-9;
+}
+
+/*
+ * Fonction:  affiche_erreurs
+ * --------------------
+ * affiche une ligne du rapport : erreur maximale, erreur quadratique
+ * moyenne et erreur moyenne (globales et pire pixel), débit et, pour
+ * les blocs aléatoires, conformité aux seuils IEEE 1180
+ *
+ */
+static void affiche_erreurs(const char* moteur, const char* source, const lot_t* lot,
+                            const erreurs_t* erreurs, double duree, bool ieee)
+{
+    double eqm = 0.0, moy = 0.0, eqm_pixel = 0.0, moy_pixel = 0.0;
+
+    for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+        double eqm_i = (double)erreurs->carres[i]/lot->nb, moy_i = (double)erreurs->somme[i]/lot->nb;
+        eqm += eqm_i/BLOCK_PIXELS;
+        moy += moy_i/BLOCK_PIXELS;
+        if (eqm_i > eqm_pixel) eqm_pixel = eqm_i;
+        if (fabs(moy_i) > fabs(moy_pixel)) moy_pixel = moy_i;
+    }
+
+    printf("%-6s %-12s %4u %10.6f %10.6f %10.6f %10.6f %12.0f",
+           moteur, source, erreurs->pic, eqm, eqm_pixel, moy, moy_pixel, lot->nb/duree);
+    if (ieee) {
+        bool conforme = erreurs->pic <= IEEE_PIC && eqm <= IEEE_EQM && eqm_pixel <= IEEE_EQM_PIXEL
+                     && fabs(moy) <= IEEE_MOY && fabs(moy_pixel) <= IEEE_MOY_PIXEL;
+        printf("   %s", conforme ? "conforme" : "non conforme");
+    }
+    printf("\n");
+}
+
+/*
+ * Fonction:  idct_bench
+ * --------------------
+ * banc d'essai des moteurs d'iDCT sur les blocs de l'image et sur des blocs
+ * aléatoires (IEEE 1180) : affiche pour chaque moteur les erreurs par
+ * rapport à l'iDCT de référence et le débit en blocs par seconde.
+ *
+ *  jdesc : descripteur de l'image JPEG
+ *  image : image compressée dont les blocs servent de lot de test
+ */
+void idct_bench(const struct jpeg_desc* jdesc, const image16_t* image)
+{
+    /* Lots : blocs de l'image, puis blocs aléatoires par plage et par signe */
+    lot_t lots[1 + 2*NB_PLAGES];
+    char  sources[1 + 2*NB_PLAGES][16];
+    uint32_t graine = 1;
+
+    lot_image(&lots[0], image);
+    snprintf(sources[0], sizeof(sources[0]), "image");
+    for (size_t p = 0; p < NB_PLAGES; p++)
+    for (uint8_t s = 0; s < 2; s++) {
+        size_t l = 1 + 2*p + s;
+        lot_aleatoire(&lots[l], p, s ? -1 : 1, &graine);
+        snprintf(sources[l], sizeof(sources[l]), "[-%d,%d]%c", PLAGES[p][0], PLAGES[p][1], s ? '-' : '+');
+    }
+    size_t nb_lots = 1 + 2*NB_PLAGES;
+
+    /* Tables brutes (ordre zig-zag) : luminance, chrominance, unité */
+    uint8_t unite[BLOCK_PIXELS];
+    memset(unite, 1, BLOCK_PIXELS);
+    const uint8_t* brutes[NB_TABLES] = {get_quantization_table(jdesc, 0),
+                                        image->color ? get_quantization_table(jdesc, 1) : unite,
+                                        unite};
+
+    printf("Banc d'essai des iDCT : %zu blocs de l'image, %zu blocs aléatoires (niveau %s)\n",
+           lots[0].nb, 2*NB_PLAGES*NB_ALEATOIRES, cpu_tier_name(KERNELS.tier));
+    printf("Erreurs mesurées avant recentrage et saturation, sorties bornées à [%d, %d]\n",
+           IDCT_SIGNE_MIN, IDCT_SIGNE_MAX);
+    printf("%-6s %-12s %4s %10s %10s %10s %10s %12s\n",
+           "moteur", "blocs", "pic", "eqm", "eqm pixel", "moy", "moy pixel", "blocs/s");
+
+    for (enum idct_engine moteur = 0; moteur < IDCT_NB_ENGINES; moteur++) {
+        const struct idct_engine_desc* desc = &IDCT_ENGINES[moteur];
+        if (desc->niveau > KERNELS.tier) {
+            printf("%-6s indisponible au niveau %s\n", desc->nom, cpu_tier_name(KERNELS.tier));
+            continue;
+        }
+
+        int32_t* tables[NB_TABLES];
+        for (uint8_t t = 0; t < NB_TABLES; t++) {
+            tables[t] = prescale_quantization_table(brutes[t], desc->echelle);
+        }
+
+        for (size_t l = 0; l < nb_lots; l++) {
+            erreurs_t erreurs;
+            memset(&erreurs, 0, sizeof(erreurs_t));
+            /* La référence passe en premier et fournit les sorties attendues */
+            double duree = lot_passe(&lots[l], desc, tables, (moteur == IDCT_REF) ? NULL : &erreurs);
+            affiche_erreurs(desc->nom, sources[l], &lots[l], &erreurs, duree, l > 0);
+        }
+
+        for (uint8_t t = 0; t < NB_TABLES; t++) free(tables[t]);
+    }
+
+    for (size_t moteur = 0; moteur < NB_MOTEURS_LOT; moteur++) {
+        if (MOTEURS_LOT[moteur].niveau > KERNELS.tier) {
+            printf("%-6s indisponible au niveau %s\n", MOTEURS_LOT[moteur].nom, cpu_tier_name(KERNELS.tier));
+            continue;
+        }
+
+        int32_t* tables[NB_TABLES];
+        for (uint8_t t = 0; t < NB_TABLES; t++) {
+            tables[t] = prescale_quantization_table(brutes[t], IDCT_PRESCALE_FLOAT);
+        }
+
+        for (size_t l = 0; l < nb_lots; l++) {
+            erreurs_t erreurs;
+            memset(&erreurs, 0, sizeof(erreurs_t));
+            double duree = lot_passe_lots(&lots[l], moteur, tables, &erreurs);
+            affiche_erreurs(MOTEURS_LOT[moteur].nom, sources[l], &lots[l], &erreurs, duree, l > 0);
+        }
+
+        for (uint8_t t = 0; t < NB_TABLES; t++) free(tables[t]);
+    }
+
+    for (size_t l = 0; l < nb_lots; l++) lot_libere(&lots[l]);
+}
@@ -0,0 +1,120 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "idct_cache.h"
+#include "jpeg_const.h"
+
+/*
+    Cache des sorties d'iDCT : les images synthétiques (captures d'écran,
+    documents, motifs répétés) contiennent beaucoup de blocs identiques après
+    quantification. Un bloc est repéré par un hachage de ses coefficients
+    quantifiés et de sa table de quantification (ce qui détermine ses
+    coefficients déquantifiés) ; l'entrée correspondante est comparée en
+    entier, une collision ne peut donc pas rendre un mauvais bloc.
+*/
+
+
+/*
+ * Fonction:  idct_cache_hash
+ * --------------------
+ * renvoie l'indice de l'entrée du cache associée à un bloc
+ *
+ *  bloc   : coefficients quantifiés du bloc, ordre naturel
+ *  qtable : table de quantification du bloc
+ */
+static size_t idct_cache_hash(const int16_t* bloc, const int32_t* qtable)
+{
+    uint64_t hash = (uint64_t)(uintptr_t)qtable, mot;
+
+    /* Mélange multiplicatif par mots de 4 coefficients */
+    for (uint8_t i = 0; i < BLOCK_PIXELS; i += 4) {
+        memcpy(&mot, &bloc[i], sizeof(uint64_t));
+        hash = (hash ^ mot)*UINT64_C(0x9e3779b97f4a7c15);
+        hash ^= hash >> 32;
+    }
+
+    return hash & (IDCT_CACHE_ENTREES-1);
+}
+
+/*
+ * Fonction:  create_idct_cache
+ * --------------------
+ * alloue un cache d'iDCT vide
+ *
+ */
+idct_cache_t* create_idct_cache(void)
+{
+    idct_cache_t* cache = malloc(sizeof(idct_cache_t));
+
+    cache->entrees  = calloc(IDCT_CACHE_ENTREES, sizeof(idct_cache_entry_t));
+    cache->courante = NULL;
+    cache->acces    = 0;
+    cache->succes   = 0;
+
+    return cache;
+}
+
+/*
+ * Fonction:  free_idct_cache
+ * --------------------
+ * libère un cache d'iDCT
+ *
+ */
+void free_idct_cache(idct_cache_t* cache)
+{
+    if (cache == NULL) return;
+
+    free(cache->entrees);
+    free(cache);
+}
+
+/*
+ * Fonction:  idct_cache_get
+ * --------------------
+ * cherche un bloc dans le cache : renvoie une copie (allouée) des pixels
+ * déjà calculés pour ce bloc, ou NULL s'il est absent. Dans ce cas,
+ * idct_cache_put range la sortie calculée à sa place.
+ *
+ *  cache     : cache d'iDCT
+ *  bloc      : coefficients quantifiés du bloc, ordre naturel
+ *  qtable    : table de quantification du bloc
+ *  nb_pixels : taille du bloc de sortie
+ */
+uint8_t* idct_cache_get(idct_cache_t* cache, const int16_t* bloc, const int32_t* qtable, size_t nb_pixels)
+{
+    idct_cache_entry_t* entree = &cache->entrees[idct_cache_hash(bloc, qtable)];
+    cache->courante = entree;
+    cache->acces++;
+
+    if (entree->qtable != qtable || memcmp(entree->coeffs, bloc, sizeof(int16_t)*BLOCK_PIXELS) != 0)
+        return NULL;
+
+    cache->succes++;
+    uint8_t* pixels = malloc(nb_pixels*sizeof(uint8_t));
+    memcpy(pixels, entree->pixels, nb_pixels*sizeof(uint8_t));
+
+    return pixels;
+}
+
+/*
+ * Fonction:  idct_cache_put
+ * --------------------
+ * range la sortie de l'iDCT du dernier bloc cherché (idct_cache_get),
+ * à la place de l'entrée précédente de même hachage
+ *
+ *  cache     : cache d'iDCT
+ *  bloc      : coefficients quantifiés du bloc, ordre naturel
+ *  qtable    : table de quantification du bloc
+ *  pixels    : sortie de l'iDCT du bloc
+ *  nb_pixels : taille du bloc de sortie
+ */
+void idct_cache_put(idct_cache_t* cache, const int16_t* bloc, const int32_t* qtable, const uint8_t* pixels, size_t nb_pixels)
+{
+    idct_cache_entry_t* entree = cache->courante;
+
+    entree->qtable = qtable;
+    memcpy(entree->coeffs, bloc, sizeof(int16_t)*BLOCK_PIXELS);
+    memcpy(entree->pixels, pixels, nb_pixels*sizeof(uint8_t));
+}
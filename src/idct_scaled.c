@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+
+#include "jpeg_const.h"
+#include "iqzz.h"
+
+/*
+    iDCT réduites pour le décodage à l'échelle 1/2, 1/4 ou 1/8 (option -scale=) :
+    les N x N coefficients basse fréquence d'un bloc (N = 4, 2 ou 1) sont passés
+    dans une iDCT à N points, ce qui donne directement le bloc de N x N pixels
+    sous-échantillonné. Avec la normalisation JPEG :
+        f(x,y) = 1/4 * somme C(u)C(v) F(u,v) cos((2x+1)u*pi/2N) cos((2y+1)v*pi/2N)
+*/
+
+/* Coefficients C(u)/2 * cos(k*pi/8) */
+#define A_C 0.353553390593273762f
+#define B_C 0.461939766255643378f
+#define D_C 0.191341716182544886f
+
+// tab_4[x][u] = C(u)/2 * cos((2x+1)u*pi/8)
+static const float tab_4[4][4] = {{A_C,  B_C,  A_C,  D_C},
+                                  {A_C,  D_C, -A_C, -B_C},
+                                  {A_C, -D_C, -A_C,  B_C},
+                                  {A_C, -B_C,  A_C, -D_C}};
+
+// tab_2[x][u] = C(u)/2 * cos((2x+1)u*pi/4)
+static const float tab_2[2][2] = {{A_C,  A_C},
+                                  {A_C, -A_C}};
+
+
+/*
+* Fonction:  idct_scaled_saturation
+* --------------------
+* recentre, sature entre 0 et 255 et arrondit une sortie de l'iDCT
+*
+*  valeur : échantillon signé issu de l'iDCT
+*
+*/
+static uint8_t idct_scaled_saturation(float valeur)
+{
+	valeur += 128.0f;
+	if (valeur < 0.0f) {
+		valeur = 0.0f;
+	} else if (valeur > 255.0f) {
+		valeur = 255.0f;
+	}
+
+	return (uint8_t) roundf(valeur);
+}
+
+/*
+* Fonction:  idct_scaled
+* --------------------
+* iDCT réduite d'un bloc 8x8 vers un bloc de taille x taille pixels,
+* quantification inverse comprise
+*
+*     bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*   qtable : table de quantification prémultipliée en ordre naturel
+*   taille : côté du bloc de sortie (4, 2 ou 1)
+*  dc_seul : vrai si seul le coefficient DC du bloc est non nul
+*
+* renvoie le bloc de taille*taille pixels (alloué)
+*/
+uint8_t *idct_scaled(const int16_t *bloc, const int32_t *qtable, uint8_t taille, bool dc_seul)
+{
+	float coeffs[16], inter[16];
+	uint8_t *nvx_bloc = malloc(taille*taille*sizeof(uint8_t));
+
+	/* Bloc DC seul (et échelle 1/8) : bloc constant de valeur DC/8 */
+	if (dc_seul || taille == 1) {
+		iqzz_reduit(coeffs, bloc, qtable, 1);
+		memset(nvx_bloc, idct_scaled_saturation(coeffs[0]/8), taille*taille);
+		return nvx_bloc;
+	}
+
+	const float *tab = (taille == 4) ? &tab_4[0][0] : &tab_2[0][0];
+	iqzz_reduit(coeffs, bloc, qtable, taille);
+
+	// on passe sur les lignes : inter[v][x] = somme_u tab[x][u] F(u,v)
+	for (uint8_t v = 0; v < taille; v++)
+	for (uint8_t x = 0; x < taille; x++) {
+		float somme = 0.0f;
+		for (uint8_t u = 0; u < taille; u++) {
+			somme += tab[taille*x + u]*coeffs[taille*v + u];
+		}
+		inter[taille*v + x] = somme;
+	}
+
+	// on passe sur les colonnes : f(x,y) = somme_v tab[y][v] inter[v][x]
+	for (uint8_t y = 0; y < taille; y++)
+	for (uint8_t x = 0; x < taille; x++) {
+		float somme = 0.0f;
+		for (uint8_t v = 0; v < taille; v++) {
+			somme += tab[taille*y + v]*inter[taille*v + x];
+		}
+		nvx_bloc[taille*y + x] = idct_scaled_saturation(somme);
+	}
+
+	return nvx_bloc;
+}
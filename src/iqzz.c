@@ -5,6 +5,8 @@
 
 #include "jpeg_reader.h"
 #include "jpeg_const.h"
+#include "iqzz.h"
+#include "idct.h"
 
 /* Tableau de correspondances entre indices dans un bloc en zig-zag et un bloc classique */
 const uint8_t EQUIV_ZZ[64] =  {0,  1,  8, 16,  9,  2,  3, 10, 
@@ -24,47 +26,192 @@ const uint8_t EQUIV_ZZ[64] =  {0,  1,  8, 16,  9,  2,  3, 10,
  * en sa valeur entière réelle
  * 
  *  jdesc : descripteur JPEG du fichier ouvert
- *  bloc  : bloc 8x8 lu
+ *  bloc  : bloc 8x8 lu (ordre naturel)
  *  index : index de la table de quantization
  *          | 0 : Y - Luminance
  *          | 1 : Cr\Cb - Chrominance
+ *  eob   : nombre de coefficients zig-zag à traiter,
+ *          les suivants sont nuls
  *
  */
-void quantification_inverse(const struct jpeg_desc* jdesc, int16_t* bloc, int index)
+void quantification_inverse(const struct jpeg_desc* jdesc, int16_t* bloc, int index, uint8_t eob)
 {
     /* Multiplication de 16bits * 8bits => 24 bits au maximum */
     int32_t res;
     uint8_t* qtable = get_quantization_table(jdesc, index);
 
-    for (size_t i = 0; i < BLOCK_PIXELS; i++) {
-        res = bloc[i]*qtable[i];
+    for (size_t i = 0; i < eob; i++) {
+        uint8_t nat = EQUIV_ZZ[i];
+        res = bloc[nat]*qtable[i];
 
         /* Saturation sur 16 bits */
         if (res > SHRT_MAX)
-            bloc[i] = SHRT_MAX;
+            bloc[nat] = SHRT_MAX;
         else if (res < SHRT_MIN)
-            bloc[i] = SHRT_MIN;
+            bloc[nat] = SHRT_MIN;
         else
-            bloc[i] = (int16_t)res;
+            bloc[nat] = (int16_t)res;
+    }
+}
+
+
+/*
+ * Fonction:  quantization_prescale
+ * --------------------
+ * renvoie le facteur d'échelle des tables prémultipliées pour l'iDCT
+ * sélectionnée (option -idct=)
+ *
+ */
+int32_t quantization_prescale(void)
+{
+    return IDCT_ENGINES[P_IDCT].echelle;
+}
+
+/*
+ * Fonction:  prescale_quantization_table
+ * --------------------
+ * renvoie une table de quantification en ordre naturel, prémultipliée
+ * par le facteur d'échelle attendu en entrée par une iDCT (quantization_prescale
+ * pour l'iDCT sélectionnée) : les moteurs flottants renvoient 8 fois moins
+ * que l'iDCT 2D, ce facteur (puissance de 2, donc exact) est appliqué ici
+ * plutôt qu'en sortie.
+ * 
+ *  qtable  : table de quantification lue dans le fichier (ordre zig-zag)
+ *  echelle : facteur d'échelle attendu par l'iDCT
+ *
+ */
+int32_t* prescale_quantization_table(const uint8_t* qtable, int32_t echelle)
+{
+    int32_t* table = malloc(sizeof(int32_t)*BLOCK_PIXELS);
+
+    for (size_t i = 0; i < BLOCK_PIXELS; i++) {
+        table[EQUIV_ZZ[i]] = qtable[i]*echelle;
+    }
+    return table;
+}
+
+/*
+ * Fonction:  sature_iquant
+ * --------------------
+ * sature un coefficient déquantifié sur 16 bits, à l'échelle de la table
+ * 
+ *  res     : produit coefficient * table prémultipliée
+ *  echelle : facteur d'échelle de la table
+ *
+ */
+static inline int32_t sature_iquant(int32_t res, int32_t echelle)
+{
+    if (res > SHRT_MAX*echelle)
+        return SHRT_MAX*echelle;
+    if (res < SHRT_MIN*echelle)
+        return SHRT_MIN*echelle;
+    return res;
+}
+
+/*
+ * Fonction:  iqzz_dc
+ * --------------------
+ * renvoie le coefficient DC déquantifié (et saturé) d'un bloc
+ * 
+ *  bloc    : bloc 16 bits lu
+ *  qtable  : table prémultipliée en ordre naturel (prescale_quantization_table)
+ *  echelle : facteur d'échelle de la table
+ *
+ */
+int32_t iqzz_dc(const int16_t* bloc, const int32_t* qtable, int32_t echelle)
+{
+    return sature_iquant(bloc[0]*qtable[0], echelle);
+}
+
+/*
+ * Fonction:  iqzz_float
+ * --------------------
+ * quantification inverse au chargement : les coefficients sont multipliés,
+ * saturés (comme quantification_inverse, à l'échelle près) et rangés
+ * dans le bloc de travail de l'iDCT.
+ * 
+ *  dest   : bloc de travail flottant de l'iDCT (64 valeurs)
+ *  bloc   : bloc 16 bits lu (ordre naturel), non modifié
+ *  qtable : table prémultipliée en ordre naturel (prescale_quantization_table)
+ *  eob    : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+ *
+ */
+void iqzz_float(float* dest, const int16_t* bloc, const int32_t* qtable, uint8_t eob)
+{
+    if (eob < BLOCK_PIXELS)
+        memset(dest, 0, BLOCK_PIXELS*sizeof(float));
+
+    for (uint8_t i = 0; i < eob; i++) {
+        uint8_t nat = EQUIV_ZZ[i];
+        dest[nat] = (float)sature_iquant(bloc[nat]*qtable[nat], IDCT_PRESCALE_FLOAT);
     }
 }
 
+/*
+ * Fonction:  iqzz_float_voie
+ * --------------------
+ * équivalent de iqzz_float pour l'iDCT par lots, où les blocs sont
+ * entrelacés (une voie SIMD par bloc) : le coefficient k du bloc est rangé
+ * en dest[k*voies]. Le bloc de travail doit avoir été mis à zéro.
+ * 
+ *  dest   : voie du bloc dans le bloc de travail entrelacé
+ *  voies  : nombre de blocs entrelacés
+ *  bloc   : bloc 16 bits lu (ordre naturel), non modifié
+ *  qtable : table prémultipliée en ordre naturel (prescale_quantization_table)
+ *  eob    : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+ *
+ */
+void iqzz_float_voie(float* dest, uint8_t voies, const int16_t* bloc, const int32_t* qtable, uint8_t eob)
+{
+    for (uint8_t i = 0; i < eob; i++) {
+        uint8_t nat = EQUIV_ZZ[i];
+        dest[nat*voies] = (float)sature_iquant(bloc[nat]*qtable[nat], IDCT_PRESCALE_FLOAT);
+    }
+}
+
+/*
+ * Fonction:  iqzz_int
+ * --------------------
+ * équivalent de iqzz_float pour le moteur en virgule fixe (table non mise
+ * à l'échelle, bloc de travail sur 32 bits)
+ * 
+ *  dest   : bloc de travail entier de l'iDCT (64 valeurs)
+ *  bloc   : bloc 16 bits lu (ordre naturel), non modifié
+ *  qtable : table en ordre naturel (prescale_quantization_table)
+ *  eob    : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+ *
+ */
+void iqzz_int(int32_t* dest, const int16_t* bloc, const int32_t* qtable, uint8_t eob)
+{
+    if (eob < BLOCK_PIXELS)
+        memset(dest, 0, BLOCK_PIXELS*sizeof(int32_t));
+
+    for (uint8_t i = 0; i < eob; i++) {
+        uint8_t nat = EQUIV_ZZ[i];
+        dest[nat] = sature_iquant(bloc[nat]*qtable[nat], 1);
+    }
+}
 
 /*
- * Fonction: zig_zag  
+ * Fonction:  iqzz_reduit
  * --------------------
- * renvoie le tableau 1D passé en paramètre dans l'ordre zig-zag
+ * quantification inverse des seuls coefficients du carré [taille]x[taille]
+ * en haut à gauche du bloc (iDCT réduite), rangés ligne par ligne dans
+ * [dest] et ramenés à l'échelle 1.
  * 
- *  tab  : tableau à réorganiser en zig_zag
- *         | Le tableau tab est libéré à la fin de la fonction
+ *  dest   : coefficients déquantifiés (taille*taille valeurs)
+ *  bloc   : bloc 16 bits lu (ordre naturel), non modifié
+ *  qtable : table prémultipliée en ordre naturel (prescale_quantization_table)
+ *  taille : côté du carré de coefficients à garder (1, 2 ou 4)
+ *
  */
-int16_t *zig_zag(int16_t *nvx_tab, int16_t *tab)
+void iqzz_reduit(float* dest, const int16_t* bloc, const int32_t* qtable, uint8_t taille)
 {
-    /* On place les coefficients à la bonne position dans un tableau annexe */
-    for (uint8_t i = 0; i < 64; i++){
-        nvx_tab[EQUIV_ZZ[i]] = tab[i];
+    int32_t echelle = quantization_prescale();
+
+    for (uint8_t v = 0; v < taille; v++)
+    for (uint8_t u = 0; u < taille; u++) {
+        uint8_t nat = BLOCK_SIZE*v + u;
+        dest[taille*v + u] = (float)sature_iquant(bloc[nat]*qtable[nat], echelle)/echelle;
     }
-    /* On recopie le tableau annexe dans le bon tableau */
-    memcpy(tab, nvx_tab, BLOCK_PIXELS*sizeof(int16_t));
-    return tab;
 }
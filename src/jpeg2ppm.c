@@ -8,21 +8,46 @@
 #include "bitstream.h"
 #include "extract_image.h"
 #include "export_ppm.h"
+#include "export_format.h"
+#include "cpu_dispatch.h"
+#include "idct.h"
 
 
 /* Paramètres d'appel */
-bool P_VERBOSE, P_BLABLA, P_PROG_STEP, P_MULTITHREAD;
-const char *OPT_VERBOSE, *OPT_BLABLA, *OPT_PROG_STEP, *OPT_MULTITHREAD;
+bool P_VERBOSE, P_BLABLA, P_PROG_STEP, P_MULTITHREAD, P_COMPACT, P_BENCH, P_CACHE, P_LUMA, P_STATS, P_NPY;
+const char *OPT_VERBOSE, *OPT_BLABLA, *OPT_PROG_STEP, *OPT_MULTITHREAD, *OPT_COMPACT, *OPT_BENCH, *OPT_CACHE, *OPT_LUMA, *OPT_STATS, *OPT_NPY;
+enum idct_engine P_IDCT;
+uint8_t P_SCALE, P_ORIENTATION;
+enum cpu_tier P_CPU;
+enum pixel_format P_FORMAT;
+enum tensor_dtype P_DTYPE;
+float P_MEAN[3], P_STD[3];
+const char *OPT_IDCT, *OPT_SCALE, *OPT_ORIENT, *OPT_CPU, *OPT_FORMAT, *OPT_DTYPE, *OPT_MEAN, *OPT_STD;
 const char *USAGE;
 
 static char* create_outputname(const char* jpeg_name);
 static void  check_opt(const char* opt_arg);
+static void  read_channels(const char* valeur, float canaux[3]);
 
 int main(int argc, char **argv)
 {
-    OPT_VERBOSE = "-v", OPT_BLABLA = "-b", OPT_PROG_STEP = "-p", OPT_MULTITHREAD = "-m";
-    USAGE = "Usage: %s fichier.jpeg [FICHIER] ... [-v|-b|-p|-m] \n";
-    P_VERBOSE = false; P_BLABLA = false; P_PROG_STEP = false; P_MULTITHREAD = false;
+    OPT_VERBOSE = "-v", OPT_BLABLA = "-b", OPT_PROG_STEP = "-p", OPT_MULTITHREAD = "-m", OPT_COMPACT = "-c", OPT_BENCH = "-bench", OPT_CACHE = "-cache", OPT_LUMA = "-luma", OPT_STATS = "-stats", OPT_NPY = "-npy";
+    OPT_IDCT = "-idct=", OPT_SCALE = "-scale=", OPT_ORIENT = "-orient=", OPT_CPU = "-cpu=", OPT_FORMAT = "-format=";
+    OPT_DTYPE = "-dtype=", OPT_MEAN = "-mean=", OPT_STD = "-std=";
+    USAGE = "Usage: %s fichier.jpeg [FICHIER] ... [-v|-b|-p|-m|-c|-bench|-cache|-luma|-stats|-idct=ref|float|int|sse2|avx2|-scale=1|1/2|1/4|1/8|-orient=1..8|-cpu=auto|scalar|sse2|sse4|avx2|avx512|-format=rgb|rgbx|bgra|i420|nv12|yuv444|nchw|nhwc|-dtype=float32|uint8|-mean=R,G,B|-std=R,G,B|-npy] ...\n";
+    P_VERBOSE = false; P_BLABLA = false; P_PROG_STEP = false; P_MULTITHREAD = false; P_COMPACT = false; P_BENCH = false; P_CACHE = false; P_LUMA = false; P_STATS = false; P_NPY = false;
+    P_IDCT = IDCT_FLOAT;
+    P_SCALE = 1;
+    P_ORIENTATION = 1;
+    P_FORMAT = FMT_RGB;
+    P_DTYPE = DTYPE_FLOAT32;
+    for (size_t c = 0; c < 3; c++) {
+        P_MEAN[c] = 0.0f; P_STD[c] = 1.0f;
+    }
+
+    /* Niveau de jeu d'instructions imposé par l'environnement (l'option -cpu= est prioritaire) */
+    const char *env_cpu = getenv("JPEG2PPM_CPU");
+    P_CPU = (env_cpu != NULL) ? cpu_tier_from_name(env_cpu) : CPU_AUTO;
 
     if (argc < 2) {
         fprintf(stderr, USAGE, argv[0]);
@@ -30,28 +55,41 @@ int main(int argc, char **argv)
     }
 
     /* On recupere le nom du fichier JPEG sur la ligne de commande. */
-    const char *filename = argv[1]; char *outputname = argv[2];
-
-    bool str_alloc = false;
-    switch (argc)
-    {
-        case 4:
-            check_opt(argv[3]);
-            break;
-        case 3:
-            /* Si le deuxième arg n'est pas un nom de fichier valide -> paramètres ?*/
-            if (strlen(argv[2])<5 || strchr(argv[2], '.')==NULL) {
-                check_opt(argv[2]);
-                outputname = create_outputname(filename); str_alloc = true;
-            }
-            break;
-        case 2:
-            /* Par défaut :génère un fichier ppm du même nom */
-            outputname = create_outputname(filename); str_alloc = true;
-            break;
-        default:
+    const char *filename = argv[1]; char *outputname = NULL;
+
+    /* Arguments suivants : fichier de sortie (optionnel) puis options, dans un ordre quelconque */
+    for (int i=2; i<argc; i++) {
+        if (argv[i][0] == '-') {
+            check_opt(argv[i]);
+        } else if (outputname == NULL) {
+            outputname = argv[i];
+        } else {
             fprintf(stderr, USAGE, argv[0]);
             return EXIT_FAILURE;
+        }
+    }
+
+    /* Options propres aux sorties tenseur */
+    bool tenseur = (P_FORMAT == FMT_NCHW || P_FORMAT == FMT_NHWC);
+    if (P_NPY && !tenseur) {
+        EXIT_ERROR("jpeg2ppm", "L'option %s est réservée aux formats nchw et nhwc", OPT_NPY);
+    }
+    for (size_t c = 0; c < 3; c++) {
+        if (P_STD[c] == 0.0f) {
+            EXIT_ERROR("jpeg2ppm", "Ecart-type de normalisation nul");
+        }
+        if (P_DTYPE == DTYPE_UINT8 && (P_MEAN[c] != 0.0f || P_STD[c] != 1.0f)) {
+            EXIT_ERROR("jpeg2ppm", "La normalisation (%s, %s) demande -dtype=float32", OPT_MEAN, OPT_STD);
+        }
+    }
+
+    /* Liaison des noyaux de calcul au niveau de jeu d'instructions retenu */
+    cpu_dispatch_init(P_CPU);
+
+    /* Par défaut : génère un fichier du même nom (ppm, ou extension du format de sortie) */
+    bool str_alloc = false;
+    if (outputname == NULL) {
+        outputname = create_outputname(filename); str_alloc = true;
     }
 
     /* On cree un jpeg_desc qui permettra de lire ce fichier. */
@@ -61,9 +99,12 @@ int main(int argc, char **argv)
     /* On extrait l'image JPEG du bitstream ouvert */
     jpeg_image = extract_image(jdesc);
 
-    /* Exportation du fichier en PGM\PPM */
+    /* Exportation du fichier en PGM\PPM, statistiques des pixels comptées au passage */
+    image_stats_t stats;
+    if (P_STATS) jpeg_image->stats = &stats;
     export_img(jpeg_image, jdesc, outputname);
     printf("Fichier décompressé créé : %s > %s\n", filename, outputname);
+    if (P_STATS) print_stats(&stats, P_FORMAT);
 
     /* Libération des ressources */
     free_image(jpeg_image);
@@ -94,7 +135,8 @@ static char* create_outputname(const char* jpeg_name)
     char* outputname = malloc(sizeof(char)*100);
     strncpy(outputname, jpeg_name, index + 1);
     outputname[index] = '\0';
-    outputname = strcat(outputname, ".ppm");
+    outputname = strcat(outputname, ".");
+    outputname = strcat(outputname, format_extension(P_FORMAT));
 
     return outputname;
 }
@@ -113,6 +155,80 @@ static void check_opt(const char* opt_arg)
     // Mode calcul parallèle activé
     else if (!strcmp(OPT_MULTITHREAD, opt_arg))
         P_MULTITHREAD = true;
+    // Stockage compact des coefficients (mode progressif)
+    else if (!strcmp(OPT_COMPACT, opt_arg))
+        P_COMPACT = true;
+    // Banc d'essai des moteurs d'iDCT sur les blocs de l'image
+    else if (!strcmp(OPT_BENCH, opt_arg))
+        P_BENCH = true;
+    // Cache des sorties d'iDCT pour les blocs répétés
+    else if (!strcmp(OPT_CACHE, opt_arg))
+        P_CACHE = true;
+    // Choix du moteur d'iDCT : Loeffler flottant (défaut), référence, virgule fixe, SIMD
+    else if (!strncmp(OPT_IDCT, opt_arg, strlen(OPT_IDCT)))
+        P_IDCT = idct_engine_from_name(opt_arg + strlen(OPT_IDCT));
+    // Décodage réduit : iDCT sur 4x4, 2x2 ou 1x1 coefficients
+    else if (!strncmp(OPT_SCALE, opt_arg, strlen(OPT_SCALE))) {
+        const char* valeur = opt_arg + strlen(OPT_SCALE);
+        if (!strcmp(valeur, "1"))
+            P_SCALE = 1;
+        else if (!strcmp(valeur, "1/2"))
+            P_SCALE = 2;
+        else if (!strcmp(valeur, "1/4"))
+            P_SCALE = 4;
+        else if (!strcmp(valeur, "1/8"))
+            P_SCALE = 8;
+        else
+            EXIT_ERROR("jpeg2ppm", "Échelle de décodage non supportée : %s", valeur);
+    }
+    // Orientation de la sortie (numérotation EXIF), appliquée pendant l'écriture
+    else if (!strncmp(OPT_ORIENT, opt_arg, strlen(OPT_ORIENT))) {
+        const char* valeur = opt_arg + strlen(OPT_ORIENT);
+        if (valeur[0] < '1' || valeur[0] > '8' || valeur[1] != '\0')
+            EXIT_ERROR("jpeg2ppm", "Orientation non supportée : %s (valeurs EXIF de 1 à 8)", valeur);
+        P_ORIENTATION = valeur[0] - '0';
+    }
+    // Niveau de jeu d'instructions des noyaux : détecté (défaut) ou imposé
+    else if (!strncmp(OPT_CPU, opt_arg, strlen(OPT_CPU)))
+        P_CPU = cpu_tier_from_name(opt_arg + strlen(OPT_CPU));
+    // Décodage de la luminance seule (sortie en niveaux de gris)
+    else if (!strcmp(OPT_LUMA, opt_arg))
+        P_LUMA = true;
+    // Statistiques des pixels (histogrammes, moyennes, extrêmes) calculées à l'export
+    else if (!strcmp(OPT_STATS, opt_arg))
+        P_STATS = true;
+    // Format des pixels de sortie : PPM/PGM (défaut), RGBX/BGRA ou YUV planaire brut
+    else if (!strncmp(OPT_FORMAT, opt_arg, strlen(OPT_FORMAT)))
+        P_FORMAT = format_from_name(opt_arg + strlen(OPT_FORMAT));
+    // Sorties tenseur : type des éléments, normalisation par canal, conteneur .npy
+    else if (!strncmp(OPT_DTYPE, opt_arg, strlen(OPT_DTYPE))) {
+        const char* valeur = opt_arg + strlen(OPT_DTYPE);
+        if (!strcmp(valeur, "float32"))
+            P_DTYPE = DTYPE_FLOAT32;
+        else if (!strcmp(valeur, "uint8"))
+            P_DTYPE = DTYPE_UINT8;
+        else
+            EXIT_ERROR("jpeg2ppm", "Type de tenseur non supporté : %s", valeur);
+    }
+    else if (!strncmp(OPT_MEAN, opt_arg, strlen(OPT_MEAN)))
+        read_channels(opt_arg + strlen(OPT_MEAN), P_MEAN);
+    else if (!strncmp(OPT_STD, opt_arg, strlen(OPT_STD)))
+        read_channels(opt_arg + strlen(OPT_STD), P_STD);
+    else if (!strcmp(OPT_NPY, opt_arg))
+        P_NPY = true;
     else
         EXIT_ERROR("jpeg2ppm", "Option inconnue : %s", opt_arg);    
 }
+
+static void read_channels(const char* valeur, float canaux[3])
+{
+    /* Une valeur par canal (R,G,B), ou une seule valeur pour les trois */
+    char fin;
+    if (sscanf(valeur, "%f,%f,%f%c", &canaux[0], &canaux[1], &canaux[2], &fin) == 3)
+        return;
+    if (sscanf(valeur, "%f%c", &canaux[0], &fin) == 1) {
+        canaux[1] = canaux[2] = canaux[0];
+        return;
+    }
+    EXIT_ERROR("jpeg2ppm", "Valeurs par canal invalides : %s", valeur);
+}
@@ -7,6 +7,7 @@
 #include "bitstream.h"
 #include "jpeg_const.h"
 #include "jpeg_reader.h"
+#include "iqzz.h"
 
 
 /*
@@ -88,10 +89,13 @@ static void parse_dqt(struct jpeg_desc *desc)
     if (desc->ntables_qt_8 == 0) {
         desc->ntables_qt_8 = nb_tables;
         desc->quantization_tables_8 = malloc(sizeof(uint8_t*)*nb_tables);
+        desc->quantization_tables_idct = malloc(sizeof(int32_t*)*nb_tables);
 
         // Initialisation de tous les champs à NULL
-        for (size_t i=0; i<nb_tables; i++)
+        for (size_t i=0; i<nb_tables; i++) {
             desc->quantization_tables_8[i] = NULL;
+            desc->quantization_tables_idct[i] = NULL;
+        }
     } else {
         /* On fait une réallocation du tableau
            => Conserve les anciens pointeurs vers les tables antérieures
@@ -102,12 +106,16 @@ static void parse_dqt(struct jpeg_desc *desc)
 
         // Réallocation de l'espace
         uint8_t** new_tables = realloc(desc->quantization_tables_8, sizeof(uint8_t*)*new_size);
-        if (new_tables != NULL) {
+        int32_t** new_tables_idct = realloc(desc->quantization_tables_idct, sizeof(int32_t*)*new_size);
+        if (new_tables != NULL && new_tables_idct != NULL) {
             desc->quantization_tables_8 = new_tables;
+            desc->quantization_tables_idct = new_tables_idct;
 
             // Initialisation des champs ajoutés à NULL
-            for (size_t i=desc->ntables_qt_8; i<new_size; i++)
+            for (size_t i=desc->ntables_qt_8; i<new_size; i++) {
                 desc->quantization_tables_8[i] = NULL;
+                desc->quantization_tables_idct[i] = NULL;
+            }
             desc->ntables_qt_8 = new_size;
         } else {
             EXIT_ERROR("jpeg_reader", "DQT : Impossible de réallouer quant_tables_8");
@@ -138,6 +146,10 @@ static void parse_dqt(struct jpeg_desc *desc)
             INFO_MSG( "%hhx ", desc->quantization_tables_8[indice][j]);
         }
         INFO_MSG( "\n");
+
+        // Table en ordre naturel prémultipliée pour l'iDCT (quantification inverse fusionnée)
+        free(desc->quantization_tables_idct[indice]);
+        desc->quantization_tables_idct[indice] = prescale_quantization_table(desc->quantization_tables_8[indice], quantization_prescale());
     }
 }
 
@@ -197,6 +209,25 @@ static void parse_sof(struct jpeg_desc *desc)
     }
 }
 
+/*
+ * Fonction:  retire_huffman_table
+ * --------------------
+ * met de côté une table de Huffman redéfinie par une section
+ * DHT : elle n'est libérée qu'à la fermeture du descripteur,
+ * les copies du descripteur faites pour les scans précédents
+ * pouvant encore l'utiliser.
+ *
+ *  desc  : descripteur JPEG du fichier ouvert
+ *  table : table remplacée
+ *
+ */
+static void retire_huffman_table(struct jpeg_desc *desc, struct huff_table *table)
+{
+    desc->tables_remplacees = realloc(desc->tables_remplacees,
+                                      (desc->ntables_remplacees + 1)*sizeof(struct huff_table*));
+    desc->tables_remplacees[desc->ntables_remplacees++] = table;
+}
+
 /*
  * Fonction:  parse_dht
  * --------------------
@@ -233,13 +264,13 @@ static void parse_dht(struct jpeg_desc *desc)
             if (desc->tables_DC[indice] == NULL)
                 desc->ntables_DC++;
             else
-                free_huffman_table(desc->tables_DC[indice]);
+                retire_huffman_table(desc, desc->tables_DC[indice]);
             desc->tables_DC[indice] = load_huffman_table(desc->bitstream, &nb_bytes_read);
         } else {
             if (desc->tables_AC[indice] == NULL)
                 desc->ntables_AC++;
             else
-                free_huffman_table(desc->tables_AC[indice]);
+                retire_huffman_table(desc, desc->tables_AC[indice]);
             desc->tables_AC[indice] = load_huffman_table(desc->bitstream, &nb_bytes_read);
         }
 
@@ -362,6 +393,7 @@ static struct jpeg_desc* create_jpeg_desc(struct bitstream* stream, const char *
 
     /* Pointeurs sur les tables de quantization */
     desc->quantization_tables_8  = NULL;
+    desc->quantization_tables_idct = NULL;
     desc->quantization_tables_16 = NULL;
 
     /* Nombre de composantes */
@@ -373,6 +405,8 @@ static struct jpeg_desc* create_jpeg_desc(struct bitstream* stream, const char *
     desc->ntables_qt_16 = 0;
     desc->ntables_AC = 0;
     desc->ntables_DC = 0;
+    desc->tables_remplacees  = NULL;
+    desc->ntables_remplacees = 0;
 
     /* Champs relatifs au mode progressif */
     desc->prog_ss = 0;
@@ -386,11 +420,6 @@ static struct jpeg_desc* create_jpeg_desc(struct bitstream* stream, const char *
         desc->tables_DC[i] = NULL;
     }
 
-    /* Tableaux de remapping des MCUs */
-    for (size_t i=0; i<3; i++) {
-        desc->mcu_maps[i] = NULL;
-    }
-
     return desc;
 }
 
@@ -526,21 +555,23 @@ void close_jpeg(struct jpeg_desc *jdesc) {
     /* Libération des tables de Huffman */
     for (size_t i=0; i<jdesc->ntables_AC; i++) free_huffman_table(jdesc->tables_AC[i]);
     for (size_t i=0; i<jdesc->ntables_DC; i++) free_huffman_table(jdesc->tables_DC[i]);
+    for (size_t i=0; i<jdesc->ntables_remplacees; i++) free_huffman_table(jdesc->tables_remplacees[i]);
+    free(jdesc->tables_remplacees);
 
     /* Libération des tables de quantification */
     if (jdesc->ntables_qt_8>0) {
-        for (size_t i=0; i<jdesc->ntables_qt_8;  i++) free(jdesc->quantization_tables_8[i]);
+        for (size_t i=0; i<jdesc->ntables_qt_8;  i++) {
+            free(jdesc->quantization_tables_8[i]);
+            free(jdesc->quantization_tables_idct[i]);
+        }
         free(jdesc->quantization_tables_8);
+        free(jdesc->quantization_tables_idct);
     }
     if (jdesc->ntables_qt_16>0) {
         for (size_t i=0; i<jdesc->ntables_qt_16; i++) free(jdesc->quantization_tables_16[i]);
         free(jdesc->quantization_tables_16);
     }
 
-    /* Libération des mappings MCUs */
-    for (size_t i=COMP_Y; i<COMP_NB; i++) if (jdesc->mcu_maps[i] != NULL)
-        free(jdesc->mcu_maps[i]);
-
     free(jdesc);
 }
 
@@ -567,6 +598,11 @@ uint8_t *get_quantization_table(const struct jpeg_desc *jdesc, uint8_t index)
     return jdesc->quantization_tables_8[index];
 }
 
+const int32_t *get_idct_quantization_table(const struct jpeg_desc *jdesc, uint8_t index)
+{
+    return jdesc->quantization_tables_idct[index];
+}
+
 /*
  * Getters : données du champ DHT
  */
@@ -596,6 +632,15 @@ struct huff_table *get_huffman_table(const struct jpeg_desc *jdesc, enum acdc ac
 uint16_t get_image_size(struct jpeg_desc *jdesc, enum direction dir) {
     return (dir == DIR_H) ? jdesc->largeur : jdesc->hauteur;
 }
+uint16_t get_output_size(struct jpeg_desc *jdesc, enum direction dir) {
+    /* Décodage réduit : dimension divisée par P_SCALE, arrondie au supérieur */
+    return (get_image_size(jdesc, dir) + P_SCALE - 1)/P_SCALE;
+}
+uint16_t get_oriented_size(struct jpeg_desc *jdesc, enum direction dir) {
+    /* Rotation de 90 ou 270 degrés (orientations EXIF 5 à 8) : largeur et hauteur échangées */
+    if (P_ORIENTATION >= 5) dir = (dir == DIR_H) ? DIR_V : DIR_H;
+    return get_output_size(jdesc, dir);
+}
 uint8_t get_nb_components(const struct jpeg_desc *jdesc) {
     return jdesc->nb_comp;
 }
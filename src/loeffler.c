@@ -2,15 +2,18 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <math.h>
+#include <string.h>
 
 #include "jpeg_const.h"
+#include "iqzz.h"
+#include "idct.h"
 
 
 static float tab_cos[9] = {1.0,
 			               0.98078528040323044912618223613,
 			               0.92387953251128675612818318939,
 			               0.83146961230254523707878837761,
-			               0.70170678118654752440084436210,
+			               0.70710678118654752440084436210,
 			               0.55557023301960222474283081394,
 			               0.38268343236508977172845998403,
 			               0.19509032201612826784828486847,
@@ -115,6 +118,71 @@ static void loeffler_inv(float tableau_coeffs[8])
 	loeffler_butterfly_inv(nouveau_tab[3], nouveau_tab[4], &tableau_coeffs[3], &tableau_coeffs[4]);
 }
 
+/*
+* Fonction:  loeffler_inv_4
+* --------------------
+* loeffler_inv pour un vecteur dont seuls les 4 premiers coefficients
+* peuvent être non nuls : les opérations sur des zéros sont retirées,
+* les autres sont identiques (même résultat que loeffler_inv)
+*
+*  tableau_coeffs : vecteur avec les 8 coefficients pour loeffler
+*
+*/
+static void loeffler_inv_4(float tableau_coeffs[8])
+{
+	float nouveau_tab[8], impair, pair;
+
+	// etapes 4 et 3 : seuls 1 et 3 alimentent la partie impaire, 0 et 2 la partie paire
+	impair = tableau_coeffs[1]/2;
+	loeffler_rond_inv(tableau_coeffs[3], &nouveau_tab[5]);
+	pair = tableau_coeffs[0]/2;
+	loeffler_rotation_inv(tableau_coeffs[2], 0.0, racine, 6, &tableau_coeffs[2], &tableau_coeffs[3]);
+	tableau_coeffs[4] = impair/2;
+	tableau_coeffs[6] = impair/2;
+	loeffler_butterfly_inv(impair, nouveau_tab[5], &tableau_coeffs[7], &tableau_coeffs[5]);
+
+	// etape 2
+
+	loeffler_butterfly_inv(pair, tableau_coeffs[3], &nouveau_tab[0], &nouveau_tab[3]);
+	loeffler_butterfly_inv(pair, tableau_coeffs[2], &nouveau_tab[1], &nouveau_tab[2]);
+	loeffler_rotation_inv(tableau_coeffs[4], tableau_coeffs[7], 1.0, 3, &nouveau_tab[4], &nouveau_tab[7]);
+	loeffler_rotation_inv(tableau_coeffs[5], tableau_coeffs[6], 1.0, 1, &nouveau_tab[5], &nouveau_tab[6]);
+
+	// etape 1
+
+	loeffler_butterfly_inv(nouveau_tab[0], nouveau_tab[7], &tableau_coeffs[0], &tableau_coeffs[7]);
+	loeffler_butterfly_inv(nouveau_tab[1], nouveau_tab[6], &tableau_coeffs[1], &tableau_coeffs[6]);
+	loeffler_butterfly_inv(nouveau_tab[2], nouveau_tab[5], &tableau_coeffs[2], &tableau_coeffs[5]);
+	loeffler_butterfly_inv(nouveau_tab[3], nouveau_tab[4], &tableau_coeffs[3], &tableau_coeffs[4]);
+}
+
+/*
+* Fonction:  loeffler_inv_2
+* --------------------
+* loeffler_inv pour un vecteur dont seuls les 2 premiers coefficients
+* peuvent être non nuls (même résultat que loeffler_inv)
+*
+*  tableau_coeffs : vecteur avec les 8 coefficients pour loeffler
+*
+*/
+static void loeffler_inv_2(float tableau_coeffs[8])
+{
+	float nouveau_tab[8], impair, pair;
+
+	// etapes 4, 3 et 2 : la partie paire est constante, la partie impaire ne dépend que de 1
+	pair   = tableau_coeffs[0]/2/2;
+	impair = tableau_coeffs[1]/2/2;
+	loeffler_rotation_inv(impair, impair, 1.0, 3, &nouveau_tab[4], &nouveau_tab[7]);
+	loeffler_rotation_inv(impair, impair, 1.0, 1, &nouveau_tab[5], &nouveau_tab[6]);
+
+	// etape 1
+
+	loeffler_butterfly_inv(pair, nouveau_tab[7], &tableau_coeffs[0], &tableau_coeffs[7]);
+	loeffler_butterfly_inv(pair, nouveau_tab[6], &tableau_coeffs[1], &tableau_coeffs[6]);
+	loeffler_butterfly_inv(pair, nouveau_tab[5], &tableau_coeffs[2], &tableau_coeffs[5]);
+	loeffler_butterfly_inv(pair, nouveau_tab[4], &tableau_coeffs[3], &tableau_coeffs[4]);
+}
+
 /*
 * Fonction:  loeffler_saturation
 * --------------------
@@ -135,69 +203,139 @@ static float loeffler_saturation(float valeur)
 }
 
 /*
-* Fonction:  loeffler_passage_float
+* Fonction:  loeffler_passage_uint
 * --------------------
-* trans-typage en flottants du bloc d'entiers 16 bits auquel on va appliquer loeffler
+* trans-typage en entiers non signés 8 bits du bloc de flottants auquel on a appliqué loeffler
+* (le facteur 8 de l'iDCT 2D est déjà appliqué par la table de quantification)
 *
-*  bloc : bloc des 64 valeurs sur lesquelles faire l'iDCT
+*  bloc : bloc des 64 valeurs sur lesquelles on vient de faire l'iDCT
 *
 */
-static float *loeffler_passage_float(float* swap_bloc, int16_t *bloc)
+static uint8_t *loeffler_passage_uint(float *bloc)
 {
-	for (uint8_t i=0; i<BLOCK_PIXELS; i++) {
-		swap_bloc[i] = (float) bloc[i];
+	uint8_t *nvx_bloc = malloc(64*sizeof(uint8_t));
+	for (uint8_t i = 0; i < 64; i++) {
+		bloc[i] = loeffler_saturation(bloc[i] + 128.0);
+		nvx_bloc[i] = (uint8_t) round(bloc[i]);
 	}
-	free(bloc);
 
-	return swap_bloc;
+	return nvx_bloc;
 }
 
 /*
-* Fonction:  loeffler_passage_uint
+* Fonction:  loeffler_idct_dc
 * --------------------
-* trans-typage en entiers non signés 8 bits du bloc de flottants auquel on a appliqué loeffler
+* iDCT d'un bloc dont seul le coefficient DC est non nul : le bloc est
+* constant, de valeur DC/8 + 128 (même résultat que loeffler_idct_loeffler)
 *
-*  bloc : bloc des 64 valeurs sur lesquelles on vient de faire l'iDCT
+*  dc : coefficient DC déquantifié du bloc, prémultiplié par IDCT_PRESCALE_FLOAT
 *
 */
-static uint8_t *loeffler_passage_uint(float *bloc)
+uint8_t *loeffler_idct_dc(int32_t dc)
 {
 	uint8_t *nvx_bloc = malloc(64*sizeof(uint8_t));
-	for (uint8_t i = 0; i < 64; i++) {
-		bloc[i] = loeffler_saturation(8*bloc[i] + 128.0);
-		nvx_bloc[i] = (uint8_t) round(bloc[i]);
-	}
+	float valeur = loeffler_saturation((float) dc/(8*IDCT_PRESCALE_FLOAT) + 128.0);
+	memset(nvx_bloc, (uint8_t) round(valeur), 64);
 
 	return nvx_bloc;
 }
 
 /*
-* Fonction:  loeffler_idct_loeffler
+* Fonction:  loeffler_idct_dc_signe
 * --------------------
-* iDCT par application de loeffler à un bloc 8x8
+* version signée de loeffler_idct_dc (voir idct_signe_fn)
 *
-*       bloc : bloc des 64 valeurs sur lesquelles faire l'iDCT
-*  swap_bloc : bloc de flottants utile pour les calculs intermédiaires
+*      dc : coefficient DC déquantifié du bloc, prémultiplié par IDCT_PRESCALE_FLOAT
+*  sortie : reçoit les 64 échantillons arrondis et bornés
 *
 */
-uint8_t *loeffler_idct_loeffler(float* swap_bloc, int16_t *bloc)
+void loeffler_idct_dc_signe(int32_t dc, int16_t *sortie)
 {
-	float *bloc_flottant = loeffler_passage_float(swap_bloc, bloc);
-	// on passe sur chaque ligne
-	for (uint8_t i = 0; i < 8; i++) {
-		loeffler_inv(&bloc_flottant[8*i]);
+	int16_t valeur = idct_arrondi_signe((float) dc/(8*IDCT_PRESCALE_FLOAT));
+	for (uint8_t i = 0; i < 64; i++) {
+		sortie[i] = valeur;
+	}
+}
+
+/*
+* Fonction:  loeffler_idct_flottant
+* --------------------
+* iDCT par application de loeffler à un bloc 8x8 (hors bloc DC seul),
+* quantification inverse comprise (faite au chargement du bloc), sans
+* recentrage ni arrondi
+*
+*           bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*         qtable : table de quantification prémultipliée en ordre naturel
+*            eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+*         taille : côté du carré en haut à gauche contenant tous les coefficients
+*                  non nuls (2, 4 ou 8) : les passes sont réduites en conséquence
+*  bloc_flottant : reçoit les 64 échantillons, centrés sur 0
+*
+*/
+static void loeffler_idct_flottant(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, float *bloc_flottant)
+{
+	/* iDCT 1D adaptée au nombre de coefficients non nuls */
+	void (*inv)(float*) = (taille == 2) ? loeffler_inv_2 : ((taille == 4) ? loeffler_inv_4 : loeffler_inv);
+
+	iqzz_float(bloc_flottant, bloc, qtable, eob);
+	// on passe sur chaque ligne (les lignes suivantes sont nulles et le restent)
+	for (uint8_t i = 0; i < taille; i++) {
+		inv(&bloc_flottant[8*i]);
 	}
 	// on passe sur les colonnes
 	float colonne[8];
 	for (uint8_t i = 0; i < 8; i++) {
-		for (uint8_t j = 0; j < 8; j++) {
+		for (uint8_t j = 0; j < taille; j++) {
 		// on construit les colonnes
 			colonne[j] = bloc_flottant[i + 8*j];
 		}
-		loeffler_inv(colonne);
+		inv(colonne);
 		for (uint8_t j = 0; j < 8; j++) {
 			bloc_flottant[i + 8*j] = colonne[j];
 		}
 	}
+}
+
+/*
+* Fonction:  loeffler_idct_loeffler
+* --------------------
+* iDCT par application de loeffler à un bloc 8x8, quantification inverse
+* comprise (faite au chargement du bloc)
+*
+*       bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*     qtable : table de quantification prémultipliée en ordre naturel
+*        eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+*     taille : côté du carré en haut à gauche contenant tous les coefficients
+*              non nuls (1, 2, 4 ou 8) : les passes sont réduites en conséquence
+*
+*/
+uint8_t *loeffler_idct_loeffler(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille)
+{
+	if (taille == 1) return loeffler_idct_dc(iqzz_dc(bloc, qtable, IDCT_PRESCALE_FLOAT));
+
+	float bloc_flottant[BLOCK_PIXELS];
+	loeffler_idct_flottant(bloc, qtable, eob, taille, bloc_flottant);
 	return loeffler_passage_uint(bloc_flottant);
 }
+
+/*
+* Fonction:  loeffler_idct_loeffler_signe
+* --------------------
+* version signée de loeffler_idct_loeffler (voir idct_signe_fn)
+*
+*  sortie : reçoit les 64 échantillons arrondis et bornés
+*
+*/
+void loeffler_idct_loeffler_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie)
+{
+	if (taille == 1) {
+		loeffler_idct_dc_signe(iqzz_dc(bloc, qtable, IDCT_PRESCALE_FLOAT), sortie);
+		return;
+	}
+
+	float bloc_flottant[BLOCK_PIXELS];
+	loeffler_idct_flottant(bloc, qtable, eob, taille, bloc_flottant);
+	for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+		sortie[i] = idct_arrondi_signe(bloc_flottant[i]);
+	}
+}
@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "jpeg_const.h"
+#include "iqzz.h"
+#include "idct.h"
+
+/*
+    iDCT 8x8 en virgule fixe (algorithme de Loeffler, Ligtenberg et Moschytz) :
+    les cosinus sont des constantes entières sur CONST_BITS bits, la première
+    passe (colonnes) garde PASS1_BITS bits de précision supplémentaires.
+    Les produits tiennent sur 32 bits pour des coefficients JPEG 8 bits.
+
+    Adapté de jidctint.c de la bibliothèque libjpeg de l'Independent JPEG
+    Group (Copyright (C) 1991-1998, Thomas G. Lane) : constantes, passes et
+    arrondis en reprennent la structure. Ce logiciel est basé en partie sur
+    le travail de l'Independent JPEG Group.
+*/
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+/* Constantes FIX(x) = round(x * 2^CONST_BITS) */
+#define FIX_0_298631336  ((int32_t)  2446)
+#define FIX_0_390180644  ((int32_t)  3196)
+#define FIX_0_541196100  ((int32_t)  4433)
+#define FIX_0_765366865  ((int32_t)  6270)
+#define FIX_0_899976223  ((int32_t)  7373)
+#define FIX_1_175875602  ((int32_t)  9633)
+#define FIX_1_501321110  ((int32_t) 12299)
+#define FIX_1_847759065  ((int32_t) 15137)
+#define FIX_1_961570560  ((int32_t) 16069)
+#define FIX_2_053119869  ((int32_t) 16819)
+#define FIX_2_562915447  ((int32_t) 20995)
+#define FIX_3_072711026  ((int32_t) 25172)
+
+/* Division par 2^n arrondie au plus proche */
+#define DESCALE(x, n)  (((x) + ((int32_t)1 << ((n)-1))) >> (n))
+
+
+/*
+* Fonction:  loeffler_int_sortie
+* --------------------
+* papillons de sortie de l'iDCT 1D : combine les parties paire et impaire
+* et écrit les 8 sorties, divisées par 2^shift, dans out[0], out[pas], ...
+*
+*  out   : vecteur de sortie
+*  pas   : écart entre deux points consécutifs
+*  shift : nombre de bits de précision à retirer en sortie
+*  pair  : partie paire (tmp10, tmp11, tmp12, tmp13)
+*  imp   : partie impaire (tmp0, tmp1, tmp2, tmp3)
+*
+*/
+static inline void loeffler_int_sortie(int32_t* out, uint8_t pas, uint8_t shift, const int32_t pair[4], const int32_t imp[4])
+{
+	out[0]     = DESCALE(pair[0] + imp[3], shift);
+	out[7*pas] = DESCALE(pair[0] - imp[3], shift);
+	out[pas]   = DESCALE(pair[1] + imp[2], shift);
+	out[6*pas] = DESCALE(pair[1] - imp[2], shift);
+	out[2*pas] = DESCALE(pair[2] + imp[1], shift);
+	out[5*pas] = DESCALE(pair[2] - imp[1], shift);
+	out[3*pas] = DESCALE(pair[3] + imp[0], shift);
+	out[4*pas] = DESCALE(pair[3] - imp[0], shift);
+}
+
+/*
+* Fonction:  loeffler_int_1d
+* --------------------
+* iDCT 1D sur 8 points en virgule fixe : lit in[0], in[pas], ..., in[7*pas]
+* et écrit les 8 sorties, divisées par 2^shift, dans out[0], out[pas], ...
+*
+*  in    : vecteur d'entrée
+*  out   : vecteur de sortie
+*  pas   : écart entre deux points consécutifs
+*  shift : nombre de bits de précision à retirer en sortie
+*
+*/
+static inline void loeffler_int_1d(const int32_t* in, int32_t* out, uint8_t pas, uint8_t shift)
+{
+	int32_t tmp0, tmp1, tmp2, tmp3, pair[4], imp[4];
+	int32_t z1, z2, z3, z4, z5;
+
+	/* Partie paire : rotation sqrt(2)*c6 sur (2, 6), papillons sur (0, 4) */
+	z2 = in[2*pas];
+	z3 = in[6*pas];
+	z1   = (z2 + z3) * FIX_0_541196100;
+	tmp2 = z1 - z3 * FIX_1_847759065;
+	tmp3 = z1 + z2 * FIX_0_765366865;
+
+	tmp0 = (in[0] + in[4*pas]) * (1 << CONST_BITS);
+	tmp1 = (in[0] - in[4*pas]) * (1 << CONST_BITS);
+
+	pair[0] = tmp0 + tmp3;
+	pair[3] = tmp0 - tmp3;
+	pair[1] = tmp1 + tmp2;
+	pair[2] = tmp1 - tmp2;
+
+	/* Partie impaire : rotations c3 et c1, factorisées */
+	tmp0 = in[7*pas];
+	tmp1 = in[5*pas];
+	tmp2 = in[3*pas];
+	tmp3 = in[pas];
+
+	z1 = tmp0 + tmp3;
+	z2 = tmp1 + tmp2;
+	z3 = tmp0 + tmp2;
+	z4 = tmp1 + tmp3;
+	z5 = (z3 + z4) * FIX_1_175875602;
+
+	z1 *= -FIX_0_899976223;
+	z2 *= -FIX_2_562915447;
+	z3 = z3 * -FIX_1_961570560 + z5;
+	z4 = z4 * -FIX_0_390180644 + z5;
+
+	imp[0] = tmp0 * FIX_0_298631336 + z1 + z3;
+	imp[1] = tmp1 * FIX_2_053119869 + z2 + z4;
+	imp[2] = tmp2 * FIX_3_072711026 + z2 + z3;
+	imp[3] = tmp3 * FIX_1_501321110 + z1 + z4;
+
+	loeffler_int_sortie(out, pas, shift, pair, imp);
+}
+
+/*
+* Fonction:  loeffler_int_1d_4
+* --------------------
+* loeffler_int_1d pour un vecteur dont seuls les 4 premiers points
+* peuvent être non nuls (calcul entier : résultat identique)
+*
+*/
+static inline void loeffler_int_1d_4(const int32_t* in, int32_t* out, uint8_t pas, uint8_t shift)
+{
+	int32_t tmp0, tmp2, tmp3, pair[4], imp[4];
+	int32_t z1, z2, z3, z4, z5;
+
+	/* Partie paire : 6 et 4 sont nuls */
+	z2   = in[2*pas];
+	tmp2 = z2 * FIX_0_541196100;
+	tmp3 = tmp2 + z2 * FIX_0_765366865;
+	tmp0 = in[0] * (1 << CONST_BITS);
+
+	pair[0] = tmp0 + tmp3;
+	pair[3] = tmp0 - tmp3;
+	pair[1] = tmp0 + tmp2;
+	pair[2] = tmp0 - tmp2;
+
+	/* Partie impaire : 7 et 5 sont nuls */
+	tmp2 = in[3*pas];
+	tmp3 = in[pas];
+	z5 = (tmp2 + tmp3) * FIX_1_175875602;
+	z1 = tmp3 * -FIX_0_899976223;
+	z2 = tmp2 * -FIX_2_562915447;
+	z3 = tmp2 * -FIX_1_961570560 + z5;
+	z4 = tmp3 * -FIX_0_390180644 + z5;
+
+	imp[0] = z1 + z3;
+	imp[1] = z2 + z4;
+	imp[2] = tmp2 * FIX_3_072711026 + z2 + z3;
+	imp[3] = tmp3 * FIX_1_501321110 + z1 + z4;
+
+	loeffler_int_sortie(out, pas, shift, pair, imp);
+}
+
+/*
+* Fonction:  loeffler_int_1d_2
+* --------------------
+* loeffler_int_1d pour un vecteur dont seuls les 2 premiers points
+* peuvent être non nuls (calcul entier : résultat identique)
+*
+*/
+static inline void loeffler_int_1d_2(const int32_t* in, int32_t* out, uint8_t pas, uint8_t shift)
+{
+	int32_t pair[4], imp[4];
+
+	/* Partie paire constante */
+	pair[0] = pair[1] = pair[2] = pair[3] = in[0] * (1 << CONST_BITS);
+
+	/* Partie impaire : seul le point 1 contribue */
+	int32_t z5 = in[pas] * FIX_1_175875602;
+	imp[0] = in[pas] * -FIX_0_899976223 + z5;
+	imp[1] = in[pas] * -FIX_0_390180644 + z5;
+	imp[2] = z5;
+	imp[3] = in[pas] * (FIX_1_501321110 - FIX_0_899976223 - FIX_0_390180644) + z5;
+
+	loeffler_int_sortie(out, pas, shift, pair, imp);
+}
+
+/*
+* Fonction:  loeffler_int_saturation
+* --------------------
+* recentre et sature une sortie de l'iDCT entre 0 et 255
+*
+*  valeur : échantillon signé issu de l'iDCT
+*
+*/
+static inline uint8_t loeffler_int_saturation(int32_t valeur)
+{
+	valeur += 128;
+	if (valeur < 0) {
+		valeur = 0;
+	} else if (valeur > 255) {
+		valeur = 255;
+	}
+
+	return (uint8_t) valeur;
+}
+
+/*
+* Fonction:  loeffler_int_calcul
+* --------------------
+* iDCT en virgule fixe d'un bloc 8x8, quantification inverse comprise
+* (faite au chargement du bloc) : échantillons arrondis, sans recentrage
+* ni saturation
+*
+*    bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*  qtable : table de quantification en ordre naturel
+*     eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+*  taille : côté du carré en haut à gauche contenant tous les coefficients
+*           non nuls (1, 2, 4 ou 8) : les passes sont réduites en conséquence
+*  sortie : reçoit les 64 échantillons, centrés sur 0
+*
+*/
+static void loeffler_int_calcul(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int32_t *sortie)
+{
+	int32_t entree[BLOCK_PIXELS], inter[BLOCK_PIXELS];
+
+	/* Bloc DC seul : les deux passes donnent une constante */
+	if (taille == 1) {
+		int32_t dc = DESCALE(iqzz_dc(bloc, qtable, 1) * (1 << (PASS1_BITS + CONST_BITS)), CONST_BITS + PASS1_BITS + 3);
+		for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+			sortie[i] = dc;
+		}
+		return;
+	}
+
+	/* iDCT 1D adaptée au nombre de points non nuls */
+	void (*idct_1d)(const int32_t*, int32_t*, uint8_t, uint8_t) =
+		(taille == 2) ? loeffler_int_1d_2 : ((taille == 4) ? loeffler_int_1d_4 : loeffler_int_1d);
+
+	iqzz_int(entree, bloc, qtable, eob);
+
+	// on passe sur les colonnes non nulles, en gardant PASS1_BITS bits de précision
+	for (uint8_t i = 0; i < taille; i++) {
+		/* Colonne sans coefficient AC : sortie constante */
+		if (taille == 8 && (entree[8+i] | entree[16+i] | entree[24+i] | entree[32+i] |
+		                    entree[40+i] | entree[48+i] | entree[56+i]) == 0) {
+			int32_t dc = entree[i] * (1 << PASS1_BITS);
+			for (uint8_t j = 0; j < 8; j++) {
+				inter[i + 8*j] = dc;
+			}
+			continue;
+		}
+		idct_1d(&entree[i], &inter[i], 8, CONST_BITS - PASS1_BITS);
+	}
+
+	// on passe sur les lignes : on retire la précision et le facteur 8 de l'iDCT 2D
+	for (uint8_t i = 0; i < 8; i++) {
+		idct_1d(&inter[8*i], &sortie[8*i], 1, CONST_BITS + PASS1_BITS + 3);
+	}
+}
+
+/*
+* Fonction:  loeffler_idct_int
+* --------------------
+* iDCT en virgule fixe d'un bloc 8x8, recentrée et saturée sur 8 bits
+* (paramètres : voir loeffler_int_calcul)
+*
+*/
+uint8_t *loeffler_idct_int(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille)
+{
+	int32_t sortie[BLOCK_PIXELS];
+	uint8_t *nvx_bloc = malloc(BLOCK_PIXELS*sizeof(uint8_t));
+
+	loeffler_int_calcul(bloc, qtable, eob, taille, sortie);
+	for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+		nvx_bloc[i] = loeffler_int_saturation(sortie[i]);
+	}
+
+	return nvx_bloc;
+}
+
+/*
+* Fonction:  loeffler_idct_int_signe
+* --------------------
+* version signée de loeffler_idct_int (voir idct_signe_fn)
+*
+*  sortie : reçoit les 64 échantillons bornés
+*
+*/
+void loeffler_idct_int_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie)
+{
+	int32_t valeurs[BLOCK_PIXELS];
+
+	loeffler_int_calcul(bloc, qtable, eob, taille, valeurs);
+	for (uint8_t i = 0; i < BLOCK_PIXELS; i++) {
+		sortie[i] = idct_arrondi_signe(valeurs[i]);
+	}
+}
@@ -0,0 +1,730 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "jpeg_const.h"
+#include "loeffler.h"
+#include "iqzz.h"
+#include "idct.h"
+
+/*
+    iDCT de Loeffler vectorisée (SSE2 et AVX2) : mêmes opérations flottantes que
+    loeffler.c, appliquées à 4 (SSE2) ou 8 (AVX2) lignes/colonnes à la fois.
+    Le bloc est transposé en registres entre les deux passes, puis saturé
+    et compacté sur 8 bits non signés.
+    Les versions par lots (AVX2 : 8 blocs, AVX-512 : 16 blocs) placent un
+    bloc par voie : les deux passes se font alors sans transposition, seuls
+    les octets de sortie sont redistribués entre les blocs.
+*/
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <immintrin.h>
+
+#define COS_1  0.98078528040323044912618223613f
+#define COS_2  0.92387953251128675612818318939f
+#define COS_3  0.83146961230254523707878837761f
+#define COS_5  0.55557023301960222474283081394f
+#define COS_6  0.38268343236508977172845998403f
+#define COS_7  0.19509032201612826784828486847f
+#define RACINE 1.41421356237309504880168872420f
+
+//===============================================================================================
+// SSE2 : 4 voies
+
+/*
+* Fonction:  loeffler_inv_sse2
+* --------------------
+* iDCT 1D de loeffler sur 4 vecteurs de 8 points à la fois
+* (v[i] contient le point i de chacun des 4 vecteurs)
+*
+*  v : les 8 points, modifiés en place
+*
+*/
+static inline void loeffler_inv_sse2(__m128 v[8])
+{
+	const __m128 demi = _mm_set1_ps(0.5f), racine = _mm_set1_ps(RACINE);
+	__m128 n[8], t[8];
+
+	// etape 4
+	n[7] = _mm_mul_ps(_mm_add_ps(v[1], v[7]), demi);
+	n[4] = _mm_mul_ps(_mm_sub_ps(v[1], v[7]), demi);
+	n[6] = _mm_div_ps(v[5], racine);
+	n[5] = _mm_div_ps(v[3], racine);
+	n[3] = v[6]; n[2] = v[2]; n[1] = v[4]; n[0] = v[0];
+
+	// etape 3
+	t[0] = _mm_mul_ps(_mm_add_ps(n[0], n[1]), demi);
+	t[1] = _mm_mul_ps(_mm_sub_ps(n[0], n[1]), demi);
+	t[2] = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(n[2], _mm_set1_ps(COS_6)), _mm_mul_ps(n[3], _mm_set1_ps(COS_2))), racine);
+	t[3] = _mm_div_ps(_mm_add_ps(_mm_mul_ps(n[3], _mm_set1_ps(COS_6)), _mm_mul_ps(n[2], _mm_set1_ps(COS_2))), racine);
+	t[4] = _mm_mul_ps(_mm_add_ps(n[4], n[6]), demi);
+	t[6] = _mm_mul_ps(_mm_sub_ps(n[4], n[6]), demi);
+	t[7] = _mm_mul_ps(_mm_add_ps(n[7], n[5]), demi);
+	t[5] = _mm_mul_ps(_mm_sub_ps(n[7], n[5]), demi);
+
+	// etape 2
+	n[0] = _mm_mul_ps(_mm_add_ps(t[0], t[3]), demi);
+	n[3] = _mm_mul_ps(_mm_sub_ps(t[0], t[3]), demi);
+	n[1] = _mm_mul_ps(_mm_add_ps(t[1], t[2]), demi);
+	n[2] = _mm_mul_ps(_mm_sub_ps(t[1], t[2]), demi);
+	n[4] = _mm_sub_ps(_mm_mul_ps(t[4], _mm_set1_ps(COS_3)), _mm_mul_ps(t[7], _mm_set1_ps(COS_5)));
+	n[7] = _mm_add_ps(_mm_mul_ps(t[7], _mm_set1_ps(COS_3)), _mm_mul_ps(t[4], _mm_set1_ps(COS_5)));
+	n[5] = _mm_sub_ps(_mm_mul_ps(t[5], _mm_set1_ps(COS_1)), _mm_mul_ps(t[6], _mm_set1_ps(COS_7)));
+	n[6] = _mm_add_ps(_mm_mul_ps(t[6], _mm_set1_ps(COS_1)), _mm_mul_ps(t[5], _mm_set1_ps(COS_7)));
+
+	// etape 1
+	v[0] = _mm_mul_ps(_mm_add_ps(n[0], n[7]), demi);
+	v[7] = _mm_mul_ps(_mm_sub_ps(n[0], n[7]), demi);
+	v[1] = _mm_mul_ps(_mm_add_ps(n[1], n[6]), demi);
+	v[6] = _mm_mul_ps(_mm_sub_ps(n[1], n[6]), demi);
+	v[2] = _mm_mul_ps(_mm_add_ps(n[2], n[5]), demi);
+	v[5] = _mm_mul_ps(_mm_sub_ps(n[2], n[5]), demi);
+	v[3] = _mm_mul_ps(_mm_add_ps(n[3], n[4]), demi);
+	v[4] = _mm_mul_ps(_mm_sub_ps(n[3], n[4]), demi);
+}
+
+/*
+* Fonction:  transpose_sse2
+* --------------------
+* transpose un bloc 8x8 rangé en demi-lignes : m[2*i] (colonnes 0..3)
+* et m[2*i+1] (colonnes 4..7) de la ligne i
+*
+*  m : bloc à transposer, modifié en place
+*
+*/
+static inline void transpose_sse2(__m128 m[16])
+{
+	__m128 hg[4] = {m[0], m[2], m[4], m[6]},    hd[4] = {m[1], m[3], m[5], m[7]},
+	       bg[4] = {m[8], m[10], m[12], m[14]}, bd[4] = {m[9], m[11], m[13], m[15]};
+
+	_MM_TRANSPOSE4_PS(hg[0], hg[1], hg[2], hg[3]);
+	_MM_TRANSPOSE4_PS(hd[0], hd[1], hd[2], hd[3]);
+	_MM_TRANSPOSE4_PS(bg[0], bg[1], bg[2], bg[3]);
+	_MM_TRANSPOSE4_PS(bd[0], bd[1], bd[2], bd[3]);
+
+	/* Les tuiles hors diagonale s'échangent */
+	for (uint8_t i = 0; i < 4; i++) {
+		m[2*i]         = hg[i]; m[2*i + 1]     = bg[i];
+		m[2*(i+4)]     = hd[i]; m[2*(i+4) + 1] = bd[i];
+	}
+}
+
+/*
+* Fonction:  loeffler_passes_sse2
+* --------------------
+* déquantification et deux passes de l'iDCT de loeffler d'un bloc 8x8,
+* version SSE2 : gauche[i] (resp. droite[i]) reçoit les colonnes 0..3
+* (resp. 4..7) de la ligne i, centrées sur 0
+*
+*    bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*  qtable : table de quantification prémultipliée en ordre naturel
+*     eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+*
+*/
+static inline void loeffler_passes_sse2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, __m128 gauche[8], __m128 droite[8])
+{
+	float coeffs[BLOCK_PIXELS] __attribute__((aligned(16)));
+	__m128 m[16];
+
+	/* Déquantification, puis chargement par demi-lignes */
+	iqzz_float(coeffs, bloc, qtable, eob);
+	for (uint8_t i = 0; i < 8; i++) {
+		m[2*i]     = _mm_load_ps(&coeffs[8*i]);
+		m[2*i + 1] = _mm_load_ps(&coeffs[8*i + 4]);
+	}
+
+	// on passe sur chaque ligne : après transposition, m[2*j] contient le point j des lignes 0..3
+	transpose_sse2(m);
+	for (uint8_t j = 0; j < 8; j++) { gauche[j] = m[2*j]; droite[j] = m[2*j + 1]; }
+	loeffler_inv_sse2(gauche);
+	loeffler_inv_sse2(droite);
+	for (uint8_t j = 0; j < 8; j++) { m[2*j] = gauche[j]; m[2*j + 1] = droite[j]; }
+
+	// on passe sur les colonnes : m[2*i] contient à nouveau les colonnes 0..3 de la ligne i
+	transpose_sse2(m);
+	for (uint8_t i = 0; i < 8; i++) { gauche[i] = m[2*i]; droite[i] = m[2*i + 1]; }
+	loeffler_inv_sse2(gauche);
+	loeffler_inv_sse2(droite);
+}
+
+/*
+* Fonction:  loeffler_idct_sse2
+* --------------------
+* iDCT de loeffler d'un bloc 8x8 (quantification inverse comprise), version SSE2
+*
+*    bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*  qtable : table de quantification prémultipliée en ordre naturel
+*     eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+*  taille : côté du carré en haut à gauche contenant tous les coefficients
+*           non nuls (1, 2, 4 ou 8) : seul le bloc DC seul est spécialisé
+*
+*/
+uint8_t *loeffler_idct_sse2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille)
+{
+	if (taille == 1) return loeffler_idct_dc(iqzz_dc(bloc, qtable, IDCT_PRESCALE_FLOAT));
+
+	uint8_t *nvx_bloc = malloc(BLOCK_PIXELS*sizeof(uint8_t));
+	__m128 gauche[8], droite[8];
+
+	loeffler_passes_sse2(bloc, qtable, eob, gauche, droite);
+
+	/* x + 128 (facteur 8 porté par la table), saturation, arrondi au plus proche (x >= 0) puis passage sur 8 bits */
+	const __m128 decalage = _mm_set1_ps(128.0f),
+	             zero = _mm_setzero_ps(), max = _mm_set1_ps(255.0f), demi = _mm_set1_ps(0.5f);
+	for (uint8_t i = 0; i < 8; i++) {
+		__m128 g = _mm_min_ps(_mm_max_ps(_mm_add_ps(gauche[i], decalage), zero), max);
+		__m128 d = _mm_min_ps(_mm_max_ps(_mm_add_ps(droite[i], decalage), zero), max);
+		__m128i mots = _mm_packs_epi32(_mm_cvttps_epi32(_mm_add_ps(g, demi)),
+		                               _mm_cvttps_epi32(_mm_add_ps(d, demi)));
+		_mm_storel_epi64((__m128i*)&nvx_bloc[8*i], _mm_packus_epi16(mots, mots));
+	}
+
+	return nvx_bloc;
+}
+
+/*
+* Fonction:  loeffler_idct_sse2_signe
+* --------------------
+* version signée de loeffler_idct_sse2 (voir idct_signe_fn)
+*
+*  sortie : reçoit les 64 échantillons arrondis et bornés
+*
+*/
+void loeffler_idct_sse2_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie)
+{
+	if (taille == 1) {
+		loeffler_idct_dc_signe(iqzz_dc(bloc, qtable, IDCT_PRESCALE_FLOAT), sortie);
+		return;
+	}
+
+	float valeurs[BLOCK_PIXELS] __attribute__((aligned(16)));
+	__m128 gauche[8], droite[8];
+
+	loeffler_passes_sse2(bloc, qtable, eob, gauche, droite);
+	for (uint8_t i = 0; i < 8; i++) {
+		_mm_store_ps(&valeurs[8*i], gauche[i]);
+		_mm_store_ps(&valeurs[8*i + 4], droite[i]);
+	}
+	for (uint8_t i = 0; i < BLOCK_PIXELS; i++) sortie[i] = idct_arrondi_signe(valeurs[i]);
+}
+
+//===============================================================================================
+// AVX2 : 8 voies
+
+/*
+* Fonction:  loeffler_inv_avx2
+* --------------------
+* iDCT 1D de loeffler sur 8 vecteurs de 8 points à la fois
+* (v[i] contient le point i de chacun des 8 vecteurs)
+*
+*  v : les 8 points, modifiés en place
+*
+*/
+__attribute__((target("avx2")))
+static inline void loeffler_inv_avx2(__m256 v[8])
+{
+	const __m256 demi = _mm256_set1_ps(0.5f), racine = _mm256_set1_ps(RACINE);
+	__m256 n[8], t[8];
+
+	// etape 4
+	n[7] = _mm256_mul_ps(_mm256_add_ps(v[1], v[7]), demi);
+	n[4] = _mm256_mul_ps(_mm256_sub_ps(v[1], v[7]), demi);
+	n[6] = _mm256_div_ps(v[5], racine);
+	n[5] = _mm256_div_ps(v[3], racine);
+	n[3] = v[6]; n[2] = v[2]; n[1] = v[4]; n[0] = v[0];
+
+	// etape 3
+	t[0] = _mm256_mul_ps(_mm256_add_ps(n[0], n[1]), demi);
+	t[1] = _mm256_mul_ps(_mm256_sub_ps(n[0], n[1]), demi);
+	t[2] = _mm256_div_ps(_mm256_sub_ps(_mm256_mul_ps(n[2], _mm256_set1_ps(COS_6)), _mm256_mul_ps(n[3], _mm256_set1_ps(COS_2))), racine);
+	t[3] = _mm256_div_ps(_mm256_add_ps(_mm256_mul_ps(n[3], _mm256_set1_ps(COS_6)), _mm256_mul_ps(n[2], _mm256_set1_ps(COS_2))), racine);
+	t[4] = _mm256_mul_ps(_mm256_add_ps(n[4], n[6]), demi);
+	t[6] = _mm256_mul_ps(_mm256_sub_ps(n[4], n[6]), demi);
+	t[7] = _mm256_mul_ps(_mm256_add_ps(n[7], n[5]), demi);
+	t[5] = _mm256_mul_ps(_mm256_sub_ps(n[7], n[5]), demi);
+
+	// etape 2
+	n[0] = _mm256_mul_ps(_mm256_add_ps(t[0], t[3]), demi);
+	n[3] = _mm256_mul_ps(_mm256_sub_ps(t[0], t[3]), demi);
+	n[1] = _mm256_mul_ps(_mm256_add_ps(t[1], t[2]), demi);
+	n[2] = _mm256_mul_ps(_mm256_sub_ps(t[1], t[2]), demi);
+	n[4] = _mm256_sub_ps(_mm256_mul_ps(t[4], _mm256_set1_ps(COS_3)), _mm256_mul_ps(t[7], _mm256_set1_ps(COS_5)));
+	n[7] = _mm256_add_ps(_mm256_mul_ps(t[7], _mm256_set1_ps(COS_3)), _mm256_mul_ps(t[4], _mm256_set1_ps(COS_5)));
+	n[5] = _mm256_sub_ps(_mm256_mul_ps(t[5], _mm256_set1_ps(COS_1)), _mm256_mul_ps(t[6], _mm256_set1_ps(COS_7)));
+	n[6] = _mm256_add_ps(_mm256_mul_ps(t[6], _mm256_set1_ps(COS_1)), _mm256_mul_ps(t[5], _mm256_set1_ps(COS_7)));
+
+	// etape 1
+	v[0] = _mm256_mul_ps(_mm256_add_ps(n[0], n[7]), demi);
+	v[7] = _mm256_mul_ps(_mm256_sub_ps(n[0], n[7]), demi);
+	v[1] = _mm256_mul_ps(_mm256_add_ps(n[1], n[6]), demi);
+	v[6] = _mm256_mul_ps(_mm256_sub_ps(n[1], n[6]), demi);
+	v[2] = _mm256_mul_ps(_mm256_add_ps(n[2], n[5]), demi);
+	v[5] = _mm256_mul_ps(_mm256_sub_ps(n[2], n[5]), demi);
+	v[3] = _mm256_mul_ps(_mm256_add_ps(n[3], n[4]), demi);
+	v[4] = _mm256_mul_ps(_mm256_sub_ps(n[3], n[4]), demi);
+}
+
+/*
+* Fonction:  transpose_avx2
+* --------------------
+* transpose un bloc 8x8 de flottants (m[i] : ligne i)
+*
+*  m : bloc à transposer, modifié en place
+*
+*/
+__attribute__((target("avx2")))
+static inline void transpose_avx2(__m256 m[8])
+{
+	__m256 a[8], b[8];
+
+	/* Entrelacement des paires de lignes */
+	for (uint8_t i = 0; i < 8; i += 2) {
+		a[i]     = _mm256_unpacklo_ps(m[i], m[i+1]);
+		a[i + 1] = _mm256_unpackhi_ps(m[i], m[i+1]);
+	}
+	/* Regroupement par quadruplets */
+	for (uint8_t i = 0; i < 8; i += 4) {
+		b[i]     = _mm256_shuffle_ps(a[i],     a[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+		b[i + 1] = _mm256_shuffle_ps(a[i],     a[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+		b[i + 2] = _mm256_shuffle_ps(a[i + 1], a[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+		b[i + 3] = _mm256_shuffle_ps(a[i + 1], a[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+	}
+	/* Échange des moitiés 128 bits */
+	for (uint8_t i = 0; i < 4; i++) {
+		m[i]     = _mm256_permute2f128_ps(b[i], b[i + 4], 0x20);
+		m[i + 4] = _mm256_permute2f128_ps(b[i], b[i + 4], 0x31);
+	}
+}
+
+/*
+* Fonction:  loeffler_passes_avx2
+* --------------------
+* déquantification et deux passes de l'iDCT de loeffler d'un bloc 8x8,
+* version AVX2 : m[i] reçoit la ligne i, centrée sur 0
+*
+*    bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*  qtable : table de quantification prémultipliée en ordre naturel
+*     eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+*
+*/
+__attribute__((target("avx2")))
+static inline void loeffler_passes_avx2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, __m256 m[8])
+{
+	float coeffs[BLOCK_PIXELS] __attribute__((aligned(32)));
+
+	/* Déquantification, puis chargement par lignes */
+	iqzz_float(coeffs, bloc, qtable, eob);
+	for (uint8_t i = 0; i < 8; i++) {
+		m[i] = _mm256_load_ps(&coeffs[8*i]);
+	}
+
+	// on passe sur chaque ligne (m[j] : point j de toutes les lignes)
+	transpose_avx2(m);
+	loeffler_inv_avx2(m);
+
+	// on passe sur les colonnes (m[i] : ligne i)
+	transpose_avx2(m);
+	loeffler_inv_avx2(m);
+}
+
+/*
+* Fonction:  loeffler_idct_avx2
+* --------------------
+* iDCT de loeffler d'un bloc 8x8 (quantification inverse comprise), version AVX2
+*
+*    bloc : bloc des 64 coefficients quantifiés, en ordre naturel
+*  qtable : table de quantification prémultipliée en ordre naturel
+*     eob : nombre de coefficients zig-zag à traiter, les suivants sont nuls
+*  taille : côté du carré en haut à gauche contenant tous les coefficients
+*           non nuls (1, 2, 4 ou 8) : seul le bloc DC seul est spécialisé
+*
+*/
+__attribute__((target("avx2")))
+uint8_t *loeffler_idct_avx2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille)
+{
+	if (taille == 1) return loeffler_idct_dc(iqzz_dc(bloc, qtable, IDCT_PRESCALE_FLOAT));
+
+	uint8_t *nvx_bloc = malloc(BLOCK_PIXELS*sizeof(uint8_t));
+	__m256 m[8];
+
+	loeffler_passes_avx2(bloc, qtable, eob, m);
+
+	/* x + 128 (facteur 8 porté par la table), saturation, arrondi au plus proche (x >= 0) puis passage sur 8 bits */
+	const __m256 decalage = _mm256_set1_ps(128.0f),
+	             zero = _mm256_setzero_ps(), max = _mm256_set1_ps(255.0f), demi = _mm256_set1_ps(0.5f);
+	for (uint8_t i = 0; i < 8; i += 2) {
+		__m256 h = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(m[i], decalage), zero), max);
+		__m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(m[i+1], decalage), zero), max);
+		__m256i eh = _mm256_cvttps_epi32(_mm256_add_ps(h, demi)),
+		        eb = _mm256_cvttps_epi32(_mm256_add_ps(b, demi));
+		/* packs travaille par moitié de 128 bits : on réordonne avant de compacter */
+		__m128i mh = _mm_packs_epi32(_mm256_castsi256_si128(eh), _mm256_extracti128_si256(eh, 1)),
+		        mb = _mm_packs_epi32(_mm256_castsi256_si128(eb), _mm256_extracti128_si256(eb, 1));
+		_mm_storeu_si128((__m128i*)&nvx_bloc[8*i], _mm_packus_epi16(mh, mb));
+	}
+
+	return nvx_bloc;
+}
+
+/*
+* Fonction:  loeffler_idct_avx2_signe
+* --------------------
+* version signée de loeffler_idct_avx2 (voir idct_signe_fn)
+*
+*  sortie : reçoit les 64 échantillons arrondis et bornés
+*
+*/
+__attribute__((target("avx2")))
+void loeffler_idct_avx2_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie)
+{
+	if (taille == 1) {
+		loeffler_idct_dc_signe(iqzz_dc(bloc, qtable, IDCT_PRESCALE_FLOAT), sortie);
+		return;
+	}
+
+	float valeurs[BLOCK_PIXELS] __attribute__((aligned(32)));
+	__m256 m[8];
+
+	loeffler_passes_avx2(bloc, qtable, eob, m);
+	for (uint8_t i = 0; i < 8; i++) _mm256_store_ps(&valeurs[8*i], m[i]);
+	for (uint8_t i = 0; i < BLOCK_PIXELS; i++) sortie[i] = idct_arrondi_signe(valeurs[i]);
+}
+
+//===============================================================================================
+// iDCT par lots : un bloc par voie
+
+/*
+* Fonction:  lot_sature_avx2
+* --------------------
+* x + 128 (facteur 8 porté par la table), saturation et arrondi au plus
+* proche (x >= 0) de 8 points d'un lot AVX2, rangés sur 8 bits
+*
+*  v      : point de chacun des 8 blocs
+*  octets : destination des 8 octets
+*
+*/
+__attribute__((target("avx2")))
+static inline void lot_sature_avx2(__m256 v, uint8_t *octets)
+{
+	v = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(v, _mm256_set1_ps(128.0f)), _mm256_setzero_ps()), _mm256_set1_ps(255.0f));
+	__m256i e = _mm256_cvttps_epi32(_mm256_add_ps(v, _mm256_set1_ps(0.5f)));
+	__m128i m = _mm_packs_epi32(_mm256_castsi256_si128(e), _mm256_extracti128_si256(e, 1));
+	_mm_storel_epi64((__m128i*)octets, _mm_packus_epi16(m, m));
+}
+
+/*
+* Fonction:  lot_redistribue
+* --------------------
+* transpose 8x8 octets : les lignes de [src] (8 points, un par bloc)
+* deviennent 8 points consécutifs de chacun des 8 blocs de [sorties]
+*
+*      src : première ligne (8 octets, un par bloc)
+*      pas : écart entre deux lignes de [src]
+*  sorties : 8 blocs de sortie
+*   indice : indice du premier des 8 points dans les blocs de sortie
+*
+*/
+static inline void lot_redistribue(const uint8_t *src, size_t pas, uint8_t **sorties, uint8_t indice)
+{
+	__m128i a[8], b[4], c[4], d[4];
+
+	for (uint8_t i = 0; i < 8; i++) a[i] = _mm_loadl_epi64((const __m128i*)&src[i*pas]);
+	for (uint8_t i = 0; i < 4; i++) b[i] = _mm_unpacklo_epi8(a[2*i], a[2*i + 1]);
+	c[0] = _mm_unpacklo_epi16(b[0], b[1]); c[1] = _mm_unpackhi_epi16(b[0], b[1]);
+	c[2] = _mm_unpacklo_epi16(b[2], b[3]); c[3] = _mm_unpackhi_epi16(b[2], b[3]);
+	d[0] = _mm_unpacklo_epi32(c[0], c[2]); d[1] = _mm_unpackhi_epi32(c[0], c[2]);
+	d[2] = _mm_unpacklo_epi32(c[1], c[3]); d[3] = _mm_unpackhi_epi32(c[1], c[3]);
+
+	/* d[i] : points des blocs 2i (moitié basse) et 2i+1 (moitié haute) */
+	for (uint8_t i = 0; i < 4; i++) {
+		_mm_storel_epi64((__m128i*)&sorties[2*i][indice], d[i]);
+		_mm_storel_epi64((__m128i*)&sorties[2*i + 1][indice], _mm_srli_si128(d[i], 8));
+	}
+}
+
+/*
+* Fonction:  lot_passes_avx2
+* --------------------
+* déquantification entrelacée et deux passes de l'iDCT de loeffler
+* de 8 blocs, un bloc par voie AVX2 : coeffs[8*k + j] reçoit le point k
+* du bloc j, centré sur 0
+*
+*    blocs : les 8 blocs de coefficients quantifiés, en ordre naturel
+*   qtable : table de quantification prémultipliée commune aux 8 blocs
+*     eobs : nombre de coefficients zig-zag à traiter de chaque bloc
+*   coeffs : tableau de travail (8*BLOCK_PIXELS flottants alignés)
+*
+*/
+__attribute__((target("avx2")))
+static inline void lot_passes_avx2(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, float *coeffs)
+{
+	__m256 v[8];
+
+	/* Déquantification entrelacée : coeffs[8*k + j] est le coefficient k du bloc j */
+	memset(coeffs, 0, 8*BLOCK_PIXELS*sizeof(float));
+	for (uint8_t j = 0; j < 8; j++) iqzz_float_voie(&coeffs[j], 8, blocs[j], qtable, eobs[j]);
+
+	// on passe sur chaque ligne (v[j] : point j de la ligne l de chaque bloc)
+	for (uint8_t l = 0; l < 8; l++) {
+		for (uint8_t j = 0; j < 8; j++) v[j] = _mm256_load_ps(&coeffs[8*(8*l + j)]);
+		loeffler_inv_avx2(v);
+		for (uint8_t j = 0; j < 8; j++) _mm256_store_ps(&coeffs[8*(8*l + j)], v[j]);
+	}
+
+	// on passe sur les colonnes (v[i] : point de la ligne i dans la colonne c de chaque bloc)
+	for (uint8_t c = 0; c < 8; c++) {
+		for (uint8_t i = 0; i < 8; i++) v[i] = _mm256_load_ps(&coeffs[8*(8*i + c)]);
+		loeffler_inv_avx2(v);
+		for (uint8_t i = 0; i < 8; i++) _mm256_store_ps(&coeffs[8*(8*i + c)], v[i]);
+	}
+}
+
+/*
+* Fonction:  loeffler_idct_lot_avx2
+* --------------------
+* iDCT de loeffler de 8 blocs 8x8 (quantification inverse comprise),
+* un bloc par voie AVX2. Mêmes opérations que loeffler_idct_avx2, bloc par bloc.
+*
+*    blocs : les 8 blocs de coefficients quantifiés, en ordre naturel
+*   qtable : table de quantification prémultipliée commune aux 8 blocs
+*     eobs : nombre de coefficients zig-zag à traiter de chaque bloc
+*  sorties : reçoit les 8 blocs de pixels (alloués)
+*
+*/
+__attribute__((target("avx2")))
+void loeffler_idct_lot_avx2(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, uint8_t **sorties)
+{
+	float coeffs[8*BLOCK_PIXELS] __attribute__((aligned(32)));
+	uint8_t octets[8*BLOCK_PIXELS];
+
+	lot_passes_avx2(blocs, qtable, eobs, coeffs);
+	for (uint8_t k = 0; k < BLOCK_PIXELS; k++) lot_sature_avx2(_mm256_load_ps(&coeffs[8*k]), &octets[8*k]);
+
+	/* Redistribution des octets entre les blocs, 8 points à la fois */
+	for (uint8_t j = 0; j < 8; j++) sorties[j] = malloc(BLOCK_PIXELS*sizeof(uint8_t));
+	for (uint8_t k = 0; k < BLOCK_PIXELS; k += 8) lot_redistribue(&octets[8*k], 8, sorties, k);
+}
+
+/*
+* Fonction:  loeffler_idct_lot_avx2_signe
+* --------------------
+* version signée de loeffler_idct_lot_avx2 (voir idct_lot_signe_fn)
+*
+*  sorties : 8 blocs recevant chacun 64 échantillons arrondis et bornés
+*
+*/
+__attribute__((target("avx2")))
+void loeffler_idct_lot_avx2_signe(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, int16_t **sorties)
+{
+	float coeffs[8*BLOCK_PIXELS] __attribute__((aligned(32)));
+
+	lot_passes_avx2(blocs, qtable, eobs, coeffs);
+	for (uint8_t k = 0; k < BLOCK_PIXELS; k++)
+	for (uint8_t j = 0; j < 8; j++) {
+		sorties[j][k] = idct_arrondi_signe(coeffs[8*k + j]);
+	}
+}
+
+//===============================================================================================
+// AVX-512 : 16 voies (lots de 16 blocs)
+
+/*
+* Fonction:  loeffler_inv_avx512
+* --------------------
+* iDCT 1D de loeffler sur 16 vecteurs de 8 points à la fois
+* (v[i] contient le point i de chacun des 16 vecteurs)
+*
+*  v : les 8 points, modifiés en place
+*
+*/
+__attribute__((target("avx512f")))
+static inline void loeffler_inv_avx512(__m512 v[8])
+{
+	const __m512 demi = _mm512_set1_ps(0.5f), racine = _mm512_set1_ps(RACINE);
+	__m512 n[8], t[8];
+
+	// etape 4
+	n[7] = _mm512_mul_ps(_mm512_add_ps(v[1], v[7]), demi);
+	n[4] = _mm512_mul_ps(_mm512_sub_ps(v[1], v[7]), demi);
+	n[6] = _mm512_div_ps(v[5], racine);
+	n[5] = _mm512_div_ps(v[3], racine);
+	n[3] = v[6]; n[2] = v[2]; n[1] = v[4]; n[0] = v[0];
+
+	// etape 3
+	t[0] = _mm512_mul_ps(_mm512_add_ps(n[0], n[1]), demi);
+	t[1] = _mm512_mul_ps(_mm512_sub_ps(n[0], n[1]), demi);
+	t[2] = _mm512_div_ps(_mm512_sub_ps(_mm512_mul_ps(n[2], _mm512_set1_ps(COS_6)), _mm512_mul_ps(n[3], _mm512_set1_ps(COS_2))), racine);
+	t[3] = _mm512_div_ps(_mm512_add_ps(_mm512_mul_ps(n[3], _mm512_set1_ps(COS_6)), _mm512_mul_ps(n[2], _mm512_set1_ps(COS_2))), racine);
+	t[4] = _mm512_mul_ps(_mm512_add_ps(n[4], n[6]), demi);
+	t[6] = _mm512_mul_ps(_mm512_sub_ps(n[4], n[6]), demi);
+	t[7] = _mm512_mul_ps(_mm512_add_ps(n[7], n[5]), demi);
+	t[5] = _mm512_mul_ps(_mm512_sub_ps(n[7], n[5]), demi);
+
+	// etape 2
+	n[0] = _mm512_mul_ps(_mm512_add_ps(t[0], t[3]), demi);
+	n[3] = _mm512_mul_ps(_mm512_sub_ps(t[0], t[3]), demi);
+	n[1] = _mm512_mul_ps(_mm512_add_ps(t[1], t[2]), demi);
+	n[2] = _mm512_mul_ps(_mm512_sub_ps(t[1], t[2]), demi);
+	n[4] = _mm512_sub_ps(_mm512_mul_ps(t[4], _mm512_set1_ps(COS_3)), _mm512_mul_ps(t[7], _mm512_set1_ps(COS_5)));
+	n[7] = _mm512_add_ps(_mm512_mul_ps(t[7], _mm512_set1_ps(COS_3)), _mm512_mul_ps(t[4], _mm512_set1_ps(COS_5)));
+	n[5] = _mm512_sub_ps(_mm512_mul_ps(t[5], _mm512_set1_ps(COS_1)), _mm512_mul_ps(t[6], _mm512_set1_ps(COS_7)));
+	n[6] = _mm512_add_ps(_mm512_mul_ps(t[6], _mm512_set1_ps(COS_1)), _mm512_mul_ps(t[5], _mm512_set1_ps(COS_7)));
+
+	// etape 1
+	v[0] = _mm512_mul_ps(_mm512_add_ps(n[0], n[7]), demi);
+	v[7] = _mm512_mul_ps(_mm512_sub_ps(n[0], n[7]), demi);
+	v[1] = _mm512_mul_ps(_mm512_add_ps(n[1], n[6]), demi);
+	v[6] = _mm512_mul_ps(_mm512_sub_ps(n[1], n[6]), demi);
+	v[2] = _mm512_mul_ps(_mm512_add_ps(n[2], n[5]), demi);
+	v[5] = _mm512_mul_ps(_mm512_sub_ps(n[2], n[5]), demi);
+	v[3] = _mm512_mul_ps(_mm512_add_ps(n[3], n[4]), demi);
+	v[4] = _mm512_mul_ps(_mm512_sub_ps(n[3], n[4]), demi);
+}
+
+/*
+* Fonction:  lot_passes_avx512
+* --------------------
+* déquantification entrelacée et deux passes de l'iDCT de loeffler
+* de 16 blocs, un bloc par voie AVX-512 : coeffs[16*k + j] reçoit le
+* point k du bloc j, centré sur 0
+*
+*    blocs : les 16 blocs de coefficients quantifiés, en ordre naturel
+*   qtable : table de quantification prémultipliée commune aux 16 blocs
+*     eobs : nombre de coefficients zig-zag à traiter de chaque bloc
+*   coeffs : tableau de travail (16*BLOCK_PIXELS flottants alignés)
+*
+*/
+__attribute__((target("avx512f")))
+static inline void lot_passes_avx512(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, float *coeffs)
+{
+	__m512 v[8];
+
+	/* Déquantification entrelacée : coeffs[16*k + j] est le coefficient k du bloc j */
+	memset(coeffs, 0, 16*BLOCK_PIXELS*sizeof(float));
+	for (uint8_t j = 0; j < 16; j++) iqzz_float_voie(&coeffs[j], 16, blocs[j], qtable, eobs[j]);
+
+	// on passe sur chaque ligne (v[j] : point j de la ligne l de chaque bloc)
+	for (uint8_t l = 0; l < 8; l++) {
+		for (uint8_t j = 0; j < 8; j++) v[j] = _mm512_load_ps(&coeffs[16*(8*l + j)]);
+		loeffler_inv_avx512(v);
+		for (uint8_t j = 0; j < 8; j++) _mm512_store_ps(&coeffs[16*(8*l + j)], v[j]);
+	}
+
+	// on passe sur les colonnes
+	for (uint8_t c = 0; c < 8; c++) {
+		for (uint8_t i = 0; i < 8; i++) v[i] = _mm512_load_ps(&coeffs[16*(8*i + c)]);
+		loeffler_inv_avx512(v);
+		for (uint8_t i = 0; i < 8; i++) _mm512_store_ps(&coeffs[16*(8*i + c)], v[i]);
+	}
+}
+
+/*
+* Fonction:  loeffler_idct_lot_avx512
+* --------------------
+* iDCT de loeffler de 16 blocs 8x8 (quantification inverse comprise),
+* un bloc par voie AVX-512. Mêmes opérations que loeffler_idct_avx2, bloc par bloc.
+*
+*    blocs : les 16 blocs de coefficients quantifiés, en ordre naturel
+*   qtable : table de quantification prémultipliée commune aux 16 blocs
+*     eobs : nombre de coefficients zig-zag à traiter de chaque bloc
+*  sorties : reçoit les 16 blocs de pixels (alloués)
+*
+*/
+__attribute__((target("avx512f")))
+void loeffler_idct_lot_avx512(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, uint8_t **sorties)
+{
+	float coeffs[16*BLOCK_PIXELS] __attribute__((aligned(64)));
+	uint8_t octets[16*BLOCK_PIXELS];
+
+	lot_passes_avx512(blocs, qtable, eobs, coeffs);
+
+	/* x + 128, saturation, arrondi et passage sur 8 bits */
+	const __m512 decalage = _mm512_set1_ps(128.0f),
+	             zero = _mm512_setzero_ps(), max = _mm512_set1_ps(255.0f), demi = _mm512_set1_ps(0.5f);
+	for (uint8_t k = 0; k < BLOCK_PIXELS; k++) {
+		__m512 x = _mm512_min_ps(_mm512_max_ps(_mm512_add_ps(_mm512_load_ps(&coeffs[16*k]), decalage), zero), max);
+		_mm_storeu_si128((__m128i*)&octets[16*k], _mm512_cvtepi32_epi8(_mm512_cvttps_epi32(_mm512_add_ps(x, demi))));
+	}
+
+	/* Redistribution des octets entre les blocs, par moitiés de 8 blocs */
+	for (uint8_t j = 0; j < 16; j++) sorties[j] = malloc(BLOCK_PIXELS*sizeof(uint8_t));
+	for (uint8_t k = 0; k < BLOCK_PIXELS; k += 8) {
+		lot_redistribue(&octets[16*k],     16, sorties,     k);
+		lot_redistribue(&octets[16*k + 8], 16, sorties + 8, k);
+	}
+}
+
+/*
+* Fonction:  loeffler_idct_lot_avx512_signe
+* --------------------
+* version signée de loeffler_idct_lot_avx512 (voir idct_lot_signe_fn)
+*
+*  sorties : 16 blocs recevant chacun 64 échantillons arrondis et bornés
+*
+*/
+__attribute__((target("avx512f")))
+void loeffler_idct_lot_avx512_signe(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, int16_t **sorties)
+{
+	float coeffs[16*BLOCK_PIXELS] __attribute__((aligned(64)));
+
+	lot_passes_avx512(blocs, qtable, eobs, coeffs);
+	for (uint8_t k = 0; k < BLOCK_PIXELS; k++)
+	for (uint8_t j = 0; j < 16; j++) {
+		sorties[j][k] = idct_arrondi_signe(coeffs[16*k + j]);
+	}
+}
+
+#else
+
+/* Architecture non x86 : les moteurs SIMD ne sont jamais sélectionnés */
+uint8_t *loeffler_idct_sse2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille)
+{
+	(void) bloc; (void) qtable; (void) eob; (void) taille;
+	EXIT_ERROR("loeffler_simd", "iDCT SSE2 indisponible sur cette architecture");
+}
+
+uint8_t *loeffler_idct_avx2(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille)
+{
+	(void) bloc; (void) qtable; (void) eob; (void) taille;
+	EXIT_ERROR("loeffler_simd", "iDCT AVX2 indisponible sur cette architecture");
+}
+
+void loeffler_idct_sse2_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie)
+{
+	(void) bloc; (void) qtable; (void) eob; (void) taille; (void) sortie;
+	EXIT_ERROR("loeffler_simd", "iDCT SSE2 indisponible sur cette architecture");
+}
+
+void loeffler_idct_avx2_signe(const int16_t *bloc, const int32_t *qtable, uint8_t eob, uint8_t taille, int16_t *sortie)
+{
+	(void) bloc; (void) qtable; (void) eob; (void) taille; (void) sortie;
+	EXIT_ERROR("loeffler_simd", "iDCT AVX2 indisponible sur cette architecture");
+}
+
+void loeffler_idct_lot_avx2(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, uint8_t **sorties)
+{
+	(void) blocs; (void) qtable; (void) eobs; (void) sorties;
+	EXIT_ERROR("loeffler_simd", "iDCT par lots AVX2 indisponible sur cette architecture");
+}
+
+void loeffler_idct_lot_avx512(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, uint8_t **sorties)
+{
+	(void) blocs; (void) qtable; (void) eobs; (void) sorties;
+	EXIT_ERROR("loeffler_simd", "iDCT par lots AVX-512 indisponible sur cette architecture");
+}
+
+void loeffler_idct_lot_avx2_signe(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, int16_t **sorties)
+{
+	(void) blocs; (void) qtable; (void) eobs; (void) sorties;
+	EXIT_ERROR("loeffler_simd", "iDCT par lots AVX2 indisponible sur cette architecture");
+}
+
+void loeffler_idct_lot_avx512_signe(const int16_t *const *blocs, const int32_t *qtable, const uint8_t *eobs, int16_t **sorties)
+{
+	(void) blocs; (void) qtable; (void) eobs; (void) sorties;
+	EXIT_ERROR("loeffler_simd", "iDCT par lots AVX-512 indisponible sur cette architecture");
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <pthread.h>
 
 #include "process.h"
@@ -8,17 +9,124 @@
 #include "jpeg_reader.h"
 #include "extract_image.h"
 #include "iqzz.h"
-#include "loeffler.h"
+#include "idct.h"
+#include "idct_scaled.h"
+#include "idct_cache.h"
+#include "cpu_dispatch.h"
 
 #define NTHREADS 1
 
 /* Blocs swap */
-// -> Loeffler
-static float loeffler_swp[BLOCK_PIXELS];
-static float loeffler_swp_th[NTHREADS][BLOCK_PIXELS];
-// -> Zig-zag
-int16_t zz_swp[64];
-int16_t zz_swp_th[NTHREADS][64];
+// -> Quantification inverse (affichage blabla)
+static int16_t blabla_swp[BLOCK_PIXELS];
+// -> Stockage compact
+static int16_t store_swp[BLOCK_PIXELS];
+static int16_t store_swp_th[NTHREADS][BLOCK_PIXELS];
+
+// -> Compteurs des chemins d'iDCT
+static size_t idct_count[IDCT_NB_PATHS];
+static size_t idct_count_th[NTHREADS][IDCT_NB_PATHS];
+
+// -> Caches des sorties d'iDCT (option -cache, NULL sinon)
+static idct_cache_t* idct_cache;
+static idct_cache_t* idct_cache_th[NTHREADS];
+
+/* Lot de blocs consécutifs d'une composante en attente d'iDCT par lots */
+typedef struct
+{
+    uint8_t        nb;                                // Nombre de blocs en attente
+    const int16_t* blocs[IDCT_LOT_MAX];               // Blocs 16 bits
+    uint8_t        eobs[IDCT_LOT_MAX];                // Coefficients zig-zag utiles
+    uint8_t**      dest[IDCT_LOT_MAX];                // Emplacements des blocs décodés
+    int16_t        swap[IDCT_LOT_MAX][BLOCK_PIXELS];  // Blocs développés (stockage compact)
+} idct_lot_t;
+
+static idct_lot_t idct_lot;
+static idct_lot_t idct_lot_th[NTHREADS];
+
+/*
+ * Fonction:  idct_bloc
+ * --------------------
+ * applique l'iDCT retenue au démarrage (option -idct= et niveau de jeu
+ * d'instructions, voir cpu_dispatch.c) à un bloc, quantification
+ * inverse comprise, en choisissant le chemin réduit adapté à ses
+ * coefficients non nuls. En décodage réduit (option -scale=), le bloc
+ * de sortie fait BLOCK_SIZE/P_SCALE pixels de côté.
+ * Avec un cache (option -cache), un bloc déjà transformé est recopié
+ * (sauf les blocs DC seul, plus rapides à recalculer qu'à chercher).
+ * 
+ *  bloc   : bloc 16 bits quantifié en ordre naturel (non modifié)
+ *  qtable : table de quantification prémultipliée pour l'iDCT
+ *  info   : métadonnées de parcimonie du bloc
+ *  count  : compteurs des chemins d'iDCT empruntés
+ *  cache  : cache des sorties d'iDCT (NULL si désactivé)
+ */
+static uint8_t* idct_bloc(const int16_t* bloc, const int32_t* qtable, const bloc_info_t* info, size_t* count, idct_cache_t* cache)
+{
+    enum idct_path path = idct_path(info->mask);
+    count[path]++;
+
+    size_t   nb_pixels = BLOCK_PIXELS/(P_SCALE*P_SCALE);
+    bool     en_cache = (cache != NULL && path != IDCT_PATH_DC);
+    uint8_t* pixels = en_cache ? idct_cache_get(cache, bloc, qtable, nb_pixels) : NULL;
+    if (pixels != NULL) return pixels;
+
+    if (P_SCALE > 1)
+        pixels = idct_scaled(bloc, qtable, BLOCK_SIZE/P_SCALE, path == IDCT_PATH_DC);
+    else
+        pixels = KERNELS.idct(bloc, qtable, info->eob, IDCT_PATH_SIZE[path]);
+
+    if (en_cache) idct_cache_put(cache, bloc, qtable, pixels, nb_pixels);
+    return pixels;
+}
+
+/*
+ * Fonction:  print_idct_paths
+ * --------------------
+ * affiche (mode verbose) le nombre de blocs passés par chaque chemin d'iDCT.
+ * 
+ *  count : compteurs des chemins d'iDCT
+ */
+static void print_idct_paths(const size_t* count)
+{
+    INFO_MSG("* iDCT : %zu blocs DC, %zu 2x2, %zu 4x4, %zu complets\n",
+             count[IDCT_PATH_DC], count[IDCT_PATH_2x2], count[IDCT_PATH_4x4], count[IDCT_PATH_FULL]);
+}
+
+/*
+ * Fonction:  print_idct_cache
+ * --------------------
+ * affiche (mode verbose) le taux de succès du cache d'iDCT.
+ * 
+ *  acces  : nombre de blocs cherchés dans le cache
+ *  succes : nombre de blocs trouvés
+ */
+static void print_idct_cache(size_t acces, size_t succes)
+{
+    INFO_MSG("* Cache iDCT : %zu blocs trouvés sur %zu cherchés (%.1f %%)\n",
+             succes, acces, (acces > 0) ? 100.0*succes/acces : 0.0);
+}
+
+/*
+ * Fonction:  zip_bloc
+ * --------------------
+ * renvoie le bloc 16 bits dense d'index [index], développé
+ * dans [swap] si la composante est en stockage compact.
+ * 
+ *  blocs : blocs denses de la composante
+ *  store : stockage compact de la composante (NULL si dense)
+ *  info  : métadonnées de parcimonie du bloc
+ *  index : index raster du bloc
+ *  swap  : bloc de travail
+ */
+static int16_t* zip_bloc(int16_t** blocs, const coeff_store_t* store, const bloc_info_t* info, size_t index, int16_t* swap)
+{
+    if (store == NULL) return blocs[index];
+
+    memset(swap, 0, sizeof(int16_t)*BLOCK_PIXELS);
+    expand_bloc(store, index, info->mask, swap);
+    return swap;
+}
 
 
 /*
@@ -30,9 +138,9 @@ int16_t zz_swp_th[NTHREADS][64];
  *  jdesc     : descripteur JPEG du fichier ouvert
  *  zip_image : image à décompresser
  *
- * Remarque : On ne peut pas faire blabla ET redécompresser ensuite,
- * puisque que iDCT libère les blocs passés sur 16 bits qu'on lui passe.
- * Le programme est donc terminé après exécution de la méthode.
+ * Remarque : les étapes intermédiaires sont affichées à partir d'une copie
+ * du bloc, l'iDCT les refaisant au chargement. Le programme est terminé
+ * après exécution de la méthode.
  */
 void jpeg_blabla(struct jpeg_desc *jdesc, image16_t *zip_image)
 {
@@ -41,53 +149,63 @@ void jpeg_blabla(struct jpeg_desc *jdesc, image16_t *zip_image)
     int16_t**  channels[3] = {zip_image->y_blocs, 
                               zip_image->cb_blocs,
                               zip_image->cr_blocs};
+    bloc_info_t* infos[3] = {zip_image->y_infos,
+                             zip_image->cb_infos,
+                             zip_image->cr_infos};
+    coeff_store_t* stores[3] = {zip_image->y_store,
+                                zip_image->cb_store,
+                                zip_image->cr_store};
+    size_t     nb_pixels = BLOCK_PIXELS/(P_SCALE*P_SCALE); // Pixels d'un bloc décodé (option -scale=)
+    size_t     nb_channels = (zip_image->cb_infos != NULL) ? 3 : 1; // Chrominances non stockées avec -luma
 
     /* Affichage type JPEGBlabla du traitement des blocs d'une composante */
     for (size_t j=0; j<zip_image->num_blocs; j++) {
         printf("**************************************************************\n");
         printf("*** mcu %zu\n", j);
-        for (size_t channel_index=0; channel_index<3; channel_index++) {
-            int16_t* bloc = channels[channel_index][j];
+        for (size_t channel_index=0; channel_index<nb_channels; channel_index++) {
+            int16_t* bloc = zip_bloc(channels[channel_index], stores[channel_index], &infos[channel_index][j], j, store_swp);
+            uint8_t  eob  = infos[channel_index][j].eob;
             printf("** component %s\n", component[channel_index]);
             printf("* bloc 0\n");
 
-            /* Affichage du contenu du bloc */
+            /* Affichage du contenu du bloc (dans l'ordre zig-zag du flux) */
             printf("[  bloc] ");
             for (size_t i=0; i<BLOCK_PIXELS; i++) {
-                printf("%hx ", bloc[i]);
+                printf("%hx ", bloc[EQUIV_ZZ[i]]);
             }
             printf("\n");
 
-            /* Affichage du bloc après inverse quantification */
+            /* Affichage du bloc après inverse quantification (sur une copie :
+               l'iDCT refait ces étapes au chargement du bloc) */
             // On suppose que channel index vaut toujours 0 ou 1
-            quantification_inverse(jdesc, bloc, (channel_index > 0));
+            int16_t* iq_bloc = memcpy(blabla_swp, bloc, sizeof(int16_t)*BLOCK_PIXELS);
+            quantification_inverse(jdesc, iq_bloc, (channel_index > 0), eob);
 
             printf("[iquant] ");
             for (size_t i=0; i<BLOCK_PIXELS; i++) {
-                printf("%hx ", bloc[i]);
+                printf("%hx ", iq_bloc[EQUIV_ZZ[i]]);
             }
             printf("\n");
 
-            /* Affichage du bloc après zig-zag inverse */
-            int16_t* new_bloc = zig_zag(zz_swp, bloc);
-
+            /* Affichage du bloc après zig-zag inverse : les coefficients
+               sont déjà rangés en ordre naturel par le décodage entropique */
             printf("[   izz] ");
             for (size_t i=0; i<BLOCK_PIXELS; i++) {
-                printf("%hx ", new_bloc[i]);
+                printf("%hx ", iq_bloc[i]);
             }
             printf("\n");
 
             /* Affichage du bloc après iDCT */
-            blocs_8bits[j] = loeffler_idct_loeffler(loeffler_swp, new_bloc);
+            blocs_8bits[j] = idct_bloc(bloc, get_idct_quantization_table(jdesc, (channel_index > 0)), &infos[channel_index][j], idct_count, NULL);
 
             printf("[  idct] ");
-            for (size_t i=0; i<BLOCK_PIXELS; i++) {
+            for (size_t i=0; i<nb_pixels; i++) {
                 printf("%hhx ", blocs_8bits[j][i]);
             }
             printf("\n");
             printf("* component mcu\n");
             printf("[   mcu] ");
-            for (size_t i=0; i<BLOCK_PIXELS; i++) {
+            for (size_t i=0; i<nb_pixels; i++) {
                 printf("%hhx ", blocs_8bits[j][i]);
             }
             printf("\n");
@@ -104,45 +222,84 @@ void jpeg_blabla(struct jpeg_desc *jdesc, image16_t *zip_image)
 }
 
 /*
- * Fonction:  unzip_bloc 
+ * Fonction:  idct_lot_vide
  * --------------------
- * décompresse un bloc avec pixels sur 16 bits signés
- * vers un un bloc avec pixels sur 8 bits non signés.
+ * transforme les blocs en attente dans un lot : d'un seul appel s'il est
+ * complet, un par un sinon (fin d'une suite de blocs).
  * 
- *  jdesc     : descripteur JPEG du fichier ouvert
- *  zip_bloc  : bloc JPEG à décoder
- *  dest_bloc : bloc JPEG décodé
- *  comp      : enuméré représentant le type de bloc
- *                  | 0 : Y
- *                  | 1 : Cb
- *                  | 2 : Cr
+ *  lot    : lot de blocs en attente, vidé
+ *  qtable : table de quantification prémultipliée commune aux blocs
  */
-static void unzip_bloc(struct jpeg_desc *jdesc, int16_t** zip_bloc, uint8_t** dest_bloc, enum component comp)
+static void idct_lot_vide(idct_lot_t* lot, const int32_t* qtable)
 {
-    int16_t* bloc = *zip_bloc;
-
-    /* Quantification inverse */
-    quantification_inverse(jdesc, bloc, (comp > 0));
-
-    /* Zig-zag inverse */    
-    bloc = zig_zag(zz_swp, bloc);
-
-    /* DCT inverse */
-    *dest_bloc = loeffler_idct_loeffler(loeffler_swp, bloc);
+    if (lot->nb == KERNELS.voies) {
+        uint8_t* sorties[IDCT_LOT_MAX];
+        KERNELS.idct_lot(lot->blocs, qtable, lot->eobs, sorties);
+        for (uint8_t i=0; i<lot->nb; i++) *lot->dest[i] = sorties[i];
+    } else {
+        for (uint8_t i=0; i<lot->nb; i++)
+            *lot->dest[i] = KERNELS.idct(lot->blocs[i], qtable, lot->eobs[i], BLOCK_SIZE);
+    }
+    lot->nb = 0;
 }
-// Version multi-threads
-static void unzip_bloc_th(struct jpeg_desc *jdesc, int16_t** zip_bloc, uint8_t** dest_bloc, enum component comp, uint8_t thread_id)
-{
-    int16_t* bloc = *zip_bloc;
-
-    /* Quantification inverse */
-    quantification_inverse(jdesc, bloc, (comp > 0));
-
-    /* Zig-zag inverse */
-    bloc = zig_zag(zz_swp_th[thread_id], bloc);
 
-    /* DCT inverse */
-    *dest_bloc = loeffler_idct_loeffler(loeffler_swp_th[thread_id], bloc);
+/*
+ * Fonction:  unzip_blocs 
+ * --------------------
+ * décompresse une suite de blocs consécutifs d'une composante, avec
+ * pixels sur 16 bits signés, vers des blocs avec pixels sur 8 bits non
+ * signés. Quand l'iDCT par lots est disponible (voir cpu_dispatch.c) et
+ * sans cache, les blocs qui ne sont pas DC seul sont regroupés par lots
+ * de KERNELS.voies blocs, un bloc par voie SIMD.
+ * Seuls les blocs dont les coefficients ont changé depuis leur dernière
+ * transformation sont traités (tous au premier appel) : en décodage
+ * progressif, l'image 8 bits est mise à jour en place après chaque scan
+ * (option -p), l'ancienne version d'un bloc refait étant libérée.
+ * 
+ *  jdesc : descripteur JPEG du fichier ouvert
+ *  zip   : image 16 bits compressée
+ *  unzip : image 8 bits décompressée
+ *  comp  : enuméré représentant le type de bloc
+ *              | 0 : Y
+ *              | 1 : Cb
+ *              | 2 : Cr
+ *  debut : index raster du premier bloc
+ *  fin   : index raster suivant le dernier bloc
+ *  count : compteurs des chemins d'iDCT empruntés
+ *  cache : cache des sorties d'iDCT (NULL si désactivé)
+ *  swap  : bloc de travail (stockage compact)
+ *  lot   : lot de blocs en attente
+ */
+static void unzip_blocs(struct jpeg_desc *jdesc, image16_t* zip, image8_t* unzip, enum component comp,
+                        size_t debut, size_t fin, size_t* count, idct_cache_t* cache, int16_t* swap, idct_lot_t* lot)
+{
+    int16_t**            blocs  = (comp == COMP_Y) ? zip->y_blocs  : ((comp == COMP_Cb) ? zip->cb_blocs  : zip->cr_blocs);
+    const coeff_store_t* store  = (comp == COMP_Y) ? zip->y_store  : ((comp == COMP_Cb) ? zip->cb_store  : zip->cr_store);
+    bloc_info_t*         infos  = (comp == COMP_Y) ? zip->y_infos  : ((comp == COMP_Cb) ? zip->cb_infos  : zip->cr_infos);
+    uint8_t**            dest   = (comp == COMP_Y) ? unzip->y_blocs : ((comp == COMP_Cb) ? unzip->cb_blocs : unzip->cr_blocs);
+    const int32_t*       qtable = get_idct_quantization_table(jdesc, (comp > 0));
+    bool                 par_lot = (KERNELS.idct_lot != NULL && cache == NULL);
+
+    for (size_t j=debut; j<fin; j++) {
+        if (infos[j].a_jour) continue;
+        infos[j].a_jour = true;
+
+        uint8_t** dest_bloc = &dest[mcu_order_index(jdesc, comp, j)];
+        enum idct_path path = idct_path(infos[j].mask);
+        free(*dest_bloc);
+
+        /* Quantification inverse et DCT inverse en une passe, par lots hors blocs DC seul */
+        if (par_lot && path != IDCT_PATH_DC) {
+            count[path]++;
+            lot->blocs[lot->nb] = zip_bloc(blocs, store, &infos[j], j, lot->swap[lot->nb]);
+            lot->eobs[lot->nb]  = infos[j].eob;
+            lot->dest[lot->nb]  = dest_bloc;
+            if (++lot->nb == KERNELS.voies) idct_lot_vide(lot, qtable);
+        } else {
+            *dest_bloc = idct_bloc(zip_bloc(blocs, store, &infos[j], j, swap), qtable, &infos[j], count, cache);
+        }
+    }
+    idct_lot_vide(lot, qtable);
 }
 
 /*
@@ -157,16 +314,22 @@ static void unzip_bloc_th(struct jpeg_desc *jdesc, int16_t** zip_bloc, uint8_t**
  */
 void unzip_image(struct jpeg_desc *jdesc, image16_t* zip, image8_t* unzip)
 {
+    memset(idct_count, 0, sizeof(idct_count));
+    idct_cache = P_CACHE ? create_idct_cache() : NULL;
     // -> Y
-    for (size_t j=0; j<zip->num_blocs; j++)
-        unzip_bloc(jdesc, &zip->y_blocs[j],  &unzip->y_blocs[j],  COMP_Y);
-    if (zip->color) {
+    unzip_blocs(jdesc, zip, unzip, COMP_Y, 0, zip->num_blocs, idct_count, idct_cache, store_swp, &idct_lot);
+    if (unzip->cb_blocs != NULL) {
         // -> Cb
-        for (size_t j=0; j<zip->num_blocs_Cb; j++)
-            unzip_bloc(jdesc, &zip->cb_blocs[j], &unzip->cb_blocs[j], COMP_Cb);
+        unzip_blocs(jdesc, zip, unzip, COMP_Cb, 0, zip->num_blocs_Cb, idct_count, idct_cache, store_swp, &idct_lot);
         // -> Cr
-        for (size_t j=0; j<zip->num_blocs_Cr; j++)
-            unzip_bloc(jdesc, &zip->cr_blocs[j], &unzip->cr_blocs[j], COMP_Cr);
+        unzip_blocs(jdesc, zip, unzip, COMP_Cr, 0, zip->num_blocs_Cr, idct_count, idct_cache, store_swp, &idct_lot);
+    }
+    print_idct_paths(idct_count);
+
+    if (idct_cache != NULL) {
+        print_idct_cache(idct_cache->acces, idct_cache->succes);
+        free_idct_cache(idct_cache);
+        idct_cache = NULL;
     }
 }
 
@@ -181,16 +344,17 @@ void unzip_image(struct jpeg_desc *jdesc, image16_t* zip, image8_t* unzip)
 static void* unzip_multithread(void* param)
 {
     work_thread* th = (work_thread*)param;
+    uint8_t id = th->thread_id;
     // -> Y
-    for (size_t j=th->work_range[0][0]; j<=th->work_range[0][1]; j++)
-        unzip_bloc_th(th->jdesc, &th->zip->y_blocs[j], &th->unzip->y_blocs[j], COMP_Y, th->thread_id);
-    if (th->zip->color) {
+    unzip_blocs(th->jdesc, th->zip, th->unzip, COMP_Y, th->work_range[0][0], th->work_range[0][1]+1,
+                idct_count_th[id], idct_cache_th[id], store_swp_th[id], &idct_lot_th[id]);
+    if (th->unzip->cb_blocs != NULL) {
         // -> Cb
-        for (size_t j=th->work_range[1][0]; j<=th->work_range[1][1]; j++)
-            unzip_bloc_th(th->jdesc, &th->zip->cb_blocs[j], &th->unzip->cb_blocs[j], COMP_Cb, th->thread_id);
+        unzip_blocs(th->jdesc, th->zip, th->unzip, COMP_Cb, th->work_range[1][0], th->work_range[1][1]+1,
+                    idct_count_th[id], idct_cache_th[id], store_swp_th[id], &idct_lot_th[id]);
         // -> Cr
-        for (size_t j=th->work_range[2][0]; j<=th->work_range[2][1]; j++)
-            unzip_bloc_th(th->jdesc, &th->zip->cr_blocs[j], &th->unzip->cr_blocs[j], COMP_Cr, th->thread_id);
+        unzip_blocs(th->jdesc, th->zip, th->unzip, COMP_Cr, th->work_range[2][0], th->work_range[2][1]+1,
+                    idct_count_th[id], idct_cache_th[id], store_swp_th[id], &idct_lot_th[id]);
     }
 
     return NULL;
@@ -204,17 +368,20 @@ static void* unzip_multithread(void* param)
  * 
  *  threads : descripteur JPEG
  *  zip     : image 16 bits compressée
+ *  unzip   : image 8 bits décompressée
  * 
  */
-static bool split_jobs(work_thread* threads, image16_t* zip)
+static bool split_jobs(work_thread* threads, image16_t* zip, image8_t* unzip)
 {
-    uint32_t num_blocs[3] = {zip->num_blocs, zip->num_blocs_Cb, zip->num_blocs_Cr};
+    uint32_t num_blocs[3] = {zip->num_blocs, unzip->num_blocs_Cb, unzip->num_blocs_Cr};
     uint32_t steps[3] = {num_blocs[0]/NTHREADS, 
                          num_blocs[1]/NTHREADS,
                          num_blocs[2]/NTHREADS},
              start[3] = {0, 0, 0};
 
-    for (size_t i=0; i<3; i++) if (num_blocs[i]<NTHREADS*2) {
+    /* Composantes transformées : luminance seule en niveaux de gris ou avec -luma */
+    size_t nb_comp = (unzip->cb_blocs != NULL) ? 3 : 1;
+    for (size_t i=0; i<nb_comp; i++) if (num_blocs[i]<NTHREADS*2) {
         return false;
     }
 
@@ -250,19 +417,21 @@ void unzip_parallel(struct jpeg_desc *jdesc, image16_t* zip, image8_t* unzip)
     work_thread threads[NTHREADS];
 
     /* Parallélisation inutile -> unzip normal */
-    if (!split_jobs(threads, zip)) {        
+    if (!split_jobs(threads, zip, unzip)) {        
         INFO_MSG("Parallélisation inutile - méthode de décompression classique utilisée.");
         unzip_image(jdesc, zip, unzip);
         return;
     }
 
     /* Démarrage des threads */
+    memset(idct_count_th, 0, sizeof(idct_count_th));
     for (size_t i=0; i<NTHREADS; i++) {
         // Initialisation de la structure
         threads[i].jdesc     = jdesc;
         threads[i].zip       = zip;
         threads[i].unzip     = unzip;
         threads[i].thread_id = i;
+        idct_cache_th[i]     = P_CACHE ? create_idct_cache() : NULL;
 
         pthread_create(&threads[i].thread, NULL, unzip_multithread, (void*)&threads[i]);
     }
@@ -271,4 +440,23 @@ void unzip_parallel(struct jpeg_desc *jdesc, image16_t* zip, image8_t* unzip)
     for (size_t i=0; i<NTHREADS; i++) {
         pthread_join(threads[i].thread, NULL);
     }
+
+    /* Cumul des chemins d'iDCT de chaque thread */
+    size_t count[IDCT_NB_PATHS] = {0};
+    for (size_t i=0; i<NTHREADS; i++)
+    for (size_t p=0; p<IDCT_NB_PATHS; p++) {
+        count[p] += idct_count_th[i][p];
+    }
+    print_idct_paths(count);
+
+    if (P_CACHE) {
+        size_t acces = 0, succes = 0;
+        for (size_t i=0; i<NTHREADS; i++) {
+            acces  += idct_cache_th[i]->acces;
+            succes += idct_cache_th[i]->succes;
+            free_idct_cache(idct_cache_th[i]);
+            idct_cache_th[i] = NULL;
+        }
+        print_idct_cache(acces, succes);
+    }
 }
@@ -0,0 +1,245 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "scan_graph.h"
+#include "extract_bloc.h"
+#include "jpeg_const.h"
+#include "jpeg_reader.h"
+#include "bitstream.h"
+
+
+/*
+    Décodage parallèle des scans d'une image progressive (option -m) :
+    les scans sont d'abord repérés dans le flux sans être décodés (section SOS
+    lue, données codées passées jusqu'au marqueur suivant). Un scan dépend d'un
+    scan précédent s'ils parcourent une même composante sur des bandes spectrales
+    [Ss, Se] qui se recouvrent : les raffinements (Ah > 0) d'une bande attendent
+    son premier passage, alors que les bandes disjointes, ou les composantes
+    différentes, sont décodées en même temps.
+
+    Chaque scan est décodé sur une copie du descripteur prise à sa section SOS
+    (paramètres et tables de Huffman en vigueur) avec son propre flux ouvert à la
+    position de ses données. Deux scans indépendants pouvant écrire dans un même
+    bloc, les métadonnées de parcimonie ne sont pas tenues à jour pendant le
+    décodage mais recalculées une fois tous les scans terminés.
+*/
+
+/* Nombre maximal de threads décodant des scans en parallèle */
+#define SCANS_THREADS_MAX 8
+
+/* Scan progressif repéré dans le flux */
+typedef struct
+{
+    struct jpeg_desc desc;          // Descripteur à la lecture de la section SOS du scan
+    long             debut;         // Position des données codées dans le fichier
+    uint8_t          composantes;   // Composantes parcourues (bit i <-> composante i)
+    size_t           attentes;      // Nombre de scans précédents dont il attend la fin
+    bool             lance;         // Scan pris en charge par un thread
+} scan_t;
+
+/* Graphe de dépendances des scans, partagé par les threads */
+typedef struct
+{
+    scan_t*          scans;
+    size_t           nb_scans;
+    bool*            depend;        // depend[j*nb_scans + i] : le scan j attend le scan i (i < j)
+    image16_t*       image;         // Image à décoder, sans métadonnées de parcimonie
+    size_t           termines;      // Nombre de scans décodés
+    pthread_mutex_t  verrou;
+    pthread_cond_t   prets;         // Signalé à la fin de chaque scan
+} graphe_t;
+
+
+/*
+ * Fonction:  repere_scans
+ * --------------------
+ * parcourt tous les scans du flux, à partir du premier (dont
+ * la section SOS vient d'être lue), sans décoder leurs données :
+ * chaque scan conserve une copie du descripteur et la position
+ * de ses données. Le flux est laissé après le marqueur EOI.
+ *
+ *  jdesc  : descripteur JPEG du fichier ouvert
+ *  graphe : graphe dont les scans sont à remplir
+ *
+ */
+static void repere_scans(struct jpeg_desc *jdesc, graphe_t* graphe)
+{
+    size_t capacite = 16;
+    graphe->scans    = malloc(capacite*sizeof(scan_t));
+    graphe->nb_scans = 0;
+
+    do {
+        if (graphe->nb_scans == capacite) {
+            capacite *= 2;
+            graphe->scans = realloc(graphe->scans, capacite*sizeof(scan_t));
+        }
+        scan_t* scan = &graphe->scans[graphe->nb_scans++];
+
+        scan->desc        = *jdesc;
+        scan->debut       = tell_bitstream(jdesc->bitstream);
+        scan->composantes = 0;
+        for (size_t w=0; w<jdesc->scan_nb_comp; w++)
+            scan->composantes |= 1 << jdesc->ordre_composants[w];
+        scan->attentes = 0;
+        scan->lance    = false;
+
+        skip_entropy_data(jdesc->bitstream);
+    } while (next_progressive_scan(jdesc));
+}
+
+/*
+ * Fonction:  construit_dependances
+ * --------------------
+ * relie chaque scan aux scans précédents qui parcourent une de
+ * ses composantes sur une bande spectrale qui recouvre la sienne.
+ *
+ *  graphe : graphe dont les scans sont repérés
+ *
+ */
+static void construit_dependances(graphe_t* graphe)
+{
+    size_t n = graphe->nb_scans;
+    graphe->depend = calloc(n*n, sizeof(bool));
+
+    for (size_t j=0; j<n; j++) {
+        struct jpeg_desc* dj = &graphe->scans[j].desc;
+
+        INFO_MSG("* Scan %zu : composantes 0x%x, bande [%u, %u], Ah %u, Al %u, dépend de :",
+                 j, graphe->scans[j].composantes, dj->prog_ss, dj->prog_se, dj->prog_ah, dj->prog_al);
+        for (size_t i=0; i<j; i++) {
+            struct jpeg_desc* di = &graphe->scans[i].desc;
+            bool commune = (graphe->scans[i].composantes & graphe->scans[j].composantes) != 0;
+            bool recouvre = di->prog_ss <= dj->prog_se && dj->prog_ss <= di->prog_se;
+            if (commune && recouvre) {
+                graphe->depend[j*n + i] = true;
+                graphe->scans[j].attentes++;
+                INFO_MSG(" %zu", i);
+            }
+        }
+        INFO_MSG("\n");
+    }
+}
+
+/*
+ * Fonction:  decode_scan
+ * --------------------
+ * décode les données d'un scan dans l'image du graphe, avec son
+ * propre flux positionné au début de ses données.
+ *
+ *  graphe : graphe des scans
+ *  scan   : scan à décoder
+ *
+ */
+static void decode_scan(graphe_t* graphe, const scan_t* scan)
+{
+    struct jpeg_desc desc = scan->desc;
+
+    desc.bitstream = create_bitstream(get_filename(&scan->desc));
+    seek_bitstream(desc.bitstream, scan->debut);
+    extract_scan(&desc, graphe->image);
+    close_bitstream(desc.bitstream);
+}
+
+/*
+ * Fonction:  decode_scans_thread
+ * --------------------
+ * boucle d'un thread : prend le premier scan prêt (dans l'ordre
+ * du flux) dont tous les prédécesseurs sont décodés, le décode,
+ * puis libère les scans qui l'attendaient, jusqu'à ce que tous
+ * les scans soient décodés.
+ *
+ *  arg : graphe des scans
+ *
+ */
+static void* decode_scans_thread(void* arg)
+{
+    graphe_t* graphe = (graphe_t*) arg;
+
+    pthread_mutex_lock(&graphe->verrou);
+    while (graphe->termines < graphe->nb_scans) {
+        size_t i = 0;
+        while (i < graphe->nb_scans && (graphe->scans[i].lance || graphe->scans[i].attentes > 0)) i++;
+
+        /* Aucun scan prêt : on attend la fin d'un scan en cours */
+        if (i == graphe->nb_scans) {
+            pthread_cond_wait(&graphe->prets, &graphe->verrou);
+            continue;
+        }
+
+        graphe->scans[i].lance = true;
+        pthread_mutex_unlock(&graphe->verrou);
+
+        decode_scan(graphe, &graphe->scans[i]);
+
+        pthread_mutex_lock(&graphe->verrou);
+        graphe->termines++;
+        for (size_t j=i+1; j<graphe->nb_scans; j++) {
+            if (graphe->depend[j*graphe->nb_scans + i]) graphe->scans[j].attentes--;
+        }
+        pthread_cond_broadcast(&graphe->prets);
+    }
+    pthread_mutex_unlock(&graphe->verrou);
+
+    return NULL;
+}
+
+/*
+ * Fonction:  extract_scans_parallel
+ * --------------------
+ * décode tous les scans d'une image progressive, les scans
+ * indépendants étant décodés en même temps sur un thread par
+ * coeur (au plus SCANS_THREADS_MAX), puis recalcule les
+ * métadonnées de parcimonie des blocs.
+ *
+ *       jdesc : descripteur JPEG du fichier ouvert, positionné
+ *               au début des données du premier scan
+ *  prog_image : image progressive à décoder (stockage dense)
+ *
+ */
+void extract_scans_parallel(struct jpeg_desc *jdesc, image16_t* prog_image)
+{
+    graphe_t graphe;
+
+    repere_scans(jdesc, &graphe);
+    construit_dependances(&graphe);
+
+    /* Métadonnées absentes : recalculées après le décodage */
+    image16_t image_scans = *prog_image;
+    image_scans.y_infos  = NULL;
+    image_scans.cb_infos = NULL;
+    image_scans.cr_infos = NULL;
+    graphe.image    = &image_scans;
+    graphe.termines = 0;
+    pthread_mutex_init(&graphe.verrou, NULL);
+    pthread_cond_init(&graphe.prets, NULL);
+
+    long   coeurs     = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t nb_threads = (coeurs < 1) ? 1 : ((coeurs > SCANS_THREADS_MAX) ? SCANS_THREADS_MAX : (size_t) coeurs);
+    if (nb_threads > graphe.nb_scans) nb_threads = graphe.nb_scans;
+    INFO_MSG("* %zu scans décodés sur %zu threads\n", graphe.nb_scans, nb_threads);
+
+    if (nb_threads <= 1) {
+        decode_scans_thread(&graphe);
+    } else {
+        pthread_t threads[SCANS_THREADS_MAX];
+        for (size_t t=0; t<nb_threads; t++) {
+            pthread_create(&threads[t], NULL, decode_scans_thread, (void*) &graphe);
+        }
+        for (size_t t=0; t<nb_threads; t++) {
+            pthread_join(threads[t], NULL);
+        }
+    }
+
+    update_bloc_infos(prog_image);
+
+    pthread_cond_destroy(&graphe.prets);
+    pthread_mutex_destroy(&graphe.verrou);
+    free(graphe.depend);
+    free(graphe.scans);
+}
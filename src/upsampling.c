@@ -7,162 +7,304 @@
 #include "extract_image.h"
 #include "jpeg_reader.h"
 #include "jpeg_const.h"
+#include "cpu_dispatch.h"
+#include "upsampling.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
-/* Fonction: upsample_horizontal_ligne
+
+/* Fonction: double_pixels
  * -------------------------------------
- * upsample horizontalement une ligne (i.e dedouble la ligne)
+ * noyau scalaire : double chacun des [nb] pixels de src dans dest
+ * (dest[2i] = dest[2i+1] = src[i], voir KERNELS.double_pixels)
  *
- *  ligne_b1 : pointeur sur une case d'un bloc rempli (col = 0, ligne € [0;7])
- *  ligne_b2 : pointeur sur une case d'un autre bloc  (col = 0, ligne € [0;7])
+ *  src  : pixels à doubler
+ *  dest : pixels doublés (2*nb octets)
+ *  nb   : nombre de pixels de src
  * 
  */
-static void upsample_horizontal_ligne(uint8_t* ligne_b1, uint8_t* ligne_b2)
+void double_pixels(const uint8_t* src, uint8_t* dest, size_t nb)
 {
-    int8_t indice_courant = 15;
-    uint8_t* ligne_courante;
-    for (int8_t c = 7; c >= 0; c--) {
-        // On fait attention a bien remplir au bon endroit
-        ligne_courante = (c >= 4 ? ligne_b2 : ligne_b1);
-        ligne_courante[indice_courant-- % 8] = ligne_b1[c];
-        ligne_courante[indice_courant-- % 8] = ligne_b1[c];
+    for (size_t i = 0; i < nb; i++) {
+        dest[2*i] = dest[2*i+1] = src[i];
     }
 }
 
-/* Fonction upsample_horizontal
- * -----------------------------------
- * upsample horizontalement un bloc
- * 
- *  bloc1 : bloc compressé
- *  bloc2 : bloc vide
+/* Fonction: double_pixels_sse2
+ * -------------------------------------
+ * double_pixels par paquets de 16 puis 8 pixels (entrelacement
+ * d'un registre avec lui-même), le reste en scalaire
  * 
  */
-static void upsample_horizontal(uint8_t* bloc1, uint8_t* bloc2)
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse2")))
+void double_pixels_sse2(const uint8_t* src, uint8_t* dest, size_t nb)
 {
-    for (int i = 0; i < 8; i++) {
-        upsample_horizontal_ligne(&bloc1[i*8], &bloc2[i*8]);
+    size_t i = 0;
+    for (; i+16 <= nb; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)&src[i]);
+        _mm_storeu_si128((__m128i*)&dest[2*i],    _mm_unpacklo_epi8(v, v));
+        _mm_storeu_si128((__m128i*)&dest[2*i+16], _mm_unpackhi_epi8(v, v));
+    }
+    for (; i+8 <= nb; i += 8) {
+        __m128i v = _mm_loadl_epi64((const __m128i*)&src[i]);
+        _mm_storeu_si128((__m128i*)&dest[2*i], _mm_unpacklo_epi8(v, v));
     }
+    double_pixels(&src[i], &dest[2*i], nb-i);
 }
+#else
+void double_pixels_sse2(const uint8_t* src, uint8_t* dest, size_t nb)
+{
+    double_pixels(src, dest, nb);
+}
+#endif
 
-/* Fonction upsample_vertical_col
+
+/* Fonction: triple_pixels
  * -------------------------------------
- * upsample verticalement une colonne (i.e dedouble la colonne)
+ * répète 3 fois chacun des [nb] pixels de src dans dest (h3 : MCU de
+ * 3 blocs de large pour une chrominance de 1 bloc)
  *
- *  col_b1 : pointeur sur une case d'un bloc rempli (ligne = 0, colonne € [0;7])
- *  col_b2 : pointeur sur une case d'un autre bloc (ligne = 0, colonne € [0;7])
+ *  src  : pixels à répéter
+ *  dest : pixels répétés (3*nb octets)
+ *  nb   : nombre de pixels de src
  * 
  */
-static void upsample_vertical_col(uint8_t* col_b1, uint8_t* col_b2)
+static void triple_pixels(const uint8_t* src, uint8_t* dest, size_t nb)
 {
-    int8_t indice_courant = 15;
-    uint8_t* col_courante;
-    for (int8_t l = 7; l >= 0; l--) {
-        // On fait attention a bien remplir au bon endroit
-        col_courante = (l >= 4 ? col_b2 : col_b1);
-        col_courante[((indice_courant--)%8) * 8] = col_b1[l*8];
-        col_courante[((indice_courant--)%8) * 8] = col_b1[l*8];
+    for (size_t i = 0; i < nb; i++) {
+        dest[3*i] = dest[3*i+1] = dest[3*i+2] = src[i];
     }
 }
 
-/* Fonction upsample_vertical
- * -----------------------------------
- * upsample horizontalement un bloc
- * 
- *  bloc1 : bloc compressé
- *  bloc2 : bloc vide
+/* Fonction: quadruple_pixels
+ * -------------------------------------
+ * répète 4 fois chacun des [nb] pixels de src dans dest (4:1:1)
+ *
+ *  src  : pixels à répéter
+ *  dest : pixels répétés (4*nb octets)
+ *  nb   : nombre de pixels de src
  * 
  */
-static void upsample_vertical(uint8_t* bloc1, uint8_t* bloc2)
+static void quadruple_pixels(const uint8_t* src, uint8_t* dest, size_t nb)
 {
-    for (int i = 0; i < 8; i++) {
-      upsample_vertical_col(&bloc1[i], &bloc2[i]);
+    for (size_t i = 0; i < nb; i++) {
+        memset(&dest[4*i], src[i], 4);
     }
 }
 
-/* Fonction upsample 
- * ------------------------------
- * récupère les facteur de sampling puis réalise l'upsampling adapté (pour le moment supporte uniquement l'échantillonnage
- * horizontal ou vertical ou les deux d'un coup).
+/* Fonction: create_upsampler
+ * -------------------------------------
+ * prépare la lecture ligne à ligne d'une composante à pleine résolution :
+ * les blocs de la composante restent sous-échantillonnés, chaque ligne de
+ * sortie est reconstituée à la demande (voir upsample_ligne). Tous les
+ * rapports autorisés (1 à 4 dans chaque direction, Cb et Cr pouvant
+ * différer) sont pris en charge : le noyau de répétition horizontale est
+ * choisi dans une table selon le rapport, la répétition verticale ne
+ * demande aucun calcul.
+ * L'orientation (numérotation EXIF) est appliquée pendant la lecture :
+ * une rotation de 90 ou 270 degrés lit les colonnes de la composante
+ * (les blocs sont transposés en les rassemblant, voir composante_ligne) en
+ * échangeant les rapports, et les miroirs renversent l'ordre des lignes ou
+ * des pixels. Aucune image intermédiaire n'est produite.
  *
- *  image              : image a upsampler
- *  indice             : détermine la composante sur la quelle on travaille
- *                       | 1 -> on travaille sur Cb
- *                       | 2 -> on travaille sur Cr
- *  h_MCU, v_MCU       : facteurs d'échantillonnage du composant Y (= MCU)
- *  facteur_horizontal : facteur horizontal d'échantillonnage du composant
- *  facteur_vertical   : facteur vertical d'échantillonnage du composant
+ *  image       : image décompressée (blocs en ordre des MCUs)
+ *  desc        : descripteur JPEG du fichier ouvert
+ *  comp        : composante lue (COMP_Y, COMP_Cb ou COMP_Cr)
+ *  largeur     : largeur de l'image décodée en pixels (avant orientation)
+ *  hauteur     : hauteur de l'image décodée en pixels (avant orientation)
+ *  orientation : orientation EXIF de la sortie (1 : telle quelle, 2 à 8 :
+ *                miroirs et rotations)
+ * 
+ */
+upsampler_t* create_upsampler(const image8_t* image, const struct jpeg_desc* desc, uint8_t comp,
+                              size_t largeur, size_t hauteur, uint8_t orientation)
+{
+    upsampler_t* up = malloc(sizeof(upsampler_t));
+
+    up->blocs     = (comp == COMP_Y) ? image->y_blocs : ((comp == COMP_Cb) ? image->cb_blocs : image->cr_blocs);
+    up->n         = image->bloc_size;
+    up->nb_mcus_h = desc->nb_mcus_h;
+    up->derniere  = SIZE_MAX;
+    up->repetee   = SIZE_MAX;
+    up->renversee = SIZE_MAX;
+    uint8_t fh = 1, fv = 1;
+    if (image->color) {
+        up->h_comp = get_frame_component_sampling_factor(desc, DIR_H, comp);
+        up->v_comp = get_frame_component_sampling_factor(desc, DIR_V, comp);
+        fh = get_frame_component_sampling_factor(desc, DIR_H, COMP_Y)/up->h_comp;
+        fv = get_frame_component_sampling_factor(desc, DIR_V, COMP_Y)/up->v_comp;
+    } else {
+        /* Niveaux de gris : un MCU = un bloc, blocs en ordre raster */
+        up->h_comp = up->v_comp = 1;
+    }
+
+    /* Orientation : source (x, y) de chaque pixel de sortie, après transposition éventuelle,
+     * x = largeur-1-x si miroir_x et y = hauteur-1-y si miroir_y */
+    bool miroir_x = (orientation == 2 || orientation == 3 || orientation == 7 || orientation == 8),
+         miroir_y = (orientation == 3 || orientation == 4 || orientation == 6 || orientation == 7);
+    up->transpose      = (orientation >= 5);
+    up->inverse_lignes = up->transpose ? miroir_x : miroir_y;
+    up->inverse_pixels = up->transpose ? miroir_y : miroir_x;
+    up->fh      = up->transpose ? fv : fh;
+    up->fv      = up->transpose ? fh : fv;
+    up->largeur = up->transpose ? hauteur : largeur;
+    up->hauteur = up->transpose ? largeur : hauteur;
+
+    /* Noyau de répétition horizontale selon le rapport (1 : lignes lues directement) */
+    void (*const repetitions[5])(const uint8_t*, uint8_t*, size_t) =
+        {NULL, NULL, KERNELS.double_pixels, triple_pixels, quadruple_pixels};
+    up->repete = repetitions[up->fh];
+
+    /* Ligne sous-échantillonnée (lue dans les blocs) et ligne à pleine résolution ;
+     * transposée, une colonne de blocs donne n lignes à la fois */
+    up->sous_largeur = (up->largeur + up->fh - 1)/up->fh;
+    up->sous_ligne   = malloc((up->transpose ? up->n : 1)*up->sous_largeur*sizeof(uint8_t));
+    up->ligne        = (up->fh == 1) ? up->sous_ligne : malloc(up->fh*up->sous_largeur*sizeof(uint8_t));
+    up->miroir       = up->inverse_pixels ? malloc(up->largeur*sizeof(uint8_t)) : NULL;
+
+    return up;
+}
+
+/* Fonction: free_upsampler
+ * -------------------------------------
+ * libère une lecture ligne à ligne de composante
+ * 
+ */
+void free_upsampler(upsampler_t* up)
+{
+    if (up->ligne != up->sous_ligne) free(up->ligne);
+    free(up->sous_ligne);
+    free(up->miroir);
+    free(up);
+}
+
+/* Fonction: composante_colonnes
+ * -------------------------------------
+ * transpose la colonne de blocs [bande] de la composante : les n colonnes
+ * de pixels de chaque bloc deviennent des morceaux des n lignes gardées
+ * dans up->sous_ligne (rotations de 90 et 270 degrés)
  *
+ *  up    : lecture ligne à ligne de la composante (transposée)
+ *  bande : numéro de la colonne de blocs dans la composante
+ * 
  */
-static void upsample(image8_t* image, uint8_t indice, int8_t h_MCU, int8_t v_MCU, int8_t facteur_horizontal, int8_t facteur_vertical)
+static void composante_colonnes(upsampler_t* up, size_t bande)
 {
-    /* 
-      Le dernier parametre de la fonction get_frame_component_sampling_factor correspond a l'indice de la composante de couleur
-        (i.e les facteurs entre Cb et Cr peuvent etre différents, 0 = Y, 1 = Cb, 2 = Cr) 
-    */
-    int8_t   facteur_produit = facteur_horizontal*facteur_vertical;
-    uint16_t nblocMCU = h_MCU*v_MCU;
-    
-    // On est dans le cas où il n'y a pas de sous echantillonnage : rien à faire
-    if (facteur_produit == nblocMCU) return;
-
-    uint8_t** blocs = (indice == 1) ? image->cb_blocs : image->cr_blocs;
-
-    if (facteur_produit == nblocMCU/2) {
-        /* On décale tous les blocs remplis à leurs position finale (i.e on laisse un emplacement derriere chaque bloc pour
-           le prochain qui va apparaitre avec l'upsampling) */
-        for (size_t i=image->num_blocs-1; i>0; i--) {
-            if (i>=image->num_blocs/2)
-                blocs[i] = malloc(sizeof(uint8_t)*64);
-            else
-                memcpy(blocs[2*i], blocs[i], sizeof(uint8_t)*BLOCK_PIXELS);
-        }
-        // Sous échantillonnage horizontal ou vertical
-        if (facteur_vertical == v_MCU) {
-            // Sous échantillonage horizontal
-            for (size_t i=0; i<image->num_blocs; i+=2)
-                upsample_horizontal(blocs[i], blocs[i+1]);
-        } else {
-            // Sous échantillonage vertical
-            for (size_t i=0; i<image->num_blocs; i+=2)
-                upsample_vertical(blocs[i], blocs[i+1]);
-        }
-    } else if (facteur_produit == nblocMCU/4) {
-        /* On décale tous les blocs deja remplis à leurs position finale (i.e on laisse 3 emplacements derriere chaque bloc pour
-           le prochain qui va apparaitre avec l'upsampling) */
-        // i > 0 et pas i >= 0 car pour i = 0 on fait memcpy(blocs[0], blocs[0], 64) ON EST MALINS héhéhéhé
-        for (size_t i=image->num_blocs - 1; i>0; i--) {
-            if (i >= image->num_blocs/4)
-                blocs[i] = malloc(sizeof(uint8_t)*BLOCK_PIXELS);
-            else 
-                memcpy(blocs[4*i], blocs[i], sizeof(uint8_t)*BLOCK_PIXELS);
+    size_t n = up->n,
+           mcu_colonne  = bande/up->h_comp,
+           bloc_colonne = bande%up->h_comp,
+           nb_mcu       = up->h_comp*up->v_comp;
+
+    /* Parcours des blocs de la colonne, de haut en bas */
+    for (size_t y = 0, rang = 0; y < up->sous_largeur; y += n, rang++) {
+        size_t mcu   = (rang/up->v_comp)*up->nb_mcus_h + mcu_colonne,
+               index = mcu*nb_mcu + (rang%up->v_comp)*up->h_comp + bloc_colonne,
+               nb    = (up->sous_largeur - y > n) ? n : up->sous_largeur - y;
+        const uint8_t* bloc = up->blocs[index];
+        for (size_t i = 0; i < nb; i++)
+        for (size_t j = 0; j < n; j++) {
+            up->sous_ligne[j*up->sous_largeur + y + i] = bloc[i*n + j];
         }
-        // Sous échantillonage horizontal et vertical
-        for (size_t i=0; i<image->num_blocs; i+=4) {
-            // On fait d'abord un upsampling vertical entre une case et la case+2 
-            upsample_vertical(blocs[i], blocs[i+2]);
-            // Ensuite un horizontal entre une case et la case+1 ...
-            upsample_horizontal(blocs[i], blocs[i+1]);
-            // ... et la case+2 et case+3
-            upsample_horizontal(blocs[i+2], blocs[i+3]);
+    }
+}
+
+/* Fonction: composante_ligne
+ * -------------------------------------
+ * renvoie la ligne [sous_ligne] de la composante lue par [up], à sa
+ * propre résolution (sous_largeur pixels) : elle est rassemblée depuis
+ * les blocs de la ligne de MCUs, puis gardée en cache. Avec une rotation
+ * de 90 ou 270 degrés, c'est la colonne [sous_ligne] de la composante,
+ * tirée de la colonne de blocs transposée en une fois.
+ *
+ *  up         : lecture ligne à ligne de la composante
+ *  sous_ligne : numéro de la ligne dans la composante (dans le repère de sortie)
+ * 
+ */
+const uint8_t* composante_ligne(upsampler_t* up, size_t sous_ligne)
+{
+    if (up->transpose) {
+        size_t bande = sous_ligne/up->n;
+        if (bande != up->derniere) {
+            composante_colonnes(up, bande);
+            up->derniere = bande;
         }
+        return &up->sous_ligne[(sous_ligne%up->n)*up->sous_largeur];
+    }
+
+    if (sous_ligne == up->derniere) return up->sous_ligne;
+    up->derniere = sous_ligne;
+
+    /* Position de la ligne : ligne de MCUs, ligne de blocs dans le MCU, ligne de pixels dans le bloc */
+    size_t n = up->n,
+           hauteur_mcu = up->v_comp*n,
+           mcu_ligne   = sous_ligne/hauteur_mcu,
+           bloc_ligne  = (sous_ligne%hauteur_mcu)/n,
+           pixel_index = (sous_ligne%n)*n,
+           nb_mcu      = up->h_comp*up->v_comp;
+
+    /* Copie des lignes de blocs successives */
+    for (size_t x = 0, colonne = 0; x < up->sous_largeur; x += n, colonne++) {
+        size_t mcu   = mcu_ligne*up->nb_mcus_h + colonne/up->h_comp,
+               index = mcu*nb_mcu + bloc_ligne*up->h_comp + colonne%up->h_comp;
+        memcpy(&up->sous_ligne[x], &up->blocs[index][pixel_index], (up->sous_largeur - x > n) ? n : up->sous_largeur - x);
+    }
+
+    return up->sous_ligne;
+}
+
+/* Fonction: upsample_ligne
+ * -------------------------------------
+ * renvoie la ligne [ligne] de l'image pour la composante lue par [up],
+ * à pleine résolution : les pixels de la ligne correspondante de la
+ * composante (composante_ligne) sont répétés horizontalement. La
+ * répétition verticale est faite en renvoyant la même ligne (gardée en
+ * cache) à plusieurs lignes de sortie. Les miroirs de l'orientation
+ * choisissent la ligne depuis le bas et renversent la ligne obtenue.
+ *
+ *  up    : lecture ligne à ligne de la composante
+ *  ligne : numéro de la ligne de l'image de sortie (orientée)
+ * 
+ */
+const uint8_t* upsample_ligne(upsampler_t* up, size_t ligne)
+{
+    if (up->inverse_lignes) ligne = up->hauteur - 1 - ligne;
+    size_t sous_ligne = ligne/up->fv; // Ligne à la résolution de la composante
+
+    const uint8_t* pleine;
+    if (up->repete == NULL) {
+        pleine = composante_ligne(up, sous_ligne);
+    } else if (sous_ligne == up->repetee) {
+        pleine = up->ligne;
     } else {
-        EXIT_ERROR("upsampling", "Taux d'échantillonnage non supporté. MCU : %ux%u, composante %u: %ux%u",
-                   h_MCU, v_MCU, indice, facteur_horizontal, facteur_vertical);
+        /* Répétition horizontale des pixels */
+        up->repete(composante_ligne(up, sous_ligne), up->ligne, up->sous_largeur);
+        up->repetee = sous_ligne;
+        pleine = up->ligne;
+    }
+    if (!up->inverse_pixels) return pleine;
+
+    /* Miroir horizontal de la ligne à pleine résolution */
+    if (sous_ligne != up->renversee) {
+        for (size_t x = 0, fin = up->largeur - 1; x < up->largeur; x++) {
+            up->miroir[x] = pleine[fin - x];
+        }
+        up->renversee = sous_ligne;
     }
-    if (indice == 1)
-        image->cb_blocs = blocs;
-    else 
-        image->cr_blocs = blocs;
+    return up->miroir;
 }
 
-/* Fonction upsamples
+/* Fonction check_sampling_factors
  * -------------------------
- *  Appel d'upsample pour Cb et pour Cr (voir fonction upsample)
+ *  vérifie les facteurs d'échantillonnage des composantes avant le
+ *  décodage (le suréchantillonnage est fait ligne à ligne à l'export,
+ *  voir upsample_ligne)
  *
  *  desc  : descripteur JPEG du fichier ouvert
- *  image : image à suréchantillonner
  */
-extern void upsamples(image8_t* image, struct jpeg_desc* desc)
+void check_sampling_factors(const struct jpeg_desc* desc)
 {
     int8_t facteur_horizontaux[3], facteur_verticaux[3];
     /* Restrictions sur les valeurs de h et de v (recopie sujet mot pour mot) */
@@ -184,7 +326,4 @@ extern void upsamples(image8_t* image, struct jpeg_desc* desc)
     /* La somme des produits hi*vi doit être inférieure ou égale à 10 */
     if (somme_produit > 10)
         EXIT_ERROR("upsampling", "Mauvais facteurs d'échantillonnage : Somme des produits hi*vi doit être inférieure ou égale à 10 (ici : %u)", somme_produit);
-    
-    upsample(image, 1, facteur_horizontaux[0], facteur_verticaux[0], facteur_horizontaux[1], facteur_verticaux[1]);
-    upsample(image, 2, facteur_horizontaux[0], facteur_verticaux[0], facteur_horizontaux[2], facteur_verticaux[2]);
 }